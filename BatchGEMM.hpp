@@ -0,0 +1,295 @@
+// vim:ts=2:et
+//============================================================================//
+//                                "BatchGEMM.hpp":                            //
+//            Batched Multiplication of Many Small Square Matrices           //
+//============================================================================//
+// C[b] = A[b] * B[b] for b in [0, count), where all matrices are N x N,
+// row-major and dense (the leading dimension is N), and consecutive matrices
+// of a batch are "stride" elements apart (stride >= N^2).
+// For the common sizes (N in "BatchGEMMSizes"), the kernels are specialised
+// at compile time: N is a template param, so all loops have constant trip
+// counts, are unrolled and vectorised, and C is held in registers, in bands
+// of rows. As in "GEMMKernels.hpp", they are compiled for AVX-512 and AVX2
+// via function attributes, and selected at run time. The loop over the batch
+// is inside the kernel, so the dispatch is done once per batch, not once per
+// matrix. Other sizes use a generic (run-time N) kernel:
+//
+#pragma once
+#include "GEMMKernels.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "BatchGEMMKernel": Descriptor of a Batched Kernel:                       //
+  //==========================================================================//
+  template<typename TIn, typename TAcc = TIn>
+  struct BatchGEMMKernel
+  {
+    using Func = void(long a_N, long a_count,
+                      TIn const* a_A, long a_strideA,
+                      TIn const* a_B, long a_strideB,
+                      TAcc*      a_C, long a_strideC);
+    long        m_N;        // The size it is specialised for, 0: any
+    Func*       m_func;
+    char const* m_name;
+  };
+
+  // The sizes with specialised kernels:
+  constexpr int BatchGEMMSizes[] { 4, 8, 12, 16, 24, 32 };
+
+  //--------------------------------------------------------------------------//
+  // "BatchGEMMShape": Vector Length and Band Height for Size N:              //
+  //--------------------------------------------------------------------------//
+  // A row of C is N / L vectors of L lanes (L is the largest power of 2 which
+  // divides N and fits in a vector of "VecBytes"); the band of R rows of C
+  // held in registers is the largest one (R divides N) which takes at most
+  // "NAccs" registers:
+  //
+  template<int N, typename TAcc, int VecBytes>
+  constexpr int BatchGEMMLanes()
+  {
+    int l = VecBytes / int(sizeof(TAcc));
+    while (N % l != 0)
+      l /= 2;
+    return l;
+  }
+
+  template<int N, typename TAcc, int VecBytes, int NAccs>
+  constexpr int BatchGEMMBand()
+  {
+    int nv = N / BatchGEMMLanes<N, TAcc, VecBytes>();
+    int r  = N;
+    while (r > 1 && (N % r != 0 || r * nv > NAccs))
+      --r;
+    return r;
+  }
+
+  //--------------------------------------------------------------------------//
+  // "BatchGEMMFixed": The Batch Loop, for the given Size and Vector Shape:   //
+  //--------------------------------------------------------------------------//
+  // For each band of R rows of C, the outer products of the columns of A and
+  // rows of B are accumulated in "c" (R x N / L vectors). The vectors are
+  // generic ones, so they are lowered to the ISA of the caller (into which
+  // this is always inlined), and "a * b + c" is contracted into an FMA where
+  // the ISA has it:
+  //
+  template<int N, int VecBytes, int NAccs, typename TIn, typename TAcc>
+  __attribute__((always_inline))
+  inline void BatchGEMMFixed(long a_count,
+                             TIn const* a_A, long a_strideA,
+                             TIn const* a_B, long a_strideB,
+                             TAcc*      a_C, long a_strideC)
+  {
+    constexpr int L  = BatchGEMMLanes<N, TAcc, VecBytes>();
+    constexpr int NV = N / L;
+    constexpr int R  = BatchGEMMBand <N, TAcc, VecBytes, NAccs>();
+    typedef TAcc V   __attribute__((vector_size(L * sizeof(TAcc))));
+    typedef TIn  VIn __attribute__((vector_size(L * sizeof(TIn))));
+
+    for (long b = 0; b < a_count;
+         ++b, a_A += a_strideA, a_B += a_strideB, a_C += a_strideC)
+      for (int i0 = 0; i0 < N; i0 += R)
+      {
+        V c[R][NV] = {};
+        for (int k = 0; k < N; ++k)
+        {
+          // Row k of B, converted to the accumulator type:
+          V bk[NV];
+#         pragma GCC unroll 32
+          for (int v = 0; v < NV; ++v)
+          {
+            VIn in;
+            memcpy(&in, a_B + k * N + v * L, sizeof(in));
+            if constexpr (std::is_same_v<TIn, TAcc>)
+              bk[v] = in;
+            else
+              bk[v] = __builtin_convertvector(in, V);
+          }
+#         pragma GCC unroll 32
+          for (int i = 0; i < R; ++i)
+          {
+            TAcc a = TAcc(a_A[(i0 + i) * N + k]);
+#           pragma GCC unroll 32
+            for (int v = 0; v < NV; ++v)
+              c[i][v] += a * bk[v];
+          }
+        }
+#       pragma GCC unroll 32
+        for (int i = 0; i < R; ++i)
+#         pragma GCC unroll 32
+          for (int v = 0; v < NV; ++v)
+            memcpy(a_C + (i0 + i) * N + v * L, &c[i][v], sizeof(V));
+      }
+  }
+
+  template<int N, typename TIn, typename TAcc>
+  void BatchGEMMScalar(long, long a_count,
+                       TIn const* a_A, long a_strideA,
+                       TIn const* a_B, long a_strideB,
+                       TAcc*      a_C, long a_strideC)
+  {
+    // 16 XMM registers:
+    BatchGEMMFixed<N, 16, 12>
+      (a_count, a_A, a_strideA, a_B, a_strideB, a_C, a_strideC);
+  }
+
+#ifdef SIRIUSFMTM_GEMM_X86
+  template<int N, typename TIn, typename TAcc>
+  __attribute__((target("avx2,fma")))
+  void BatchGEMMAVX2(long, long a_count,
+                     TIn const* a_A, long a_strideA,
+                     TIn const* a_B, long a_strideB,
+                     TAcc*      a_C, long a_strideC)
+  {
+    // 16 YMM registers:
+    BatchGEMMFixed<N, 32, 12>
+      (a_count, a_A, a_strideA, a_B, a_strideB, a_C, a_strideC);
+  }
+
+  template<int N, typename TIn, typename TAcc>
+  __attribute__((target("avx512f,fma")))
+  void BatchGEMMAVX512(long, long a_count,
+                       TIn const* a_A, long a_strideA,
+                       TIn const* a_B, long a_strideB,
+                       TAcc*      a_C, long a_strideC)
+  {
+    // 32 ZMM registers:
+    BatchGEMMFixed<N, 64, 24>
+      (a_count, a_A, a_strideA, a_B, a_strideB, a_C, a_strideC);
+  }
+#endif
+
+  //--------------------------------------------------------------------------//
+  // "BatchGEMMGeneric": Any Size (run-time N), Portable:                     //
+  //--------------------------------------------------------------------------//
+  template<typename TIn, typename TAcc>
+  void BatchGEMMGeneric(long a_N, long a_count,
+                        TIn const* a_A, long a_strideA,
+                        TIn const* a_B, long a_strideB,
+                        TAcc*      a_C, long a_strideC)
+  {
+    long const N = a_N;
+    for (long b = 0; b < a_count;
+         ++b, a_A += a_strideA, a_B += a_strideB, a_C += a_strideC)
+      for (long i = 0; i < N; ++i)
+      {
+        TAcc* Ci = a_C + i * N;
+        std::fill(Ci, Ci + N, TAcc(0));
+        for (long k = 0; k < N; ++k)
+        {
+          TAcc       a  = TAcc(a_A[i * N + k]);
+          TIn const* Bk = a_B + k * N;
+          for (long j = 0; j < N; ++j)
+            Ci[j] += a * TAcc(Bk[j]);
+        }
+      }
+  }
+
+  //==========================================================================//
+  // "BatchGEMMKernels": All kernels for size N on the curr CPU, best first:  //
+  //==========================================================================//
+  // The last one is always the generic one:
+  //
+  template<typename TIn, typename TAcc = TIn>
+  std::vector<BatchGEMMKernel<TIn, TAcc>> BatchGEMMKernels(long a_N)
+  {
+    using Kern = BatchGEMMKernel<TIn, TAcc>;
+    std::vector<Kern> res;
+
+    // Instantiate the kernels of all sizes, and take those of size "a_N":
+    auto add = [&]<int N>(std::integral_constant<int, N>)
+    {
+      if (a_N != N)
+        return;
+#ifdef SIRIUSFMTM_GEMM_X86
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f"))
+        res.push_back(Kern{ N, BatchGEMMAVX512<N, TIn, TAcc>, "avx512" });
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        res.push_back(Kern{ N, BatchGEMMAVX2<N, TIn, TAcc>,   "avx2"   });
+#endif
+      res.push_back(Kern{ N, BatchGEMMScalar<N, TIn, TAcc>,   "scalar" });
+    };
+    [&]<size_t... I>(std::index_sequence<I...>)
+    {
+      (add(std::integral_constant<int, BatchGEMMSizes[I]>()), ...);
+    }
+    (std::make_index_sequence<std::size(BatchGEMMSizes)>());
+
+    res.push_back(Kern{ 0, BatchGEMMGeneric<TIn, TAcc>, "generic" });
+    return res;
+  }
+
+  //==========================================================================//
+  // "BatchGEMMCheckKernel":                                                  //
+  //==========================================================================//
+  // Multiplies a small random batch with "a_kern" and with the generic
+  // kernel; returns the max relative difference:
+  //
+  template<typename TIn, typename TAcc>
+  double BatchGEMMCheckKernel
+    (long a_N, BatchGEMMKernel<TIn, TAcc> const& a_kern)
+  {
+    long const  Count = 5;
+    long const  N2    = a_N * a_N;
+    std::mt19937_64                        gen(12345);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<TIn>  A(size_t(Count * N2)), B(A.size());
+    std::vector<TAcc> C(A.size()), Cref(A.size());
+
+    double scale = std::is_integral_v<TIn> ? 127.0 : 1.0;
+    for (TIn& a: A) a = TIn(std::is_integral_v<TIn>
+                            ? std::round(dist(gen) * scale) : dist(gen));
+    for (TIn& b: B) b = TIn(std::is_integral_v<TIn>
+                            ? std::round(dist(gen) * scale) : dist(gen));
+
+    a_kern.m_func(a_N, Count, A.data(), N2, B.data(), N2, C.data(), N2);
+    BatchGEMMGeneric<TIn, TAcc>
+      (a_N, Count, A.data(), N2, B.data(), N2, Cref.data(), N2);
+
+    double err = 0.0;
+    for (size_t n = 0; n < C.size(); ++n)
+    {
+      double c = double(C[n]);
+      double r = double(Cref[n]);
+      err      = std::max(err, std::fabs(c - r) / std::max(std::fabs(r), 1.0));
+    }
+    return err;
+  }
+
+  //==========================================================================//
+  // "BatchGEMMSelectKernel":                                                 //
+  //==========================================================================//
+  // As "GEMMSelectKernel": "a_name" is "auto" (the best one available for
+  // size "a_N") or a kernel name ("generic" is always available). A kernel
+  // which disagrees with the generic one by more than "a_tol" is not used.
+  // Throws "std::invalid_argument" if the named one is not available:
+  //
+  template<typename TIn, typename TAcc = TIn>
+  BatchGEMMKernel<TIn, TAcc> BatchGEMMSelectKernel
+    (long a_N, char const* a_name, double a_tol = GEMMCheckTol<TAcc>())
+  {
+    bool isAuto = (strcmp(a_name, "auto") == 0);
+    for (BatchGEMMKernel<TIn, TAcc> const& kern:
+         BatchGEMMKernels<TIn, TAcc>(a_N))
+    {
+      if (!isAuto && strcmp(a_name, kern.m_name) != 0)
+        continue;
+      if (kern.m_N == 0 || BatchGEMMCheckKernel(a_N, kern) <= a_tol)
+        return kern;
+      if (!isAuto)
+        break;
+    }
+    throw std::invalid_argument
+      (std::string("BatchGEMMSelectKernel: Kernel not available or "
+                   "incorrect for N=") + std::to_string(a_N) + ": " + a_name);
+  }
+} // End namespace SiriusFMTM
@@ -0,0 +1,227 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                 "BufferPool.c":                           //
+//             Pool of I/O Rings with Thread-Local Free Lists and Stats      //
+//===========================================================================//
+#include "BufferPool.h"
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+// Size classes: (PageSize << c), c = 0 .. NClasses-1 (ie 4 KB .. 64 KB with
+// the usual 4 KB pages):
+#define NClasses      5
+// Max number of Rings per class in each Thread's free list, and in the depot:
+#define MaxLocal      8
+#define MaxDepot     64
+
+//===========================================================================//
+// Free Lists:                                                               //
+//===========================================================================//
+typedef struct FreeList
+{
+  int       m_n[NClasses];
+  ByteRing  m_rings[NClasses][MaxLocal];
+} FreeList;
+
+typedef struct Depot
+{
+  pthread_mutex_t m_mutex;
+  int             m_n[NClasses];
+  ByteRing        m_rings[NClasses][MaxDepot];
+} Depot;
+
+static __thread FreeList* t_local = NULL;
+static __thread FreeList  t_localStorage;
+
+static Depot              s_depot = { PTHREAD_MUTEX_INITIALIZER };
+static pthread_key_t      s_key;
+static pthread_once_t     s_keyOnce = PTHREAD_ONCE_INIT;
+static BufferPoolStats    s_stats;
+
+//===========================================================================//
+// Utils:                                                                    //
+//===========================================================================//
+#define StatsAdd(Fld, N) \
+  ((void) __atomic_add_fetch(&s_stats.Fld, (N), __ATOMIC_RELAXED))
+#define StatsSub(Fld, N) \
+  ((void) __atomic_sub_fetch(&s_stats.Fld, (N), __ATOMIC_RELAXED))
+
+//---------------------------------------------------------------------------//
+// "SizeClass": (-1) if not pooled; also returns the actual Ring size:       //
+//---------------------------------------------------------------------------//
+static int SizeClass(size_t a_minSize, size_t* a_size)
+{
+  size_t size = (size_t) sysconf(_SC_PAGESIZE);
+  int    c    = 0;
+  for (; size < a_minSize; ++c)
+    size <<= 1;
+  *a_size = size;
+  return (c < NClasses) ? c : -1;
+}
+
+//---------------------------------------------------------------------------//
+// "NoteInUse": Account for a Ring handed out:                               //
+//---------------------------------------------------------------------------//
+static void NoteInUse(size_t a_size)
+{
+  unsigned long inUse =
+    __atomic_add_fetch(&s_stats.m_bytesInUse, a_size, __ATOMIC_RELAXED);
+  unsigned long peak  =
+    __atomic_load_n   (&s_stats.m_peakBytesInUse,     __ATOMIC_RELAXED);
+  while (inUse > peak &&
+         !__atomic_compare_exchange_n(&s_stats.m_peakBytesInUse, &peak, inUse,
+                                      1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+//---------------------------------------------------------------------------//
+// "ToDepot": Ring goes to the depot, or is destroyed if the depot is full:  //
+//---------------------------------------------------------------------------//
+static void ToDepot(int a_c, ByteRing* a_ring)
+{
+  (void) pthread_mutex_lock(&s_depot.m_mutex);
+  int ok = (s_depot.m_n[a_c] < MaxDepot);
+  if (ok)
+    s_depot.m_rings[a_c][s_depot.m_n[a_c]++] = *a_ring;
+  (void) pthread_mutex_unlock(&s_depot.m_mutex);
+
+  if (!ok)
+  {
+    StatsSub(m_bytesCached, a_ring->m_size);
+    StatsAdd(m_nUnmapped,   1);
+    ByteRingDestroy(a_ring);
+  }
+}
+
+//---------------------------------------------------------------------------//
+// "ThreadExit": Move the exiting Thread's free lists to the depot:          //
+//---------------------------------------------------------------------------//
+static void ThreadExit(void* a_local)
+{
+  FreeList* local = (FreeList*) a_local;
+  for (int c = 0; c < NClasses; ++c)
+    while (local->m_n[c] > 0)
+      ToDepot(c, &local->m_rings[c][--local->m_n[c]]);
+}
+
+static void MakeKey(void)
+  { (void) pthread_key_create(&s_key, ThreadExit); }
+
+//---------------------------------------------------------------------------//
+// "Local": The curr Thread's free lists (registered for clean-up on exit):  //
+//---------------------------------------------------------------------------//
+static FreeList* Local(void)
+{
+  if (t_local == NULL)
+  {
+    (void) pthread_once(&s_keyOnce, MakeKey);
+    t_local = &t_localStorage;
+    (void) pthread_setspecific(s_key, t_local);
+  }
+  return t_local;
+}
+
+//===========================================================================//
+// "BufferPoolGetRing":                                                      //
+//===========================================================================//
+int BufferPoolGetRing(ByteRing* a_ring, size_t a_minSize)
+{
+  assert(a_ring != NULL);
+  StatsAdd(m_nGets, 1);
+
+  size_t size = 0;
+  int    c    = SizeClass(a_minSize, &size);
+  if (c >= 0)
+  {
+    // Try the Thread-local free list first:
+    FreeList* local = Local();
+    if (local->m_n[c] > 0)
+    {
+      *a_ring = local->m_rings[c][--local->m_n[c]];
+      StatsAdd(m_nLocalHits,  1);
+      StatsSub(m_bytesCached, size);
+      NoteInUse(size);
+      return 0;
+    }
+    // Then the depot:
+    (void) pthread_mutex_lock(&s_depot.m_mutex);
+    int ok = (s_depot.m_n[c] > 0);
+    if (ok)
+      *a_ring = s_depot.m_rings[c][--s_depot.m_n[c]];
+    (void) pthread_mutex_unlock(&s_depot.m_mutex);
+    if (ok)
+    {
+      StatsAdd(m_nDepotHits,  1);
+      StatsSub(m_bytesCached, size);
+      NoteInUse(size);
+      return 0;
+    }
+  }
+  // Create a new one:
+  if (ByteRingInit(a_ring, size) != 0)
+    return -1;
+  assert(a_ring->m_size == size);
+  StatsAdd(m_nMapped, 1);
+  NoteInUse(size);
+  return 0;
+}
+
+//===========================================================================//
+// "BufferPoolPutRing":                                                      //
+//===========================================================================//
+void BufferPoolPutRing(ByteRing* a_ring)
+{
+  assert(a_ring != NULL);
+  if (a_ring->m_base == NULL)
+    return;
+  StatsAdd(m_nPuts,      1);
+  StatsSub(m_bytesInUse, a_ring->m_size);
+
+  // Discard the data:
+  a_ring->m_head = 0;
+  a_ring->m_tail = 0;
+
+  size_t size = 0;
+  int    c    = SizeClass(a_ring->m_size, &size);
+  if (c < 0)
+  {
+    StatsAdd(m_nUnmapped, 1);
+    ByteRingDestroy(a_ring);
+    return;
+  }
+  StatsAdd(m_bytesCached, size);
+
+  FreeList* local = Local();
+  if (local->m_n[c] < MaxLocal)
+    local->m_rings[c][local->m_n[c]++] = *a_ring;
+  else
+    ToDepot(c, a_ring);
+
+  // The caller's copy must not be used any more:
+  memset(a_ring, '\0', sizeof(ByteRing));
+}
+
+//===========================================================================//
+// Stats:                                                                    //
+//===========================================================================//
+void BufferPoolGetStats(BufferPoolStats* a_stats)
+{
+  assert(a_stats != NULL);
+  unsigned long const* from = (unsigned long const*) &s_stats;
+  unsigned long*       to   = (unsigned long*)       a_stats;
+  for (size_t i = 0; i < sizeof(BufferPoolStats) / sizeof(unsigned long); ++i)
+    to[i] = __atomic_load_n(from + i, __ATOMIC_RELAXED);
+}
+
+void BufferPoolPrintStats(FILE* a_out)
+{
+  BufferPoolStats st;
+  BufferPoolGetStats(&st);
+  fprintf(a_out,
+    "BufferPool: Gets=%lu (Local=%lu, Depot=%lu, Mapped=%lu), Puts=%lu, "
+    "Unmapped=%lu, InUse=%lu B (Peak=%lu B), Cached=%lu B\n",
+    st.m_nGets, st.m_nLocalHits, st.m_nDepotHits, st.m_nMapped, st.m_nPuts,
+    st.m_nUnmapped, st.m_bytesInUse, st.m_peakBytesInUse, st.m_bytesCached);
+}
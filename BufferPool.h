@@ -0,0 +1,64 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                 "BufferPool.h":                           //
+//             Pool of I/O Rings with Thread-Local Free Lists and Stats      //
+//===========================================================================//
+// Creating a "ByteRing" costs several system calls (memfd, 3 mmaps), so
+// released Rings are kept for re-use, in free lists per size class:
+// (*) each Thread has its own small free lists, accessed without locking;
+// (*) when a Thread exits, or its free list of some class is full, the Rings
+//     go to a shared (mutex-protected) depot, from which other Threads (eg
+//     short-lived per-connection ones) refill;
+// (*) Rings larger than the largest class are not pooled.
+// The Rings are requested by actual need and released as soon as a req (or
+// connection) is done, so idle connections hold no response buffers:
+//
+#pragma once
+#include "ByteRing.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------//
+// "BufferPoolStats": Counters since the start of the process:               //
+//---------------------------------------------------------------------------//
+typedef struct BufferPoolStats
+{
+  unsigned long m_nGets;          // Total "BufferPoolGetRing" calls
+  unsigned long m_nLocalHits;     //   served from the Thread-local free list
+  unsigned long m_nDepotHits;     //   served from the shared depot
+  unsigned long m_nMapped;        //   served by creating a new Ring
+  unsigned long m_nPuts;          // Total "BufferPoolPutRing" calls
+  unsigned long m_nUnmapped;      // Rings destroyed (free lists were full)
+  unsigned long m_bytesInUse;     // Capacity of all Rings currently in use
+  unsigned long m_peakBytesInUse;
+  unsigned long m_bytesCached;    // Capacity of all Rings in free lists
+} BufferPoolStats;
+
+//---------------------------------------------------------------------------//
+// "BufferPoolGetRing":                                                      //
+//---------------------------------------------------------------------------//
+// Provides an empty Ring of at least "a_minSize" bytes. Returns 0 on success,
+// (-1) on error (with "errno" set):
+//
+extern int  BufferPoolGetRing(ByteRing* a_ring, size_t a_minSize);
+
+//---------------------------------------------------------------------------//
+// "BufferPoolPutRing":                                                      //
+//---------------------------------------------------------------------------//
+// Returns the Ring to the pool, discarding any data in it. Nothing is done
+// for a Ring which was not created (ie with "m_base" = NULL):
+//
+extern void BufferPoolPutRing(ByteRing* a_ring);
+
+//---------------------------------------------------------------------------//
+// Stats:                                                                    //
+//---------------------------------------------------------------------------//
+extern void BufferPoolGetStats  (BufferPoolStats* a_stats);
+extern void BufferPoolPrintStats(FILE* a_out);
+
+#ifdef __cplusplus
+}
+#endif
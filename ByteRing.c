@@ -0,0 +1,82 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                  "ByteRing.c":                            //
+//           Byte Ring Buffer on a Mirrored (Double-Mapped) Memory Region    //
+//===========================================================================//
+#define _GNU_SOURCE       // For "memfd_create"
+#include "ByteRing.h"
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <assert.h>
+
+//===========================================================================//
+// "ByteRingInit":                                                           //
+//===========================================================================//
+int ByteRingInit(ByteRing* a_ring, size_t a_minSize)
+{
+  assert(a_ring != NULL);
+  a_ring->m_base = NULL;
+  a_ring->m_size = 0;
+  a_ring->m_head = 0;
+  a_ring->m_tail = 0;
+
+  // The size must be a power of 2 (for masking) and a multiple of the page
+  // size (for mapping); as the page size is a power of 2 itself, it is
+  // enough to start from it:
+  size_t size = (size_t) sysconf(_SC_PAGESIZE);
+  while (size < a_minSize)
+    size <<= 1;
+
+  char* base = NULL;
+  int   err  = 0;
+  int   fd   = memfd_create("ByteRing", MFD_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  if (ftruncate(fd, (off_t) size) < 0)
+    goto Err0;
+
+  // Reserve (2 * size) of contiguous address space, then map the same pages
+  // over both halves of it:
+  base = (char*) mmap(NULL, 2 * size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    goto Err0;
+
+  if (mmap(base,        size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+           fd, 0) == MAP_FAILED ||
+      mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+           fd, 0) == MAP_FAILED)
+    goto Err1;
+
+  // The mappings keep the pages alive, the descr is not needed any more:
+  (void) close(fd);
+  a_ring->m_base = base;
+  a_ring->m_size = size;
+  return 0;
+
+  // Clean-up on errors, preserving "errno":
+Err1:
+  err     = errno;
+  (void) munmap(base, 2 * size);
+  errno   = err;
+Err0:
+  err     = errno;
+  (void) close(fd);
+  errno   = err;
+  return -1;
+}
+
+//===========================================================================//
+// "ByteRingDestroy":                                                        //
+//===========================================================================//
+void ByteRingDestroy(ByteRing* a_ring)
+{
+  assert(a_ring != NULL);
+  if (a_ring->m_base != NULL)
+    (void) munmap(a_ring->m_base, 2 * a_ring->m_size);
+  a_ring->m_base = NULL;
+  a_ring->m_size = 0;
+  a_ring->m_head = 0;
+  a_ring->m_tail = 0;
+}
@@ -0,0 +1,84 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                  "ByteRing.h":                            //
+//           Byte Ring Buffer on a Mirrored (Double-Mapped) Memory Region    //
+//===========================================================================//
+// The same "memfd" pages are mapped twice, back-to-back, so that any range of
+// up to "m_size" bytes starting anywhere in the 1st copy is contiguous in the
+// virtual memory, even if it wraps around. Thus the readable and writable
+// parts of the ring are always single spans, which can be passed directly to
+// "recv"/"send"/"read"/"write" (or, as "struct iovec"s, to "readv"/"writev"),
+// with no compaction or copying:
+//
+#pragma once
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------//
+// "ByteRing":                                                               //
+//---------------------------------------------------------------------------//
+typedef struct ByteRing
+{
+  char*   m_base;   // Start of the mapping of (2 * m_size) bytes
+  size_t  m_size;   // Capacity: a power of 2, multiple of the page size
+  size_t  m_head;   // Running idx of the 1st readable byte
+  size_t  m_tail;   // Running idx one past the last readable byte
+} ByteRing;
+
+//---------------------------------------------------------------------------//
+// Creation and Destruction:                                                 //
+//---------------------------------------------------------------------------//
+// "ByteRingInit": The capacity is "a_minSize" rounded up to a power of 2 and
+// to the page size. Returns 0 on success, (-1) on error (with "errno" set):
+//
+extern int  ByteRingInit   (ByteRing* a_ring, size_t a_minSize);
+extern void ByteRingDestroy(ByteRing* a_ring);
+
+//---------------------------------------------------------------------------//
+// Sizes:                                                                    //
+//---------------------------------------------------------------------------//
+static inline size_t ByteRingSize (ByteRing const* a_ring)
+  { return a_ring->m_tail - a_ring->m_head; }
+
+static inline size_t ByteRingSpace(ByteRing const* a_ring)
+  { return a_ring->m_size - ByteRingSize(a_ring); }
+
+//---------------------------------------------------------------------------//
+// Spans:                                                                    //
+//---------------------------------------------------------------------------//
+// "ByteRingReadSpan":  All currently-readable bytes;
+// "ByteRingWriteSpan": All currently-free space:
+//
+static inline struct iovec ByteRingReadSpan (ByteRing const* a_ring)
+{
+  struct iovec res =
+    { a_ring->m_base + (a_ring->m_head & (a_ring->m_size - 1)),
+      ByteRingSize(a_ring) };
+  return res;
+}
+
+static inline struct iovec ByteRingWriteSpan(ByteRing const* a_ring)
+{
+  struct iovec res =
+    { a_ring->m_base + (a_ring->m_tail & (a_ring->m_size - 1)),
+      ByteRingSpace(a_ring) };
+  return res;
+}
+
+//---------------------------------------------------------------------------//
+// "ByteRingCommit":  Make "a_n" bytes written into the WriteSpan readable;  //
+// "ByteRingConsume": Drop "a_n" bytes from the front of the ReadSpan:       //
+//---------------------------------------------------------------------------//
+static inline void ByteRingCommit (ByteRing* a_ring, size_t a_n)
+  { a_ring->m_tail += a_n; }
+
+static inline void ByteRingConsume(ByteRing* a_ring, size_t a_n)
+  { a_ring->m_head += a_n; }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,140 @@
+// vim:ts=2:et
+//============================================================================//
+//                              "CPUTopology.hpp":                            //
+//             NUMA Nodes and CPUs available to the curr Process (Linux)      //
+//============================================================================//
+#pragma once
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "ParseCPUList": Parse the Kernel's CPU list format, eg "0-3,8,10-11":    //
+  //==========================================================================//
+  inline std::vector<int> ParseCPUList(std::string const& a_str)
+  {
+    std::vector<int> res;
+    char const*      curr = a_str.c_str();
+    while (*curr != '\0' && *curr != '\n')
+    {
+      char* end  = nullptr;
+      long  from = strtol(curr, &end, 10);
+      if (end == curr)
+        break;                    // Invalid format
+      long  to   = from;
+      curr = end;
+      if (*curr == '-')
+      {
+        to   = strtol(curr + 1, &end, 10);
+        curr = end;
+      }
+      for (long c = from; c <= to; ++c)
+        res.push_back(int(c));
+      if (*curr == ',')
+        ++curr;
+    }
+    return res;
+  }
+
+  //==========================================================================//
+  // "CPUTopology":                                                           //
+  //==========================================================================//
+  struct CPUTopology
+  {
+    // CPUs we are allowed to run on, per NUMA node (indexed by the node id;
+    // nodes without allowed CPUs have empty lists):
+    std::vector<std::vector<int>> m_nodeCPUs;
+
+    size_t NNodes() const { return m_nodeCPUs.size(); }
+
+    //------------------------------------------------------------------------//
+    // "NodeOfCPU": (-1) if unknown:                                          //
+    //------------------------------------------------------------------------//
+    int NodeOfCPU(int a_cpu) const
+    {
+      for (size_t n = 0; n < m_nodeCPUs.size(); ++n)
+        if (std::find(m_nodeCPUs[n].begin(), m_nodeCPUs[n].end(), a_cpu) !=
+            m_nodeCPUs[n].end())
+          return int(n);
+      return -1;
+    }
+
+    //------------------------------------------------------------------------//
+    // "CompactOrder": All allowed CPUs, node by node:                        //
+    //------------------------------------------------------------------------//
+    std::vector<int> CompactOrder() const
+    {
+      std::vector<int> res;
+      for (std::vector<int> const& cpus: m_nodeCPUs)
+        res.insert(res.end(), cpus.begin(), cpus.end());
+      return res;
+    }
+
+    //------------------------------------------------------------------------//
+    // "ScatterOrder": All allowed CPUs, round-robin over the nodes:          //
+    //------------------------------------------------------------------------//
+    std::vector<int> ScatterOrder() const
+    {
+      std::vector<int> res;
+      for (size_t i = 0; ; ++i)
+      {
+        bool any = false;
+        for (std::vector<int> const& cpus: m_nodeCPUs)
+          if (i < cpus.size())
+          {
+            res.push_back(cpus[i]);
+            any = true;
+          }
+        if (!any)
+          return res;
+      }
+    }
+
+    //------------------------------------------------------------------------//
+    // "Detect": From "sched_getaffinity" and "/sys/devices/system/node":     //
+    //------------------------------------------------------------------------//
+    // Without the NUMA info in "/sys", all allowed CPUs form Node 0:
+    //
+    static CPUTopology Detect()
+    {
+      cpu_set_t allowed;
+      CPU_ZERO(&allowed);
+      if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+      {
+        long nCPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long c = 0; c < nCPUs && c < CPU_SETSIZE; ++c)
+          CPU_SET(int(c), &allowed);
+      }
+
+      // Node ids may be sparse (eg if some nodes are offline):
+      CPUTopology res;
+      int const   MaxNodes = 1024;
+      for (int node = 0; node < MaxNodes; ++node)
+      {
+        std::ifstream in("/sys/devices/system/node/node" +
+                         std::to_string(node) + "/cpulist");
+        std::string   line;
+        if (!in || !std::getline(in, line))
+          continue;
+        res.m_nodeCPUs.resize(size_t(node) + 1);
+        for (int c: ParseCPUList(line))
+          if (c < CPU_SETSIZE && CPU_ISSET(c, &allowed))
+            res.m_nodeCPUs[size_t(node)].push_back(c);
+      }
+      if (res.CompactOrder().empty())
+      {
+        res.m_nodeCPUs.assign(1, std::vector<int>());
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+          if (CPU_ISSET(c, &allowed))
+            res.m_nodeCPUs[0].push_back(c);
+      }
+      return res;
+    }
+  };
+} // End namespace SiriusFMTM
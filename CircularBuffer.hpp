@@ -6,10 +6,21 @@
 #pragma once
 
 #include <cassert>
+#include <cstddef>
+#include <new>
 #include <stdexcept>
+#include <utility>
 
 namespace SiriusFMTM
 {
+  //==========================================================================//
+  // "CircularBuffer":                                                        //
+  //==========================================================================//
+  // Entries live in raw (uninitialised) storage and are constructed in place
+  // on insertion and destroyed on removal, so "T" need not be default-
+  // constructible or copyable (eg "std::unique_ptr" is OK). The storage size
+  // is rounded up to a power of 2, so that indexing is done by masking:
+  //
   template<typename T>
   class CircularBuffer
   {
@@ -17,12 +28,27 @@ namespace SiriusFMTM
     //==========================================================================//
     // Data Flds:                                                               //
     //==========================================================================//
-    int const     m_N;        // Buffer capacity
-    T*  const     m_buff;
-    int           m_front;    // Idx of the front entry
-    int           m_back;     // Idx of the back  entry
-    int           m_count;    // Number of entries currently in the buffer
-  
+    size_t const  m_N;        // Buffer capacity (as requested)
+    size_t const  m_mask;     // Storage size (a power of 2) minus 1
+    T*     const  m_buff;     // Raw storage, NOT constructed
+    size_t        m_front;    // Running idx of the front entry
+    size_t        m_back;     // Running idx one past the back entry
+    // The number of entries currently in the buffer is (m_back - m_front);
+    // the actual position of running idx "i" in "m_buff" is (i & m_mask)
+
+    //--------------------------------------------------------------------------//
+    // "StorageSize": Smallest power of 2 >= a_N:                               //
+    //--------------------------------------------------------------------------//
+    static size_t StorageSize(size_t a_N)
+    {
+      size_t sz = 1;
+      while (sz < a_N)
+        sz <<= 1;
+      return sz;
+    }
+
+    T* Slot(size_t a_i) const { return m_buff + (a_i & m_mask); }
+
   public:
     //==========================================================================//
     // Consts and Methods:                                                      //
@@ -31,25 +57,32 @@ namespace SiriusFMTM
     // Non-Default Ctor:                                                        //
     //--------------------------------------------------------------------------//
     CircularBuffer(size_t a_N)
-    : m_N    (int  (a_N)),
-      m_buff (new T[a_N]),
-      m_front(-1),
-      m_back (-1),
-      m_count(0)
+    : m_N    (a_N),
+      m_mask (StorageSize(a_N) - 1),
+      m_buff (static_cast<T*>
+               (::operator new(sizeof(T) * (m_mask + 1),
+                               std::align_val_t(alignof(T))))),
+      m_front(0),
+      m_back (0)
     {
-      assert(m_N > 1 && IsEmpty());
+      assert(m_N >= 1 && IsEmpty());
     }
-  
+
     // To be on a safe side: Disallow Default Ctor and Copy Ctor:
     CircularBuffer()                      = delete;
     CircularBuffer(CircularBuffer const&) = delete;
-  
+
     //--------------------------------------------------------------------------//
     // Dtor:                                                                    //
     //--------------------------------------------------------------------------//
     ~CircularBuffer()
-      { delete[] m_buff; }  // Free the previously-allocated memory
-  
+    {
+      // Destroy the remaining entries, then free the raw storage:
+      while (!IsEmpty())
+        pop_front();
+      ::operator delete(m_buff, std::align_val_t(alignof(T)));
+    }
+
     //--------------------------------------------------------------------------//
     // "IsEmpty": Test for Emptiness:                                           //
     //--------------------------------------------------------------------------//
@@ -57,88 +90,96 @@ namespace SiriusFMTM
     //
     bool IsEmpty() const
     {
-      assert((m_front == -1 || (0 <= m_front && m_front <= m_N-1)) &&
-             (m_back  == -1 || (0 <= m_back  && m_back  <= m_N-1)) &&
-             0 <= m_count   && m_count <= m_N);
-  
-      bool isEmpty = (m_count == 0);
-  
-      assert(!isEmpty || (m_front == -1 && m_back == -1));
-      return  isEmpty;
+      assert(m_back - m_front <= m_N);
+      return m_back == m_front;
     }
 
     // For compatibility with boost::circular_buffer API:
     bool empty() const { return IsEmpty(); }
-  
+
     //--------------------------------------------------------------------------//
     // "IsFull":                                                                //
     //--------------------------------------------------------------------------//
     bool IsFull() const
     {
-      bool   isFull = (m_count == m_N);
+      bool   isFull = (m_back - m_front == m_N);
       assert(!(isFull && IsEmpty()));
       return isFull;
     }
 
     // For compatibility with boost::circular_buffer API:
-    bool full()  const { return IsFull(); }
-  
+    bool   full()     const { return IsFull();         }
+    size_t size()     const { return m_back - m_front; }
+    size_t capacity() const { return m_N;              }
+
     //--------------------------------------------------------------------------//
-    // "PushBack":                                                              //
+    // "EmplaceBack": Construct a new back entry in place:                      //
     //--------------------------------------------------------------------------//
-    void PushBack(T const& a_t)
+    template<typename... Args>
+    T& EmplaceBack(Args&&... a_args)
     {
-      // Trivial Cases:
-      if (IsEmpty())
-      {
-        m_front   = 0;
-        m_back    = 0;
-        m_buff[0] = a_t;
-        m_count   = 1;
-        assert(!IsEmpty());
-        return;
-      }
       if (IsFull())
         throw std::runtime_error("CircularBuffer::PushBack(): IsFull");
-  
-      // Generic Case: Neither Empty nor Full:
-      ++m_back;
-      m_back = m_back % m_N;
-      assert(m_back != m_front);     // Because buffer was not full
-  
-      // Store the new entry at new back:
-      m_buff[m_back] = a_t;
-      ++m_count;
+
+      T* res = new (Slot(m_back)) T(std::forward<Args>(a_args)...);
+      ++m_back;   // Only if the Ctor did not throw
+      return *res;
     }
 
     // For compatibility with boost::circular_buffer API:
-    void push_back(T const& a_t) { PushBack(a_t); }
-  
+    template<typename... Args>
+    T& emplace_back(Args&&... a_args)
+      { return EmplaceBack(std::forward<Args>(a_args)...); }
+
     //--------------------------------------------------------------------------//
-    // "PopFront":                                                              //
+    // "PushBack":                                                              //
+    //--------------------------------------------------------------------------//
+    void PushBack(T const& a_t) { EmplaceBack(a_t);            }
+    void PushBack(T&&      a_t) { EmplaceBack(std::move(a_t)); }
+
+    // For compatibility with boost::circular_buffer API:
+    void push_back(T const& a_t) { EmplaceBack(a_t);            }
+    void push_back(T&&      a_t) { EmplaceBack(std::move(a_t)); }
+
+    //--------------------------------------------------------------------------//
+    // "Front": Access the front entry without removing it:                     //
+    //--------------------------------------------------------------------------//
+    T& Front()
+    {
+      if (IsEmpty())
+        throw std::runtime_error("CircularBuffer::Front(): IsEmpty");
+      return *Slot(m_front);
+    }
+
+    T const& Front() const
+      { return const_cast<CircularBuffer*>(this)->Front(); }
+
+    // For compatibility with boost::circular_buffer API:
+    T&       front()       { return Front(); }
+    T const& front() const { return Front(); }
+
     //--------------------------------------------------------------------------//
-    // Returns the former front entry:
+    // "pop_front": Destroy the front entry:                                    //
+    //--------------------------------------------------------------------------//
+    // For compatibility with boost::circular_buffer API:
     //
-    T PopFront()
+    void pop_front()
     {
-      // Trivial Case:
       if (IsEmpty())
         throw std::runtime_error("CircularBuffer::PopFront(): IsEmpty");
-  
-      // Generic Case:
-      T res = m_buff[m_front];
-      --m_count;
-      if (m_count == 0)
-      {
-        m_front = -1;
-        m_back  = -1;
-        assert(IsEmpty());
-      }
-      else
-      {
-        ++m_front;
-        m_front = m_front % m_N;
-      }
+      Slot(m_front)->~T();
+      ++m_front;
+    }
+
+    //--------------------------------------------------------------------------//
+    // "PopFront":                                                              //
+    //--------------------------------------------------------------------------//
+    // Returns the former front entry (moved out):
+    //
+    T PopFront()
+    {
+      T res(std::move(Front()));
+      pop_front();
       return res;
     }
   };
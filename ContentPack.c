@@ -0,0 +1,134 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                "ContentPack.c":                           //
+//         Static Content Tree Packed into a Single Memory-Mapped Archive    //
+//===========================================================================//
+#include "ContentPack.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <assert.h>
+
+//===========================================================================//
+// "InBounds": Is [a_off, a_off + a_len) within the archive?                 //
+//===========================================================================//
+static int InBounds(ContentPack const* a_pack, uint64_t a_off, uint64_t a_len)
+  { return a_off <= a_pack->m_size && a_len <= a_pack->m_size - a_off; }
+
+//===========================================================================//
+// "ContentPackOpen":                                                        //
+//===========================================================================//
+int ContentPackOpen(ContentPack* a_pack, char const* a_path)
+{
+  assert(a_pack != NULL && a_path != NULL);
+  memset(a_pack, '\0', sizeof(ContentPack));
+  a_pack->m_fd = -1;
+
+  int fd = open(a_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    goto Err;
+  if ((size_t) st.st_size < sizeof(ContentPackHdr))
+  {
+    errno = EINVAL;
+    goto Err;
+  }
+  size_t size = (size_t) st.st_size;
+  void*  base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    goto Err;
+
+  a_pack->m_fd      = fd;
+  a_pack->m_base    = (char const*) base;
+  a_pack->m_size    = size;
+  a_pack->m_hdr     = (ContentPackHdr const*) base;
+
+  ContentPackHdr const* hdr = a_pack->m_hdr;
+  if (memcmp(hdr->m_magic, ContentPackMagic, sizeof(hdr->m_magic)) != 0 ||
+      hdr->m_size     != size                                           ||
+      hdr->m_nFiles   >  (uint64_t) INT32_MAX                           ||
+      hdr->m_nBuckets >  (uint64_t) INT32_MAX                           ||
+      (hdr->m_nFiles  >  0 && hdr->m_nBuckets == 0)                     ||
+      hdr->m_dispOff    % sizeof(int32_t)  != 0                         ||
+      hdr->m_entriesOff % sizeof(uint64_t) != 0                         ||
+      !InBounds(a_pack, hdr->m_dispOff,
+                hdr->m_nBuckets * sizeof(int32_t))                      ||
+      !InBounds(a_pack, hdr->m_entriesOff,
+                hdr->m_nFiles   * sizeof(ContentPackEntry))             ||
+      hdr->m_strsOff  >  hdr->m_bodiesOff                               ||
+      hdr->m_bodiesOff > size)
+  {
+    ContentPackClose(a_pack);
+    errno = EINVAL;
+    return -1;
+  }
+  a_pack->m_disp    = (int32_t const*) (a_pack->m_base + hdr->m_dispOff);
+  a_pack->m_entries =
+    (ContentPackEntry const*) (a_pack->m_base + hdr->m_entriesOff);
+
+  // The index is accessed randomly: start reading all of it in now (this
+  // does not block); the bodies are read in on demand:
+  (void) madvise((void*) a_pack->m_base, hdr->m_bodiesOff, MADV_WILLNEED);
+  return 0;
+
+  // Clean-up on errors, preserving "errno":
+Err:;
+  int err = errno;
+  (void) close(fd);
+  errno   = err;
+  return -1;
+}
+
+//===========================================================================//
+// "ContentPackClose":                                                       //
+//===========================================================================//
+void ContentPackClose(ContentPack* a_pack)
+{
+  assert(a_pack != NULL);
+  if (a_pack->m_base != NULL)
+    (void) munmap((void*) a_pack->m_base, a_pack->m_size);
+  if (a_pack->m_fd >= 0)
+    (void) close(a_pack->m_fd);
+  memset(a_pack, '\0', sizeof(ContentPack));
+  a_pack->m_fd = -1;
+}
+
+//===========================================================================//
+// "ContentPackFind":                                                        //
+//===========================================================================//
+ContentPackEntry const* ContentPackFind
+  (ContentPack const* a_pack, char const* a_path, size_t a_len)
+{
+  assert(a_pack != NULL && a_pack->m_hdr != NULL && a_path != NULL);
+  ContentPackHdr const* hdr = a_pack->m_hdr;
+  if (hdr->m_nFiles == 0)
+    return NULL;
+
+  uint64_t b = ContentPackHash(a_path, a_len, hdr->m_seed) % hdr->m_nBuckets;
+  int32_t  d = a_pack->m_disp[b];
+  if (d == 0)
+    return NULL;
+  uint64_t slot = (d < 0)
+                  ? (uint64_t) (-(int64_t) d - 1)
+                  : ContentPackHash(a_path, a_len, hdr->m_seed + (uint64_t) d)
+                    % hdr->m_nFiles;
+  if (slot >= hdr->m_nFiles)
+    return NULL;
+
+  // The slot is that of "a_path" only if it is in the archive at all:
+  ContentPackEntry const* ent = a_pack->m_entries + slot;
+  if (ent->m_pathLen != a_len                                   ||
+      !InBounds(a_pack, ent->m_pathOff,   ent->m_pathLen)       ||
+      !InBounds(a_pack, ent->m_hdrOff[0], ent->m_hdrLen[0])     ||
+      !InBounds(a_pack, ent->m_hdrOff[1], ent->m_hdrLen[1])     ||
+      !InBounds(a_pack, ent->m_bodyOff,   ent->m_bodySize)      ||
+      memcmp(a_pack->m_base + ent->m_pathOff, a_path, a_len) != 0)
+    return NULL;
+  return ent;
+}
@@ -0,0 +1,115 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                "ContentPack.h":                           //
+//         Static Content Tree Packed into a Single Memory-Mapped Archive    //
+//===========================================================================//
+// The archive (made by "PackContent") contains, for all regular files of a
+// content tree: their paths, as requested ("/dir/file"), the precomputed
+// response headers, and the bodies (each one page-aligned, so that it can be
+// sent with "sendfile" or directly from the mapping). The paths are indexed
+// by a minimal perfect hash ("hash and displace"): a path is hashed into a
+// bucket, whose displacement gives its slot in the table of entries, so a
+// lookup is 2 hashes and 1 comparison, with no system calls. Opening the
+// archive only maps it, whatever the number of files.
+// The layout (native byte order and alignment; all offsets are from the
+// start of the archive):
+//
+//   ContentPackHdr
+//   int32_t          Displacements[m_nBuckets]
+//   ContentPackEntry Entries      [m_nFiles]  (by slot)
+//   Paths and headers (not 0-terminated)
+//   Bodies (from "m_bodiesOff"), each one at a page boundary
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------//
+// Archive Format:                                                           //
+//---------------------------------------------------------------------------//
+// The displacement of a bucket is 0 if no paths hash into it; if > 0, the
+// paths of the bucket are in the slots "ContentPackHash(path, seed + d) %
+// m_nFiles"; if < 0, the bucket has 1 path, in the slot (-d - 1):
+//
+#define ContentPackMagic "SFMTMPK\001"
+
+typedef struct ContentPackHdr
+{
+  char      m_magic[8];
+  uint64_t  m_size;         // Of the whole archive, in bytes
+  uint64_t  m_seed;         // Of the perfect hash
+  uint64_t  m_nFiles;
+  uint64_t  m_nBuckets;
+  uint64_t  m_dispOff;
+  uint64_t  m_entriesOff;
+  uint64_t  m_strsOff;
+  uint64_t  m_bodiesOff;    // Page-aligned; the index is before it
+} ContentPackHdr;
+
+typedef struct ContentPackEntry
+{
+  uint64_t  m_pathOff;
+  uint64_t  m_hdrOff[2];    // [0]: "Connection: Close", [1]: "Keep-Alive"
+  uint64_t  m_bodyOff;
+  uint64_t  m_bodySize;
+  uint32_t  m_pathLen;
+  uint16_t  m_hdrLen[2];
+} ContentPackEntry;
+
+//---------------------------------------------------------------------------//
+// "ContentPackHash": Seeded 64-bit Hash (FNV-1a, with a final mix):         //
+//---------------------------------------------------------------------------//
+static inline uint64_t ContentPackHash(char const* a_data, size_t a_len,
+                                       uint64_t a_seed)
+{
+  uint64_t h = 0xCBF29CE484222325ULL ^ (a_seed * 0x9E3779B97F4A7C15ULL);
+  for (size_t i = 0; i < a_len; ++i)
+    h = (h ^ (unsigned char) a_data[i]) * 0x100000001B3ULL;
+  // MurmurHash3 "fmix64", so that all bits of "h" depend on all bytes:
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+//---------------------------------------------------------------------------//
+// "ContentPack": An Open (Mapped) Archive:                                  //
+//---------------------------------------------------------------------------//
+typedef struct ContentPack
+{
+  int                     m_fd;       // Kept open, for "sendfile"
+  char const*             m_base;
+  size_t                  m_size;
+  ContentPackHdr const*   m_hdr;
+  int32_t const*          m_disp;
+  ContentPackEntry const* m_entries;
+} ContentPack;
+
+//---------------------------------------------------------------------------//
+// "ContentPackOpen", "ContentPackClose":                                    //
+//---------------------------------------------------------------------------//
+// "ContentPackOpen" checks the header and the index bounds (the per-file
+// offsets are checked by "ContentPackFind"). Returns 0 on success, (-1) on
+// error (with "errno" set; EINVAL: not a valid archive):
+//
+extern int  ContentPackOpen (ContentPack* a_pack, char const* a_path);
+extern void ContentPackClose(ContentPack* a_pack);
+
+//---------------------------------------------------------------------------//
+// "ContentPackFind":                                                        //
+//---------------------------------------------------------------------------//
+// The entry of the path "a_path" (of "a_len" bytes, eg "/dir/file"), or NULL
+// if it is not in the archive (or the entry is out of its bounds):
+//
+extern ContentPackEntry const* ContentPackFind
+  (ContentPack const* a_pack, char const* a_path, size_t a_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,177 @@
+// vim:ts=2:et
+//===========================================================================//
+//                             "CoroPipeline.cpp":                           //
+//       Test for Coroutine-Based Pipelines running on the Thread Pool       //
+//===========================================================================//
+#include "ThreadPool.hpp"
+#include "ThreadPoolCoro.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <sched.h>
+
+namespace
+{
+  //=========================================================================//
+  // "Collatz": CPU-Bound Stage: Total Collatz Path Length for a Range:      //
+  //=========================================================================//
+  struct WorkItem
+  {
+    long m_from;
+    long m_to;
+  };
+
+  long Collatz(WorkItem a_wi)
+  {
+    long total = 0;
+    for (long n = a_wi.m_from; n < a_wi.m_to; ++n)
+      for (long x = n; x > 1; ++total)
+        x = (x % 2 == 0) ? (x / 2) : (3 * x + 1);
+    return total;
+  }
+
+  //=========================================================================//
+  // "Request": A Pipeline of 2 CPU Stages, awaited without blocking:        //
+  //=========================================================================//
+  template<typename TP>
+  SiriusFMTM::Task<long> Request(TP& a_tp, long a_i, long a_len)
+  {
+    // Hop onto a Worker Thread:
+    co_await a_tp.Schedule();
+
+    // Both stages are jobs on the Pool; this Coroutine is resumed by the
+    // Worker which completes each of them:
+    long first  = co_await a_tp.Async(WorkItem{ a_i * a_len,
+                                                a_i * a_len + a_len / 2 });
+    long second = co_await a_tp.Async(WorkItem{ a_i * a_len + a_len / 2,
+                                                a_i * a_len + a_len     });
+    co_return first + second;
+  }
+
+  //=========================================================================//
+  // "RunPipeline": N Requests on a Pool of T Threads; returns the time:     //
+  //=========================================================================//
+  // "Stats" is the Pool's Instrumentation Policy:
+  //
+  template<typename Stats>
+  double RunPipeline(long a_n, int a_t, long a_len, long* a_total)
+  {
+    using TP = SiriusFMTM::ThreadPool<WorkItem, long, decltype(Collatz),
+                                      Stats>;
+    // Each Request may have 1 Schedule or Async job queued at any time:
+    TP tp(size_t(a_t), size_t(a_n + 1), Collatz);
+
+    timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    std::vector<SiriusFMTM::Task<long>> reqs;
+    for (long i = 0; i < a_n; ++i)
+      reqs.push_back(Request(tp, i, a_len));
+
+    std::vector<long> res =
+      SiriusFMTM::SyncWait(SiriusFMTM::WhenAll(std::move(reqs)));
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    *a_total = 0;
+    for (long r: res)
+      *a_total += r;
+    return double(t1.tv_sec  - t0.tv_sec) +
+           double(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+  }
+
+  //=========================================================================//
+  // "MoveOnlyCheck": Move-Only WorkItems and Failed Submits:                //
+  //=========================================================================//
+  // A WorkItem which did not fit in its (full) lane must stay with the
+  // caller, so that it can be re-submitted:
+  //
+  bool MoveOnlyCheck()
+  {
+    using Payload = std::unique_ptr<long>;
+    std::atomic<bool> hold(true);
+    auto func = [&hold](Payload a_p) -> long
+    {
+      while (hold.load())
+        sched_yield();
+      return (a_p != nullptr) ? *a_p : (-1);
+    };
+    using MTP = SiriusFMTM::ThreadPool<Payload, long, decltype(func)>;
+    MTP              tp(1, 1, func);
+    long             res   [3] = { 0, 0, 0 };
+    MTP::JobStatusE  status[3];
+
+    // Job 0 occupies the only Worker, Job 1 fills the lane:
+    (void) tp.Submit(std::make_unique<long>(1), res, status);
+    while (status[0] != MTP::JobStatusE::InProcessing)
+      sched_yield();
+    (void) tp.Submit(std::make_unique<long>(2), res + 1, status + 1);
+
+    Payload p = std::make_unique<long>(3);
+    bool    rejected = !tp.Submit(std::move(p), res + 2, status + 2) &&
+                       p != nullptr;
+    hold = false;
+    while (!tp.Submit(std::move(p), res + 2, status + 2))
+      sched_yield();
+    for (int i = 0; i < 3; ++i)
+      while (status[i] != MTP::JobStatusE::Completed &&
+             status[i] != MTP::JobStatusE::Failed)
+        sched_yield();
+    return rejected && p == nullptr &&
+           res[0] == 1 && res[1] == 2 && res[2] == 3;
+  }
+}
+
+//===========================================================================//
+// "main":                                                                   //
+//===========================================================================//
+int main(int argc, char* argv[])
+{
+  // Params: NRequests NThreads [Len]
+  if (argc < 3)
+  {
+    std::cerr << "Params: NRequests NThreads [Len]" << std::endl;
+    return 1;
+  }
+  long N   = atol(argv[1]);
+  int  T   = atoi(argv[2]);
+  long Len = (argc >= 4) ? atol(argv[3]) : 10000;
+  if (N <= 0 || T <= 0 || Len < 2)
+  {
+    std::cerr << "Invalid NRequests, NThreads or Len" << std::endl;
+    return 1;
+  }
+
+  if (!MoveOnlyCheck())
+  {
+    std::cerr << "ERROR: Move-only WorkItem lost on a failed Submit"
+              << std::endl;
+    return 1;
+  }
+
+  // The same Pipeline w/o and with the Pool instrumentation (interleaved,
+  // best of 3), to measure its overhead. A small "Len" makes the jobs short,
+  // so that it is not hidden by the Collatz computations:
+  double noStats = 0.0, poolStats = 0.0;
+  long   total   = 0,   total2    = 0;
+  for (int r = 0; r < 3; ++r)
+  {
+    double t0 = RunPipeline<SiriusFMTM::NoStats>  (N, T, Len, &total);
+    double t1 = RunPipeline<SiriusFMTM::PoolStats>(N, T, Len, &total2);
+    noStats   = (r == 0) ? t0 : std::min(noStats,   t0);
+    poolStats = (r == 0) ? t1 : std::min(poolStats, t1);
+  }
+  if (total2 != total)
+  {
+    std::cerr << "ERROR: Different Totals with PoolStats" << std::endl;
+    return 1;
+  }
+  std::cout << "N=" << N << ", Total=" << total << ", Time=" << noStats
+            << " sec, with PoolStats: Time=" << poolStats
+            << " sec, Overhead=" << 100.0 * (poolStats / noStats - 1.0)
+            << '%' << std::endl;
+  return 0;
+}
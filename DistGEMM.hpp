@@ -0,0 +1,159 @@
+// vim:ts=2:et
+//============================================================================//
+//                                 "DistGEMM.hpp":                            //
+//       Coordinator / Worker Protocol for the Distributed Multiplication     //
+//============================================================================//
+// The Coordinator holds A, B and C (N x N); the Workers (P of them, connected
+// over TCP) form a Pr x Pc grid, and Worker (r, c) owns the block of C made
+// of the row band r and the column band c. As in SUMMA, C is accumulated over
+// panels of width "kb" of the inner dimension: for each k-panel, Worker (r, c)
+// gets the panel of A in its row band and the panel of B in its column band
+// (so each panel of A goes to all Workers of a grid row, and each panel of B
+// to all Workers of a grid column), and adds their product to its block.
+// Here the Coordinator is the source of all panels (ie a star, not a tree of
+// Workers forwarding them to each other).
+// Messages are a "DistMsgHdr" followed by "m_len" bytes of payload, in the
+// native byte order (the nodes are assumed to be homogeneous, which is also
+// checked by the "Setup" message):
+//
+//   Coordinator -> Worker: Setup(DistSetup), then for each product:
+//                          Start, Panel(kb, A panel, B panel) x (N/kb),
+//                          Finish; and Quit at the end;
+//   Worker -> Coordinator: Result(C block) after each Finish.
+//
+#pragma once
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // Messages:                                                                //
+  //==========================================================================//
+  enum class DistMsgE: uint32_t
+  {
+    Setup  = 1,
+    Start  = 2,
+    Panel  = 3,
+    Finish = 4,
+    Result = 5,
+    Quit   = 6
+  };
+
+  struct DistMsgHdr
+  {
+    constexpr static uint32_t Magic = 0x53444D4D;   // "SDMM"
+
+    uint32_t m_magic;
+    DistMsgE m_type;
+    uint64_t m_len;     // Of the payload, in bytes
+  };
+
+  // The payload of "Setup": the shape of the Worker's block and panels:
+  struct DistSetup
+  {
+    uint32_t m_types;     // Element types, as given to "-e" (0-based)
+    uint32_t m_inSz;      // sizeof(TIn),  as a check
+    uint32_t m_accSz;     // sizeof(TAcc), as a check
+    uint32_t m_pad;
+    int64_t  m_N;         // Inner dimension (of A and B)
+    int64_t  m_M;         // Rows of the C block
+    int64_t  m_NC;        // Cols of the C block
+    int64_t  m_kb;        // Panel width (the last panel may be narrower)
+    char     m_micro[16]; // Micro-kernel name, as given to "-s"
+  };
+
+  //==========================================================================//
+  // "DistSendAll", "DistRecvAll": Blocking I/O of Exactly "a_n" Bytes:       //
+  //==========================================================================//
+  // Throw "std::runtime_error" on errors, and if the peer closes the socket:
+  //
+  inline void DistSendAll(int a_sd, void const* a_data, size_t a_n,
+                          bool a_more = false)
+  {
+    char const* p = static_cast<char const*>(a_data);
+    while (a_n > 0)
+    {
+      // MSG_MORE: do not send a short segment if more data follow at once:
+      ssize_t rc = send(a_sd, p, a_n, MSG_NOSIGNAL | (a_more ? MSG_MORE : 0));
+      if (rc < 0 && errno == EINTR)
+        continue;
+      if (rc <= 0)
+        throw std::runtime_error
+          (std::string("DistSendAll: ") + strerror(errno));
+      p   += rc;
+      a_n -= size_t(rc);
+    }
+  }
+
+  inline void DistRecvAll(int a_sd, void* a_data, size_t a_n)
+  {
+    char* p = static_cast<char*>(a_data);
+    while (a_n > 0)
+    {
+      ssize_t rc = recv(a_sd, p, a_n, 0);
+      if (rc < 0 && errno == EINTR)
+        continue;
+      if (rc < 0)
+        throw std::runtime_error
+          (std::string("DistRecvAll: ") + strerror(errno));
+      if (rc == 0)
+        throw std::runtime_error("DistRecvAll: Connection closed by peer");
+      p   += rc;
+      a_n -= size_t(rc);
+    }
+  }
+
+  //==========================================================================//
+  // "DistSendHdr", "DistRecvHdr":                                            //
+  //==========================================================================//
+  // The payload (if any) must follow the header at once:
+  //
+  inline void DistSendHdr(int a_sd, DistMsgE a_type, size_t a_len = 0)
+  {
+    DistMsgHdr hdr { DistMsgHdr::Magic, a_type, a_len };
+    DistSendAll(a_sd, &hdr, sizeof(hdr), a_len > 0);
+  }
+
+  inline DistMsgHdr DistRecvHdr(int a_sd)
+  {
+    DistMsgHdr hdr;
+    DistRecvAll(a_sd, &hdr, sizeof(hdr));
+    if (hdr.m_magic != DistMsgHdr::Magic)
+      throw std::runtime_error("DistRecvHdr: Invalid message");
+    return hdr;
+  }
+
+  //==========================================================================//
+  // "DistGrid": Pr x Pc Grid of P Workers:                                   //
+  //==========================================================================//
+  // As square as possible (Pr <= Pc); Worker "w" is at (w / Pc, w % Pc):
+  //
+  struct DistGrid
+  {
+    int m_Pr;
+    int m_Pc;
+
+    explicit DistGrid(int a_P)
+    : m_Pr(1),
+      m_Pc(a_P)
+    {
+      for (int r = 1; r * r <= a_P; ++r)
+        if (a_P % r == 0)
+        {
+          m_Pr = r;
+          m_Pc = a_P / r;
+        }
+    }
+
+    // The band "a_b" of "a_nBands" bands of [0, a_N):
+    static long BandBegin(long a_N, int a_nBands, int a_b)
+      { return a_N * a_b / a_nBands; }
+  };
+} // End namespace SiriusFMTM
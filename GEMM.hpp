@@ -0,0 +1,267 @@
+// vim:ts=2:et
+//============================================================================//
+//                                  "GEMM.hpp":                               //
+//          Cache-Blocked, Packed General Matrix Multiplication (GEMM)        //
+//============================================================================//
+// C = A * B, all matrices row-major, with the classical 5-loop structure:
+//
+//   for jc in [0, N) step NC:          // B panel:   KC x NC, in L3
+//     for pc in [0, K) step KC:        //   packed into "Bp"
+//       for ic in [0, M) step MC:      // A block:   MC x KC, in L2
+//         for jr in [0, NC) step NR:   //   packed into "Ap"
+//           for ir in [0, MC) step MR: // Micro-Kernel: MR x NR block of C,
+//             ...                      //   held in registers; KC x NR sliver
+//                                      //   of "Bp" in L1
+// Packing makes all accesses of the Micro-Kernel contiguous and sequential,
+// and each packed panel of B is re-used for all MC rows of A. The elements
+// of A and B are of type "TIn", those of C (and the accumulators) of "TAcc"
+// (eg float and double, or int8_t and int32_t):
+//
+#pragma once
+#include "HugePages.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "AlignedArray": Uninitialised, Page-Aligned Array (growable):            //
+  //==========================================================================//
+  // Only for trivial types (the contents are NOT preserved on growth). The
+  // memory comes from "HugeAlloc", so large arrays (eg the packed panels of
+  // B) are on huge pages:
+  //
+  template<typename T>
+  class AlignedArray
+  {
+  private:
+    HugeBlock m_block;
+    size_t    m_size;
+
+  public:
+    AlignedArray(): m_block{ nullptr, 0, HugePagesE::Off }, m_size(0) {}
+
+    AlignedArray(AlignedArray const&)            = delete;
+    AlignedArray& operator=(AlignedArray const&) = delete;
+
+    ~AlignedArray() { HugeFree(m_block); }
+
+    // Ensure the capacity of at least "a_n" elements, return the data ptr:
+    T* Reserve(size_t a_n)
+    {
+      if (a_n > m_size)
+      {
+        HugeFree(m_block);
+        m_block = HugeBlock{ nullptr, 0, HugePagesE::Off };
+        m_size  = 0;
+        m_block = HugeAlloc(a_n * sizeof(T));
+        m_size  = a_n;
+      }
+      return Data();
+    }
+
+    T*     Data() const { return static_cast<T*>(m_block.m_data); }
+    size_t Size() const { return m_size; }
+  };
+
+  //==========================================================================//
+  // "GEMMMicroKernel": Descriptor of a Micro-Kernel:                         //
+  //==========================================================================//
+  // The function computes C[MR x NR] += Ap[MR x kc] * Bp[kc x NR], where "Ap"
+  // and "Bp" are packed panels: for each p in [0, kc), MR consecutive entries
+  // of A's column p, and NR consecutive entries of B's row p, resp:
+  //
+  template<typename TIn, typename TAcc = TIn>
+  struct GEMMMicroKernel
+  {
+    using Func = void(long a_kc, TIn const* a_Ap, TIn const* a_Bp,
+                      TAcc* a_C, long a_ldc);
+    int         m_MR;
+    int         m_NR;
+    Func*       m_func;
+    char const* m_name;
+  };
+
+  //--------------------------------------------------------------------------//
+  // "GEMMKernelScalar": Portable (Compiler-Vectorised) Micro-Kernel:         //
+  //--------------------------------------------------------------------------//
+  template<typename TIn, typename TAcc, int MR, int NR>
+  void GEMMKernelScalar(long a_kc, TIn const* a_Ap, TIn const* a_Bp,
+                        TAcc* a_C, long a_ldc)
+  {
+    TAcc ab[MR][NR] = {};
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += NR)
+      for (int i = 0; i < MR; ++i)
+        for (int j = 0; j < NR; ++j)
+          ab[i][j] += TAcc(a_Ap[i]) * TAcc(a_Bp[j]);
+
+    for (int i = 0; i < MR; ++i)
+      for (int j = 0; j < NR; ++j)
+        a_C[i * a_ldc + j] += ab[i][j];
+  }
+
+  template<typename TIn, typename TAcc = TIn>
+  GEMMMicroKernel<TIn, TAcc> GEMMScalarKernel()
+  {
+    return GEMMMicroKernel<TIn, TAcc>
+           { 4, 8, GEMMKernelScalar<TIn, TAcc, 4, 8>, "scalar" };
+  }
+
+  //==========================================================================//
+  // "GEMMBlocking": Block Sizes:                                             //
+  //==========================================================================//
+  struct GEMMBlocking
+  {
+    long m_MC;      // Rows    of an A block  (multiple of MR)
+    long m_KC;      // Depth   of the panels
+    long m_NC;      // Columns of a  B panel  (multiple of NR)
+
+    //------------------------------------------------------------------------//
+    // "ForCaches": Derive the sizes from the actual cache sizes:             //
+    //------------------------------------------------------------------------//
+    // A KC x NR sliver of B should take about 1/2 of L1, an MC x KC block of A
+    // about 1/2 of L2, and a KC x NC panel of B about 1/2 of L3 (where the
+    // sizes are not known, typical values are assumed):
+    //
+    static GEMMBlocking ForCaches(int a_MR, int a_NR, size_t a_elemSz)
+    {
+      long l1 = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+      long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+      long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+      if (l1 <= 0) l1 =   32 * 1024;
+      if (l2 <= 0) l2 =  256 * 1024;
+      if (l3 <= 0) l3 = 4096 * 1024;
+
+      long es = long(a_elemSz);
+      long kc = std::max<long>(l1 / 2 / (a_NR * es), 64);
+      long mc = std::max<long>(l2 / 2 / (kc   * es), a_MR);
+      long nc = std::max<long>(l3 / 2 / (kc   * es), a_NR);
+      return GEMMBlocking{ mc / a_MR * a_MR, kc, nc / a_NR * a_NR };
+    }
+  };
+
+  namespace Detail
+  {
+    //------------------------------------------------------------------------//
+    // "PackA": MC x KC block of A into MR-row panels (0-padded):             //
+    //------------------------------------------------------------------------//
+    template<typename T>
+    void PackA(long a_mc, long a_kc, T const* a_A, long a_lda, int a_MR,
+               T* a_Ap)
+    {
+      for (long ir = 0; ir < a_mc; ir += a_MR)
+      {
+        long mr = std::min<long>(a_MR, a_mc - ir);
+        for (long p = 0; p < a_kc; ++p)
+        {
+          T const* colA = a_A + ir * a_lda + p;
+          long     i    = 0;
+          for (; i < mr;   ++i)
+            *(a_Ap++) = colA[i * a_lda];
+          for (; i < a_MR; ++i)
+            *(a_Ap++) = T(0);
+        }
+      }
+    }
+
+    //------------------------------------------------------------------------//
+    // "PackB": KC x NC panel of B into NR-column slivers (0-padded):         //
+    //------------------------------------------------------------------------//
+    template<typename T>
+    void PackB(long a_kc, long a_nc, T const* a_B, long a_ldb, int a_NR,
+               T* a_Bp)
+    {
+      for (long jr = 0; jr < a_nc; jr += a_NR)
+      {
+        long nr = std::min<long>(a_NR, a_nc - jr);
+        for (long p = 0; p < a_kc; ++p)
+        {
+          T const* rowB = a_B + p * a_ldb + jr;
+          long     j    = 0;
+          for (; j < nr;   ++j)
+            *(a_Bp++) = rowB[j];
+          for (; j < a_NR; ++j)
+            *(a_Bp++) = T(0);
+        }
+      }
+    }
+  } // End namespace Detail
+
+  //==========================================================================//
+  // "GEMM": C[M x N] = A[M x K] * B[K x N]  (or C += A * B):                 //
+  //==========================================================================//
+  // "a_ld*" are the row strides (Leading Dimensions). The packing buffers are
+  // Thread-local, so concurrent calls (on disjoint blocks of C) are OK. With
+  // "a_addToC", the product is added to the existing contents of C:
+  //
+  template<typename TIn, typename TAcc = TIn>
+  void GEMM(long a_M, long a_N, long a_K,
+            TIn const* a_A, long a_lda,
+            TIn const* a_B, long a_ldb,
+            TAcc*      a_C, long a_ldc,
+            GEMMMicroKernel<TIn, TAcc> const& a_kern,
+            GEMMBlocking               const& a_blk,
+            bool                              a_addToC = false)
+  {
+    int const MR = a_kern.m_MR;
+    int const NR = a_kern.m_NR;
+    assert(a_blk.m_MC % MR == 0 && a_blk.m_NC % NR == 0);
+
+    thread_local AlignedArray<TIn>  ApBuff;
+    thread_local AlignedArray<TIn>  BpBuff;
+    thread_local AlignedArray<TAcc> edgeBuff;
+    TIn*  Ap   = ApBuff  .Reserve(size_t(a_blk.m_MC * a_blk.m_KC));
+    TIn*  Bp   = BpBuff  .Reserve(size_t(a_blk.m_KC * a_blk.m_NC));
+    TAcc* edge = edgeBuff.Reserve(size_t(MR * NR));
+
+    if (!a_addToC)
+      for (long i = 0; i < a_M; ++i)
+        std::fill_n(a_C + i * a_ldc, a_N, TAcc(0));
+
+    for (long jc = 0; jc < a_N; jc += a_blk.m_NC)
+    {
+      long nc = std::min(a_blk.m_NC, a_N - jc);
+
+      for (long pc = 0; pc < a_K; pc += a_blk.m_KC)
+      {
+        long kc = std::min(a_blk.m_KC, a_K - pc);
+        Detail::PackB(kc, nc, a_B + pc * a_ldb + jc, a_ldb, NR, Bp);
+
+        for (long ic = 0; ic < a_M; ic += a_blk.m_MC)
+        {
+          long mc = std::min(a_blk.m_MC, a_M - ic);
+          Detail::PackA(mc, kc, a_A + ic * a_lda + pc, a_lda, MR, Ap);
+
+          // Macro-Kernel:
+          for (long jr = 0; jr < nc; jr += NR)
+          {
+            long       nr   = std::min<long>(NR, nc - jr);
+            TIn const* Bpjr = Bp + jr * kc;
+
+            for (long ir = 0; ir < mc; ir += MR)
+            {
+              long       mr   = std::min<long>(MR, mc - ir);
+              TIn const* Apir = Ap + ir * kc;
+              TAcc*      Cij  = a_C + (ic + ir) * a_ldc + (jc + jr);
+
+              if (mr == MR && nr == NR)
+                a_kern.m_func(kc, Apir, Bpjr, Cij, a_ldc);
+              else
+              {
+                // Edge block: compute the full MR x NR block into a temp
+                // buffer, and add only the valid part of it to C:
+                std::fill_n(edge, MR * NR, TAcc(0));
+                a_kern.m_func(kc, Apir, Bpjr, edge, NR);
+                for (long i = 0; i < mr; ++i)
+                  for (long j = 0; j < nr; ++j)
+                    Cij[i * a_ldc + j] += edge[i * NR + j];
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+} // End namespace SiriusFMTM
@@ -0,0 +1,414 @@
+// vim:ts=2:et
+//============================================================================//
+//                               "GEMMKernels.hpp":                           //
+//         SIMD (AVX2 / AVX-512 FMA) GEMM Micro-Kernels, Runtime Dispatch     //
+//============================================================================//
+// The kernels are compiled for their target ISAs via function attributes, so
+// the rest of the program needs no "-m" flags, and one binary runs on any
+// x86-64 CPU: "GEMMSelectKernel" picks the best kernel the curr CPU supports
+// (from CPUID), and checks it against the portable one before use. There is
+// a set of kernels for each supported pair of input / accumulator types:
+//
+//   double -> double,  float -> float,  float -> double,  int8_t -> int32_t
+//
+// The kernels of a set are overloads of "GEMMKernelAVX2", "GEMMKernelAVX512"
+// (of different MR x NR shapes):
+//
+#pragma once
+#include "GEMM.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIRIUSFMTM_GEMM_X86 1
+#endif
+
+namespace SiriusFMTM
+{
+#ifdef SIRIUSFMTM_GEMM_X86
+  //==========================================================================//
+  // "GEMMKernelAVX2": 6 x 8 doubles; 12 YMM accumulators:                    //
+  //==========================================================================//
+  __attribute__((target("avx2,fma")))
+  inline void GEMMKernelAVX2(long a_kc, double const* a_Ap,
+                             double const* a_Bp, double* a_C, long a_ldc)
+  {
+    constexpr int MR = 6;
+    __m256d c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm256_setzero_pd();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 8)
+    {
+      __m256d b0 = _mm256_loadu_pd(a_Bp);
+      __m256d b1 = _mm256_loadu_pd(a_Bp + 4);
+      for (int i = 0; i < MR; ++i)
+      {
+        __m256d a = _mm256_broadcast_sd(a_Ap + i);
+        c[i][0]   = _mm256_fmadd_pd(a, b0, c[i][0]);
+        c[i][1]   = _mm256_fmadd_pd(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      double* Ci = a_C + i * a_ldc;
+      _mm256_storeu_pd(Ci,     _mm256_add_pd(_mm256_loadu_pd(Ci),     c[i][0]));
+      _mm256_storeu_pd(Ci + 4, _mm256_add_pd(_mm256_loadu_pd(Ci + 4), c[i][1]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX512": 12 x 16 doubles; 24 ZMM accumulators:                //
+  //==========================================================================//
+  __attribute__((target("avx512f")))
+  inline void GEMMKernelAVX512(long a_kc, double const* a_Ap,
+                               double const* a_Bp, double* a_C, long a_ldc)
+  {
+    constexpr int MR = 12;
+    __m512d c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm512_setzero_pd();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 16)
+    {
+      __m512d b0 = _mm512_loadu_pd(a_Bp);
+      __m512d b1 = _mm512_loadu_pd(a_Bp + 8);
+      for (int i = 0; i < MR; ++i)
+      {
+        __m512d a = _mm512_set1_pd(a_Ap[i]);
+        c[i][0]   = _mm512_fmadd_pd(a, b0, c[i][0]);
+        c[i][1]   = _mm512_fmadd_pd(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      double* Ci = a_C + i * a_ldc;
+      _mm512_storeu_pd(Ci,     _mm512_add_pd(_mm512_loadu_pd(Ci),     c[i][0]));
+      _mm512_storeu_pd(Ci + 8, _mm512_add_pd(_mm512_loadu_pd(Ci + 8), c[i][1]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX2": 6 x 16 floats; 12 YMM accumulators:                    //
+  //==========================================================================//
+  __attribute__((target("avx2,fma")))
+  inline void GEMMKernelAVX2(long a_kc, float const* a_Ap,
+                             float const* a_Bp, float* a_C, long a_ldc)
+  {
+    constexpr int MR = 6;
+    __m256 c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm256_setzero_ps();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 16)
+    {
+      __m256 b0 = _mm256_loadu_ps(a_Bp);
+      __m256 b1 = _mm256_loadu_ps(a_Bp + 8);
+      for (int i = 0; i < MR; ++i)
+      {
+        __m256 a = _mm256_broadcast_ss(a_Ap + i);
+        c[i][0]  = _mm256_fmadd_ps(a, b0, c[i][0]);
+        c[i][1]  = _mm256_fmadd_ps(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      float* Ci = a_C + i * a_ldc;
+      _mm256_storeu_ps(Ci,     _mm256_add_ps(_mm256_loadu_ps(Ci),     c[i][0]));
+      _mm256_storeu_ps(Ci + 8, _mm256_add_ps(_mm256_loadu_ps(Ci + 8), c[i][1]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX512": 12 x 32 floats; 24 ZMM accumulators:                 //
+  //==========================================================================//
+  __attribute__((target("avx512f")))
+  inline void GEMMKernelAVX512(long a_kc, float const* a_Ap,
+                               float const* a_Bp, float* a_C, long a_ldc)
+  {
+    constexpr int MR = 12;
+    __m512 c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm512_setzero_ps();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 32)
+    {
+      __m512 b0 = _mm512_loadu_ps(a_Bp);
+      __m512 b1 = _mm512_loadu_ps(a_Bp + 16);
+      for (int i = 0; i < MR; ++i)
+      {
+        __m512 a = _mm512_set1_ps(a_Ap[i]);
+        c[i][0]  = _mm512_fmadd_ps(a, b0, c[i][0]);
+        c[i][1]  = _mm512_fmadd_ps(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      float* Ci = a_C + i * a_ldc;
+      for (int h = 0; h < 2; ++h)
+        _mm512_storeu_ps
+          (Ci + 16 * h, _mm512_add_ps(_mm512_loadu_ps(Ci + 16 * h), c[i][h]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX2": 6 x 8, floats into doubles; 12 YMM accumulators:       //
+  //==========================================================================//
+  // The products of floats are exact in double, so only the summation rounds:
+  //
+  __attribute__((target("avx2,fma")))
+  inline void GEMMKernelAVX2(long a_kc, float const* a_Ap,
+                             float const* a_Bp, double* a_C, long a_ldc)
+  {
+    constexpr int MR = 6;
+    __m256d c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm256_setzero_pd();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 8)
+    {
+      __m256d b0 = _mm256_cvtps_pd(_mm_loadu_ps(a_Bp));
+      __m256d b1 = _mm256_cvtps_pd(_mm_loadu_ps(a_Bp + 4));
+      for (int i = 0; i < MR; ++i)
+      {
+        __m256d a = _mm256_set1_pd(double(a_Ap[i]));
+        c[i][0]   = _mm256_fmadd_pd(a, b0, c[i][0]);
+        c[i][1]   = _mm256_fmadd_pd(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      double* Ci = a_C + i * a_ldc;
+      _mm256_storeu_pd(Ci,     _mm256_add_pd(_mm256_loadu_pd(Ci),     c[i][0]));
+      _mm256_storeu_pd(Ci + 4, _mm256_add_pd(_mm256_loadu_pd(Ci + 4), c[i][1]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX512": 12 x 16, floats into doubles; 24 ZMM accumulators:   //
+  //==========================================================================//
+  __attribute__((target("avx512f")))
+  inline void GEMMKernelAVX512(long a_kc, float const* a_Ap,
+                               float const* a_Bp, double* a_C, long a_ldc)
+  {
+    constexpr int MR = 12;
+    __m512d c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm512_setzero_pd();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 16)
+    {
+      // (The "maskz" forms of the conversions, with all the lanes enabled,
+      // avoid a spurious "maybe-uninitialized" warning in GCC's headers):
+      __m512d b0 = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(a_Bp));
+      __m512d b1 = _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(a_Bp + 8));
+      for (int i = 0; i < MR; ++i)
+      {
+        __m512d a = _mm512_set1_pd(double(a_Ap[i]));
+        c[i][0]   = _mm512_fmadd_pd(a, b0, c[i][0]);
+        c[i][1]   = _mm512_fmadd_pd(a, b1, c[i][1]);
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      double* Ci = a_C + i * a_ldc;
+      _mm512_storeu_pd(Ci,     _mm512_add_pd(_mm512_loadu_pd(Ci),     c[i][0]));
+      _mm512_storeu_pd(Ci + 8, _mm512_add_pd(_mm512_loadu_pd(Ci + 8), c[i][1]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX2": 6 x 16, int8_t into int32_t; 12 YMM accumulators:      //
+  //==========================================================================//
+  // The int8 entries of B are sign-extended to int32 on load (so the packed
+  // panels are 4 times smaller than with int32 inputs):
+  //
+  __attribute__((target("avx2")))
+  inline void GEMMKernelAVX2(long a_kc, int8_t const* a_Ap,
+                             int8_t const* a_Bp, int32_t* a_C, long a_ldc)
+  {
+    constexpr int MR = 6;
+    __m256i c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm256_setzero_si256();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 16)
+    {
+      __m128i b  = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a_Bp));
+      __m256i b0 = _mm256_cvtepi8_epi32(b);
+      __m256i b1 = _mm256_cvtepi8_epi32(_mm_srli_si128(b, 8));
+      for (int i = 0; i < MR; ++i)
+      {
+        __m256i a = _mm256_set1_epi32(a_Ap[i]);
+        c[i][0]   = _mm256_add_epi32(c[i][0], _mm256_mullo_epi32(a, b0));
+        c[i][1]   = _mm256_add_epi32(c[i][1], _mm256_mullo_epi32(a, b1));
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      __m256i* Ci = reinterpret_cast<__m256i*>(a_C + i * a_ldc);
+      for (int h = 0; h < 2; ++h)
+        _mm256_storeu_si256
+          (Ci + h, _mm256_add_epi32(_mm256_loadu_si256(Ci + h), c[i][h]));
+    }
+  }
+
+  //==========================================================================//
+  // "GEMMKernelAVX512": 12 x 32, int8_t into int32_t; 24 ZMM accumulators:   //
+  //==========================================================================//
+  __attribute__((target("avx512f")))
+  inline void GEMMKernelAVX512(long a_kc, int8_t const* a_Ap,
+                               int8_t const* a_Bp, int32_t* a_C, long a_ldc)
+  {
+    constexpr int MR = 12;
+    __m512i c[MR][2];
+    for (int i = 0; i < MR; ++i)
+      c[i][0] = c[i][1] = _mm512_setzero_si512();
+
+    for (long p = 0; p < a_kc; ++p, a_Ap += MR, a_Bp += 32)
+    {
+      // (See the "maskz" note above):
+      __m128i const* b  = reinterpret_cast<__m128i const*>(a_Bp);
+      __m512i b0 = _mm512_maskz_cvtepi8_epi32(0xFFFF, _mm_loadu_si128(b));
+      __m512i b1 = _mm512_maskz_cvtepi8_epi32(0xFFFF, _mm_loadu_si128(b + 1));
+      for (int i = 0; i < MR; ++i)
+      {
+        __m512i a = _mm512_set1_epi32(a_Ap[i]);
+        c[i][0]   = _mm512_add_epi32(c[i][0], _mm512_mullo_epi32(a, b0));
+        c[i][1]   = _mm512_add_epi32(c[i][1], _mm512_mullo_epi32(a, b1));
+      }
+    }
+    for (int i = 0; i < MR; ++i)
+    {
+      int32_t* Ci = a_C + i * a_ldc;
+      for (int h = 0; h < 2; ++h)
+        _mm512_storeu_si512
+          (Ci + 16 * h,
+           _mm512_add_epi32(_mm512_loadu_si512(Ci + 16 * h), c[i][h]));
+    }
+  }
+#endif // SIRIUSFMTM_GEMM_X86
+
+  //==========================================================================//
+  // "GEMMKernels": All kernels usable on the curr CPU, the best one first:   //
+  //==========================================================================//
+  template<typename TIn, typename TAcc = TIn>
+  std::vector<GEMMMicroKernel<TIn, TAcc>> GEMMKernels()
+  {
+    using Kern = GEMMMicroKernel<TIn, TAcc>;
+    std::vector<Kern> res;
+#ifdef SIRIUSFMTM_GEMM_X86
+    // The type pairs which have SIMD kernels, and the kernel shapes:
+    constexpr bool IsF64   = std::is_same_v<TIn,  double> &&
+                             std::is_same_v<TAcc, double>;
+    constexpr bool IsF32   = std::is_same_v<TIn,  float>  &&
+                             std::is_same_v<TAcc, float>;
+    constexpr bool IsF32D  = std::is_same_v<TIn,  float>  &&
+                             std::is_same_v<TAcc, double>;
+    constexpr bool IsI8    = std::is_same_v<TIn,  int8_t> &&
+                             std::is_same_v<TAcc, int32_t>;
+    constexpr int  NR512   = (IsF32 || IsI8) ? 32 : 16;
+    constexpr int  NR256   = (IsF32 || IsI8) ? 16 :  8;
+
+    if constexpr (IsF64 || IsF32 || IsF32D || IsI8)
+    {
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx512f"))
+        res.push_back(Kern{ 12, NR512, GEMMKernelAVX512, "avx512" });
+      if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        res.push_back(Kern{  6, NR256, GEMMKernelAVX2,   "avx2"   });
+    }
+#endif
+    res.push_back(GEMMScalarKernel<TIn, TAcc>());
+    return res;
+  }
+
+  //==========================================================================//
+  // "GEMMCheckTol": Default Tolerance for "GEMMSelectKernel":                //
+  //==========================================================================//
+  // The SIMD kernels round differently (FMA, order of summation); the integer
+  // ones must be exact:
+  //
+  template<typename TAcc>
+  constexpr double GEMMCheckTol()
+  {
+    return std::is_integral_v<TAcc>    ? 0.0  :
+           std::is_same_v<TAcc, float> ? 1e-4 : 1e-12;
+  }
+
+  //==========================================================================//
+  // "GEMMCheckKernel":                                                       //
+  //==========================================================================//
+  // Multiplies random matrices (of sizes which are not multiples of any MR,
+  // NR) with "a_kern" and with the portable kernel; returns the max relative
+  // difference:
+  //
+  template<typename TIn, typename TAcc>
+  double GEMMCheckKernel(GEMMMicroKernel<TIn, TAcc> const& a_kern)
+  {
+    long const M = 67, N = 53, K = 131;
+    std::mt19937_64                        gen(12345);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<TIn>  A(M * K), B(K * N);
+    std::vector<TAcc> C(M * N), Cref(M * N);
+
+    // Integers are taken from the whole range of int8_t:
+    auto rnd = [&]() -> TIn
+    {
+      double x = dist(gen);
+      return std::is_integral_v<TIn> ? TIn(std::round(x * 127.0)) : TIn(x);
+    };
+    for (TIn& a: A) a = rnd();
+    for (TIn& b: B) b = rnd();
+
+    GEMMMicroKernel<TIn, TAcc> scalar = GEMMScalarKernel<TIn, TAcc>();
+    // Small blocks, so that all the edge cases are exercised:
+    GEMMBlocking blk { 4 * a_kern.m_MR, 32, 2 * a_kern.m_NR };
+    GEMMBlocking ref { 4 * scalar.m_MR, 32, 2 * scalar.m_NR };
+    GEMM<TIn, TAcc>(M, N, K, A.data(), K, B.data(), N, C.data(),    N,
+                    a_kern, blk);
+    GEMM<TIn, TAcc>(M, N, K, A.data(), K, B.data(), N, Cref.data(), N,
+                    scalar, ref);
+
+    double err = 0.0;
+    for (size_t n = 0; n < size_t(M * N); ++n)
+    {
+      double c = double(C[n]);
+      double r = double(Cref[n]);
+      err      = std::max(err, std::fabs(c - r) / std::max(std::fabs(r), 1.0));
+    }
+    return err;
+  }
+
+  //==========================================================================//
+  // "GEMMSelectKernel":                                                      //
+  //==========================================================================//
+  // "a_name" is "auto" (the best one available) or a kernel name. A SIMD
+  // kernel which disagrees with the portable one by more than "a_tol" is not
+  // used. Throws "std::invalid_argument" if the named one is not available:
+  //
+  template<typename TIn, typename TAcc = TIn>
+  GEMMMicroKernel<TIn, TAcc> GEMMSelectKernel
+    (char const* a_name, double a_tol = GEMMCheckTol<TAcc>())
+  {
+    bool isAuto = (strcmp(a_name, "auto") == 0);
+    for (GEMMMicroKernel<TIn, TAcc> const& kern: GEMMKernels<TIn, TAcc>())
+    {
+      if (!isAuto && strcmp(a_name, kern.m_name) != 0)
+        continue;
+      if (strcmp(kern.m_name, "scalar") == 0 || GEMMCheckKernel(kern) <= a_tol)
+        return kern;
+      if (!isAuto)
+        break;
+    }
+    throw std::invalid_argument
+      (std::string("GEMMSelectKernel: Kernel not available or incorrect: ") +
+       a_name);
+  }
+} // End namespace SiriusFMTM
@@ -5,6 +5,7 @@
 //===========================================================================//
 #include "ServerSetup.h"
 #include "ProcessHTTPReqs.h"
+#include "ReqTrace.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -17,6 +18,10 @@
 //===========================================================================//
 int main(int argc, char* argv[])
 {
+  // The ContentPack, if any, must be opened before "ServerSetup" (chroot):
+  if (ProcessHTTPReqsSetup(argc, argv) != 0)
+    return 1;
+
   int sd  = ServerSetup(argc, argv);
   if (sd < 0)
     return 1;
@@ -24,9 +29,10 @@ int main(int argc, char* argv[])
   // Acceptor Loop:
   while (1)
   {
-    // Accept a connection, create a data exchange socket:
-    int sd1 = accept(sd, NULL, NULL);
-    if (sd1 < 0)
+    // Accept connection(s), create data exchange socket(s):
+    int sds[ServerMaxAcceptBatch];
+    int n = ServerAccept(sd, sds, ServerMaxAcceptBatch);
+    if (n < 0)
     {
       // Some error in "accept", but may be not really serious:
       if (errno == EINTR)
@@ -38,10 +44,15 @@ int main(int argc, char* argv[])
                strerror(errno), errno);
       return 1;
     }
+    // Note the accept time of the connections sampled for tracing:
+    for (int i = 0; i < n; ++i)
+      ReqTraceAccepted(sds[i]);
+
     // XXX: Clients are services SEQUNTIALLY. If the currently-connected client
     // sends multiple reqs, all other clients will be locked out until this one
     // disconnects:
-    (void) ProcessHTTPReqs(sd1);
+    for (int i = 0; i < n; ++i)
+      (void) ProcessHTTPReqs(sds[i]);
   }
   return 0;
 }
@@ -5,6 +5,7 @@
 //===========================================================================//
 #include "ServerSetup.h"
 #include "ProcessHTTPReqs.h"
+#include "ReqTrace.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -24,6 +25,10 @@ static void SigHandler(int a_signum);
 //===========================================================================//
 int main(int argc, char* argv[])
 {
+  // The ContentPack, if any, must be opened before "ServerSetup" (chroot):
+  if (ProcessHTTPReqsSetup(argc, argv) != 0)
+    return 1;
+
   // Get the Acceptor Socket:
   int sd = ServerSetup(argc, argv);
   if (sd < 0)
@@ -37,9 +42,10 @@ int main(int argc, char* argv[])
   // Acceptor Loop:
   while (1)
   {
-    // Accept a connection, create a data exchange socket:
-    int sd1 = accept(sd, NULL, NULL);
-    if (sd1 < 0)
+    // Accept connection(s), create data exchange socket(s):
+    int sds[ServerMaxAcceptBatch];
+    int n = ServerAccept(sd, sds, ServerMaxAcceptBatch);
+    if (n < 0)
     {
       // Some error in "accept", but may be not really serious:
       if (errno == EINTR)
@@ -51,17 +57,27 @@ int main(int argc, char* argv[])
                strerror(errno), errno);
       return 1;
     }
+    // Note the accept time of the connections sampled for tracing:
+    for (int i = 0; i < n; ++i)
+      ReqTraceAccepted(sds[i]);
 
-    // Create a new process which will deal with the connected client:
-    if (fork() == 0)
-      // This is a Child Process which will actually service the request, and
-      // then terminate:
-      return ProcessHTTPReqs(sd1);
-
-    // In parent: close the socket "sd1", otherwise it will not be fully closed
-    // in child:
-    close(sd1);
-
+    for (int i = 0; i < n; ++i)
+    {
+      // Create a new process which will deal with the connected client:
+      if (fork() == 0)
+      {
+        // This is a Child Process which will actually service the request,
+        // and then terminate. It must not hold the rest of the batch (the
+        // earlier ones are already closed), or those connections would not
+        // be fully closed until it exits:
+        for (int j = i + 1; j < n; ++j)
+          close(sds[j]);
+        return ProcessHTTPReqs(sds[i]);
+      }
+      // In parent: close the socket, otherwise it will not be fully closed in
+      // child:
+      close(sds[i]);
+    }
     // Parent proceeds to the next "accept" immediately!
   }
   return 0;
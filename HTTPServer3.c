@@ -5,6 +5,8 @@
 //===========================================================================//
 #include "ServerSetup.h"
 #include "ProcessHTTPReqs.h"
+#include "ReqTrace.h"
+#include "BufferPool.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -14,49 +16,102 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <signal.h>
+#include <stdint.h>
+#include <limits.h>
 #include <assert.h>
 #include <pthread.h>
 
 static void* ThreadBody(void* a_arg);
+static void  SigHandler(int   a_signum);
+
+static volatile sig_atomic_t s_printStats = 0;
 
 //===========================================================================//
 // "main":                                                                   //
 //===========================================================================//
 int main(int argc, char* argv[])
 {
+  // The ContentPack, if any, must be opened before "ServerSetup" (chroot):
+  if (ProcessHTTPReqsSetup(argc, argv) != 0)
+    return 1;
+
   // Get the Acceptor Socket:
   int sd = ServerSetup(argc, argv);
   if (sd < 0)
     return 1;
 
+  // Optional param: Thread Stack Size in KB. All I/O buffers come from the
+  // BufferPool, so the Threads need much less than the default (8 MB):
+  long stackKB = (argc >= 3) ? atol(argv[2]) : 128;
+  if (stackKB * 1024 < PTHREAD_STACK_MIN)
+  {
+    fputs("ERROR: ThreadStackKB is too small\n", stderr);
+    return 1;
+  }
+  // The Threads are never joined, so make them detached, otherwise their
+  // resources (incl the stacks) are never released:
+  pthread_attr_t attr;
+  if (pthread_attr_init        (&attr) != 0 ||
+      pthread_attr_setstacksize(&attr, (size_t) stackKB * 1024) != 0 ||
+      pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0)
+  {
+    fputs("ERROR: Cannot set the Thread attributes\n", stderr);
+    return 1;
+  }
+
+  // SIGUSR1 prints the BufferPool stats. No SA_RESTART, so that "accept" is
+  // interrupted and the stats are printed from the main loop (not from the
+  // handler):
+  struct sigaction sa;
+  memset(&sa, '\0', sizeof(sa));
+  sa.sa_handler = SigHandler;
+  (void) sigaction(SIGUSR1, &sa, NULL);
+
   // Acceptor Loop:
   while (1)
   {
-    // Accept a connection, create a data exchange socket:
-    int sd1 = accept(sd, NULL, NULL);
-    if (sd1 < 0)
+    // Accept connection(s), create data exchange socket(s):
+    int sds[ServerMaxAcceptBatch];
+    int n = ServerAccept(sd, sds, ServerMaxAcceptBatch);
+    if (n < 0)
     {
       // Some error in "accept", but may be not really serious:
       if (errno == EINTR)
+      {
         // "accept" was interrupted by a signal, this is OK, just continue:
+        if (s_printStats)
+        {
+          s_printStats = 0;
+          BufferPoolPrintStats(stderr);
+        }
         continue;
+      }
 
       // Any other error:
       fprintf (stderr, "ERROR: accept failed: %s, errno=%d\n",
                strerror(errno), errno);
       return 1;
     }
+    // Note the accept time of the connections sampled for tracing:
+    for (int i = 0; i < n; ++i)
+      ReqTraceAccepted(sds[i]);
 
-    // Create a new thread which will deal with the connected client:
-    // XXX: The thread will be created with default attributes:
-    pthread_t th;   // Thread Handle
-
-    int rc = pthread_create(&th, NULL, ThreadBody, &sd1);
-    if (rc < 0)
+    // Create a new thread which will deal with each connected client. The
+    // socket is passed by value: the next "accept" may overwrite "sds" before
+    // the thread reads it:
+    for (int i = 0; i < n; ++i)
     {
-      fprintf(stderr, "ERROR: pthread_create failed: %s, errno=%d\n",
-              strerror(errno), errno);
-      return 1;
+      pthread_t th;   // Thread Handle
+
+      int rc = pthread_create(&th, &attr, ThreadBody,
+                              (void*) (intptr_t) sds[i]);
+      if (rc != 0)
+      {
+        fprintf(stderr, "ERROR: pthread_create failed: %s, errno=%d\n",
+                strerror(rc), rc);
+        return 1;
+      }
     }
     // Parent proceeds to the next "accept" immediately!
   }
@@ -68,11 +123,19 @@ int main(int argc, char* argv[])
 //===========================================================================//
 void* ThreadBody(void* a_arg)
 {
-  // "a_arg" is actually a ptr to client-communicating socket descr sd1:
-  assert    (a_arg != NULL);
-  int const* sd1ptr = (int const*) a_arg;
-  int  sd1 = *sd1ptr;
+  // "a_arg" is actually the client-communicating socket descr sd1:
+  int sd1 = (int) (intptr_t) a_arg;
+  assert(sd1 >= 0);
 
   (void) ProcessHTTPReqs(sd1);
   return NULL;    // The return value is not used
 }
+
+//===========================================================================//
+// "SigHandler":                                                             //
+//===========================================================================//
+void SigHandler(int a_signum)
+{
+  assert(a_signum == SIGUSR1);
+  s_printStats = 1;
+}
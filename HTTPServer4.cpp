@@ -5,7 +5,9 @@
 //===========================================================================//
 #include "ServerSetup.h"
 #include "ProcessHTTPReqs.h"
+#include "ReqTrace.h"
 #include "ThreadPool.hpp"
+#include <signal.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -16,52 +18,137 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <assert.h>
+#include <iostream>
+
+namespace
+{
+  volatile sig_atomic_t s_printStats = 0;
+
+  //=========================================================================//
+  // "SigHandler":                                                           //
+  //=========================================================================//
+  void SigHandler(int a_signum)
+  {
+    assert(a_signum == SIGUSR1);
+    s_printStats = 1;
+  }
+
+  //=========================================================================//
+  // "PrintStats": Pool Size, and the Instrumentation Snapshot (as JSON):    //
+  //=========================================================================//
+  template<typename TP>
+  void PrintStats(TP const& a_tp)
+  {
+    typename TP::SizeCounters sc = a_tp.GetSizeCounters();
+    fprintf(stderr, "INFO: Pool: Threads=%zu, Idle=%zu, Grown=%lu, "
+            "Shrunk=%lu\n", sc.m_nThreads, sc.m_nIdle, sc.m_nGrown,
+            sc.m_nShrunk);
+    std::cerr << "INFO: PoolStats: ";
+    a_tp.GetStats().ToJSON(std::cerr);
+    std::cerr << std::endl;
+  }
+
+  //=========================================================================//
+  // "Serve": The Acceptor Loop, with the given Instrumentation Policy:      //
+  //=========================================================================//
+  template<typename Stats>
+  int Serve(int a_sd, int a_min_threads, int a_buff_size, int a_max_threads)
+  {
+    // WorkItem=int, Res=void:
+    // This immediately starts the WorkerTheads:
+    using TP = SiriusFMTM::ThreadPool<int, void, decltype(ProcessHTTPReqs),
+                                      Stats>;
+    TP tp(size_t(a_min_threads), size_t(a_buff_size), ProcessHTTPReqs);
+
+    // A connection occupies its Worker until the client disconnects, so grow
+    // the Pool when Workers are blocked for more than 10 msec, or a
+    // connection has been waiting in the queue for more than 1 msec; retire
+    // the extra Threads after 30 sec of idleness:
+    tp.SetElastic
+      (typename TP::ElasticConfig{size_t(a_max_threads), 1000, 10000, 30000});
+
+    // Acceptor Loop:
+    while (1)
+    {
+      // Accept connection(s), create data exchange socket(s):
+      int sds[ServerMaxAcceptBatch];
+      int n = ServerAccept(a_sd, sds, ServerMaxAcceptBatch);
+      if (s_printStats)
+      {
+        s_printStats = 0;
+        PrintStats(tp);
+      }
+      if (n < 0)
+      {
+        // Some error in "accept", but may be not really serious:
+        if (errno == EINTR)
+          // "accept" was interrupted by a signal, this is OK, just continue:
+          continue;
+
+        // Any other error:
+        fprintf (stderr, "ERROR: accept failed: %s, errno=%d\n",
+                 strerror(errno), errno);
+        return 1;
+      }
+      // Note the accept time of the connections sampled for tracing:
+      for (int i = 0; i < n; ++i)
+        ReqTraceAccepted(sds[i]);
+
+      // Submit asynchronous jobs to the ThreadPool. We don't need a result or
+      // comletion status:
+      for (int i = 0; i < n; ++i)
+      {
+        bool rc = tp.Submit(sds[i]);
+        if (!rc)
+        {
+          fprintf(stderr, "ERROR: Could not submit SD=%d to ThreadPool\n",
+                  sds[i]);
+          close(sds[i]);
+        }
+      }
+    }
+    return 0;
+  }
+}
 
 //===========================================================================//
 // "main":                                                                   //
 //===========================================================================//
 int main(int argc, char* argv[])
 {
-  // Args: ServerPort [ThreadPoolSize [BuffSize]]
+  // Args: ServerPort[:ContentPack] [MinThreads [BuffSize [MaxThreads]]]
+  // The ContentPack, if any, must be opened before "ServerSetup" (chroot):
+  if (ProcessHTTPReqsSetup(argc, argv) != 0)
+    return 1;
+
   // Get the Acceptor Socket:
   int sd = ServerSetup(argc, argv);
   if (sd < 0)
     return 1;
 
-  // Create the Pool of Threads: Default PoolSize is 128, BuffSize is 8192:
-  int poolSize = (argc >= 3) ? atoi(argv[2]) :  128;
-  int buffSize = (argc >= 4) ? atoi(argv[3]) : 8192;
-
-  // WorkItem=int, Res=void:
-  // This immediately starts the WorkerTheads:
-  SiriusFMTM::ThreadPool<int, void, decltype(ProcessHTTPReqs)> tp
-    (size_t(poolSize), size_t(buffSize), ProcessHTTPReqs);
-
-  // Acceptor Loop:
-  while (1)
+  // Create the Pool of Threads: Default PoolSize is 8..1024, BuffSize is 8192:
+  int minThreads = (argc >= 3) ? atoi(argv[2]) :    8;
+  int buffSize   = (argc >= 4) ? atoi(argv[3]) : 8192;
+  int maxThreads = (argc >= 5) ? atoi(argv[4]) : 1024;
+  if (minThreads <= 0 || buffSize <= 1 || maxThreads < minThreads)
   {
-    // Accept a connection, create a data exchange socket:
-    int sd1 = accept(sd, NULL, NULL);
-    if (sd1 < 0)
-    {
-      // Some error in "accept", but may be not really serious:
-      if (errno == EINTR)
-        // "accept" was interrupted by a signal, this is OK, just continue:
-        continue;
-
-      // Any other error:
-      fprintf (stderr, "ERROR: accept failed: %s, errno=%d\n",
-               strerror(errno), errno);
-      return 1;
-    }
-    // Submit an asynchronous job to the ThreadPool. We don't need a result or
-    // comletion status:
-    bool rc = tp.Submit(sd1);
-    if (!rc)
-    {
-      fprintf(stderr, "ERROR: Could not submit SD=%d to ThreadPool\n", sd1);
-      close(sd1);
-    }
+    fputs("ERROR: Invalid MinThreads, BuffSize or MaxThreads\n", stderr);
+    return 1;
   }
-  return 0;
+
+  // SIGUSR1 prints the Pool size and, if the env var "POOL_STATS" is set
+  // (and not "0"), its instrumentation ("PoolStats"). No SA_RESTART, so that
+  // "accept" is interrupted and the stats are printed from the main loop
+  // (not from the handler; if a Worker gets the signal, after the next
+  // "accept"):
+  struct sigaction sa;
+  memset(&sa, '\0', sizeof(sa));
+  sa.sa_handler = SigHandler;
+  (void) sigaction(SIGUSR1, &sa, NULL);
+
+  char const* stats = getenv("POOL_STATS");
+  if (stats != NULL && *stats != '\0' && strcmp(stats, "0") != 0)
+    return Serve<SiriusFMTM::PoolStats>
+           (sd, minThreads, buffSize, maxThreads);
+  return Serve<SiriusFMTM::NoStats>(sd, minThreads, buffSize, maxThreads);
 }
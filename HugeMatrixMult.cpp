@@ -4,142 +4,2599 @@
 //   Performance Test for Muti-Threaded Matrix Multiplication and Addition   //
 //===========================================================================//
 #include "ThreadPool.hpp"
+#include "GEMM.hpp"
+#include "GEMMKernels.hpp"
+#include "MappedFile.hpp"
+#include "HugePages.hpp"
+#include "PerfCounter.hpp"
+#include "Strassen.hpp"
+#include "Philox.hpp"
+#include "Sparse.hpp"
+#include "BatchGEMM.hpp"
+#include "DistGEMM.hpp"
+#include "ServerSetup.h"
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
 
 namespace
 {
   //=========================================================================//
-  // "WorkItem" for Matrix Multiplication and Element Summation:             //
+  // Multiplication Kernels:                                                 //
   //=========================================================================//
+  enum class KernelE
+  {
+    Naive,      // Dot products of A rows and (strided) B columns
+    Blocked,    // Cache-blocked, packed GEMM
+    Strassen,   // Strassen-Winograd, with "Blocked" below the cut-off size
+    SpMM,       // Sparse (CSR) A, dense B
+    SpGEMM,     // Sparse (CSR) A and B, sparse C
+    Batched     // Many small N x N products, size-specialised kernels
+  };
+
+  // As given to "-k":
+  char const* const KernelNames[]
+    { "naive", "blocked", "strassen", "spmm", "spgemm", "batched" };
+
+  //=========================================================================//
+  // Element Types:                                                          //
+  //=========================================================================//
+  // Of A and B ("TIn"), and of C and the accumulators ("TAcc"):
+  //
+  enum class ElemTypesE
+  {
+    F64,        // double -> double
+    F32,        // float  -> float
+    F32F64,     // float  -> double
+    I8I32       // int8_t -> int32_t
+  };
+
+  // As given to "-e":
+  char const* const ElemTypesNames[] { "f64", "f32", "f32f64", "i8i32" };
+
+  //=========================================================================//
+  // "FreivaldsData": Shared by the "FreivaldsJob"s:                         //
+  //=========================================================================//
+  // X is N x k (k random vectors), Y = B*X and AbsY = |B|*|X|, all stored
+  // row by row:
+  //
+  struct FreivaldsData
+  {
+    long          m_k;
+    double const* m_X;
+    double*       m_Y;
+    double*       m_absY;
+  };
+
+  //=========================================================================//
+  // "SparseData": Shared by the "SparseJob"s:                               //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  struct SparseData
+  {
+    SiriusFMTM::CSRMatrix<TIn>  const*        m_A;
+    SiriusFMTM::CSRMatrix<TIn>  const*        m_B;       // For "SpGEMM"
+    TIn                         const*        m_denseB;  // For "SpMM"
+    long                                      m_m;       // Cols of dense B, C
+    TAcc*                                     m_denseC;  // For "SpMM"
+    std::vector<SiriusFMTM::CSRMatrix<TAcc>>* m_bandsC;  // For "SpGEMM"
+    double*                                   m_rowSums; // Per row of C
+  };
+
+  //=========================================================================//
+  // "DistData": Per-Worker Data of the "DistBlockJob"s:                     //
+  //=========================================================================//
+  struct DistData
+  {
+    int  m_sd;        // Socket connected to the Worker
+    long m_kb;        // Panel width
+  };
+
+  //=========================================================================//
+  // Jobs for Matrix Multiplication and Element Summation:                   //
+  //=========================================================================//
+  // 1 type per kind of job, each with only the params it needs; "DoJob" (of
+  // that type) runs it, and returns its result (a sum, or 0).
+  //
+  // "InitJob": fills in the tile [m_i0, m_i1) x [m_j0, m_j1) of A and B (of
+  // "m_N" columns) from "m_seed", and zeroes that of C (unless m_C is NULL);
+  // being the 1st to touch these pages, it places them on the NUMA Node of
+  // the Thread which will later compute the tile:
+  //
+  template<typename TIn, typename TAcc>
+  struct InitJob
+  {
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    long            m_j0;
+    long            m_j1;
+    TIn*            m_A;
+    TIn*            m_B;
+    TAcc*           m_C;
+    unsigned long   m_seed;
+  };
+
+  // "MultiplyJob": computes the tile [m_i0, m_i1) x [m_j0, m_j1) of C, from
+  // the terms k in [m_k0, m_k1) only; if m_k0 > 0, they are added to the
+  // existing contents of the tile (out-of-core mode). With the "Strassen"
+  // kernel, C is already computed, and only the sum is:
+  //
+  template<typename TIn, typename TAcc>
+  struct MultiplyJob
+  {
+    KernelE         m_kernel;
+    SiriusFMTM::GEMMMicroKernel<TIn, TAcc> const* m_micro;  // For "Blocked"
+    SiriusFMTM::GEMMBlocking               const* m_blk;    //
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    long            m_j0;
+    long            m_j1;
+    long            m_k0;
+    long            m_k1;
+    TIn  const*     m_A;
+    TIn  const*     m_B;
+    TAcc*           m_C;
+  };
+
+  // "ReduceJob": sums up m_sums[m_i0 .. m_i1):
+  //
+  struct ReduceJob
+  {
+    double const*   m_sums;
+    long            m_i0;
+    long            m_i1;
+  };
+
+  // "StrassenJob": computes *m_product (only used if TIn == TAcc):
+  //
+  template<typename TIn, typename TAcc>
+  struct StrassenJob
+  {
+    SiriusFMTM::StrassenProduct<TAcc> const* m_product;
+    SiriusFMTM::StrassenParams<TAcc>  const* m_params;
+  };
+
+  // "FreivaldsJob": the rows [m_i0, m_i1) of the Freivalds check, of its
+  // 1st ("FreivaldsB") or 2nd ("FreivaldsAC") pass:
+  //
+  template<typename TIn, typename TAcc>
+  struct FreivaldsJob
+  {
+    bool            m_AC;
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    TIn  const*     m_A;
+    TIn  const*     m_B;
+    TAcc const*     m_C;
+    FreivaldsData const* m_frv;
+  };
+
+  // "SparseJob": the rows [m_i0, m_i1) of C, which are the band "m_band",
+  // with the "SpMM" or "SpGEMM" kernel:
+  //
+  template<typename TIn, typename TAcc>
+  struct SparseJob
+  {
+    KernelE         m_kernel;
+    long            m_i0;
+    long            m_i1;
+    long            m_band;
+    SparseData<TIn, TAcc> const* m_sparse;
+  };
+
+  // "BatchJob": computes the products [m_i0, m_i1) of the batch, each of
+  // size N x N, and the sum of their entries:
+  //
+  template<typename TIn, typename TAcc>
+  struct BatchJob
+  {
+    SiriusFMTM::BatchGEMMKernel<TIn, TAcc> const* m_batch;
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    TIn  const*     m_A;
+    TIn  const*     m_B;
+    TAcc*           m_C;
+  };
+
+  // "PanelJob": adds the product of a panel of A (of width m_k, all rows of
+  // the local block) and one of B (m_k x m_N) to the rows [m_i0, m_i1) of
+  // the local block of C (m_N columns):
+  //
+  template<typename TIn, typename TAcc>
+  struct PanelJob
+  {
+    SiriusFMTM::GEMMMicroKernel<TIn, TAcc> const* m_micro;
+    SiriusFMTM::GEMMBlocking               const* m_blk;
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    long            m_k;
+    TIn  const*     m_A;
+    TIn  const*     m_B;
+    TAcc*           m_C;
+  };
+
+  // "DistBlockJob": the block [m_i0, m_i1) x [m_j0, m_j1) of C, computed by
+  // the Worker "m_dist":
+  //
+  template<typename TIn, typename TAcc>
+  struct DistBlockJob
+  {
+    DistData const* m_dist;
+    long            m_N;
+    long            m_i0;
+    long            m_i1;
+    long            m_j0;
+    long            m_j1;
+    TIn  const*     m_A;
+    TIn  const*     m_B;
+    TAcc*           m_C;
+  };
+
+  //=========================================================================//
+  // "WorkItem": Any Job, and where to run it:                               //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
   struct WorkItem
   {
-    long            m_N;
-    long            m_N2;
-    double const*   m_rowA;   // Of size "m_N"
-    double const*   m_B;      // Whole "B", of size "m_N2"
-    double*         m_rowC;   // Of size "m_N"
-  };
+    std::variant<InitJob<TIn, TAcc>, MultiplyJob<TIn, TAcc>, ReduceJob,
+                 StrassenJob<TIn, TAcc>, FreivaldsJob<TIn, TAcc>,
+                 SparseJob<TIn, TAcc>, BatchJob<TIn, TAcc>,
+                 PanelJob<TIn, TAcc>, DistBlockJob<TIn, TAcc>>
+                    m_job;
+    int             m_node;   // NUMA Node hint, -1 if none
+  };
+
+  // Tile sums are reduced in chunks of this (fixed) size, so that the shape
+  // of the reduction tree does not depend on the number of Threads:
+  long const ReduceChunk = 64;
+
+  //=========================================================================//
+  // "PairwiseSum": Deterministic Tree Summation:                            //
+  //=========================================================================//
+  // More accurate than the sequential summation, and the result depends on
+  // "a_n" only (not on who computes it, or in which order). Always in double:
+  //
+  template<typename T>
+  double PairwiseSum(T const* a_x, long a_n)
+  {
+    if (a_n <= 8)
+    {
+      double sum = 0.0;
+      for (long i = 0; i < a_n; ++i)
+        sum += double(a_x[i]);
+      return sum;
+    }
+    long half = a_n / 2;
+    return PairwiseSum(a_x, half) + PairwiseSum(a_x + half, a_n - half);
+  }
+
+  //=========================================================================//
+  // "NaiveRow": C[i,*] = A[i,*] * B, returns the sum of C[i,*]:             //
+  //=========================================================================//
+  // Used for verification, so always computed in double:
+  //
+  template<typename TIn>
+  double NaiveRow(long a_N, TIn const* a_rowA, TIn const* a_B, double* a_rowC)
+  {
+    double sum  = 0.0;
+    long   N2   = a_N * a_N;
+
+    for (long j = 0; j < a_N; ++j)
+    {
+      // Fill in rowC[j]:
+      double* rowCj = a_rowC + j;
+      *rowCj = 0.0;
+
+      // Initial offset of B[*,j]:
+      TIn const* colBj = a_B + j;
+      for (long k = 0; k < a_N; ++k)
+      {
+        assert(colBj < a_B + N2);
+        (*rowCj) += double(a_rowA[k]) * double(*colBj);
+        colBj    += a_N;
+      }
+
+      // Increment the sum:
+      sum += (*rowCj);
+    }
+    return sum;
+  }
+
+  //=========================================================================//
+  // "RandomElem": Element of A or B from 2 Random Words:                    //
+  //=========================================================================//
+  // Floating-point: in [0, 1); integers: the whole range of int8_t:
+  //
+  template<typename T>
+  T RandomElem(uint32_t a_w0, uint32_t a_w1)
+  {
+    if constexpr (std::is_integral_v<T>)
+      return T(int8_t(a_w0 & 0xFF));
+    else
+    if constexpr (std::is_same_v<T, float>)
+      return float(a_w0 >> 8) * 0x1p-24f;
+    else
+      return T(double(((uint64_t(a_w0) << 32) | a_w1) >> 11) * 0x1p-53);
+  }
+
+  //=========================================================================//
+  // "RandomFill": a_x[n] for n in [a_n0, a_n1):                             //
+  //=========================================================================//
+  // Entry "n" of a matrix is made from the words 2*(n%2), 2*(n%2)+1 of the
+  // Block n/2 of its Philox stream; so it depends on the seed, the matrix
+  // and "n" only, NOT on how the matrix is split between the Threads:
+  //
+  template<typename T>
+  void RandomFill(SiriusFMTM::Philox4x32 const& a_gen, T* a_x,
+                  long a_n0, long a_n1)
+  {
+    SiriusFMTM::Philox4x32::Block blk {};
+    for (long n = a_n0; n < a_n1; ++n)
+    {
+      if (n == a_n0 || (n & 1) == 0)
+        blk = a_gen(uint64_t(n) >> 1);
+      int w = 2 * int(n & 1);
+      a_x[n] = RandomElem<T>(blk[size_t(w)], blk[size_t(w + 1)]);
+    }
+  }
+
+  //=========================================================================//
+  // "DoJob": "InitJob":                                                     //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  double DoJob(InitJob<TIn, TAcc> const& a_job)
+  {
+    // Streams 0 and 1 of the seed are for A and B:
+    long                   N = a_job.m_N;
+    SiriusFMTM::Philox4x32 genA(a_job.m_seed, 0);
+    SiriusFMTM::Philox4x32 genB(a_job.m_seed, 1);
+    for (long i = a_job.m_i0; i < a_job.m_i1; ++i)
+    {
+      RandomFill(genA, a_job.m_A, i * N + a_job.m_j0, i * N + a_job.m_j1);
+      RandomFill(genB, a_job.m_B, i * N + a_job.m_j0, i * N + a_job.m_j1);
+      if (a_job.m_C != nullptr)
+        std::fill(a_job.m_C + i * N + a_job.m_j0,
+                  a_job.m_C + i * N + a_job.m_j1, TAcc(0));
+    }
+    return 0.0;
+  }
+
+  //=========================================================================//
+  // "DoJob": "MultiplyJob":                                                 //
+  //=========================================================================//
+  // Returns the sum of the tile:
+  //
+  template<typename TIn, typename TAcc>
+  double DoJob(MultiplyJob<TIn, TAcc> const& a_job)
+  {
+    long          N   = a_job.m_N;
+    long          TM  = a_job.m_i1 - a_job.m_i0;
+    long          TN  = a_job.m_j1 - a_job.m_j0;
+    long          TK  = a_job.m_k1 - a_job.m_k0;
+    bool          add = a_job.m_k0 > 0;
+    // Rows of the tile (from column k0), columns of the tile (from row k0):
+    TIn const*    A   = a_job.m_A + a_job.m_i0 * N + a_job.m_k0;
+    TIn const*    B   = a_job.m_B + a_job.m_k0 * N + a_job.m_j0;
+    TAcc*         C   = a_job.m_C + a_job.m_i0 * N + a_job.m_j0;
+
+    if (a_job.m_kernel == KernelE::Naive)
+      for (long i = 0; i < TM; ++i)
+        for (long j = 0; j < TN; ++j)
+        {
+          // Dot product of A[i,*] and B[*,j]:
+          TAcc       cij   = add ? C[i * N + j] : TAcc(0);
+          TIn const* colBj = B + j;
+          for (long k = 0; k < TK; ++k, colBj += N)
+            cij += TAcc(A[i * N + k]) * TAcc(*colBj);
+          C[i * N + j] = cij;
+        }
+    else
+    if (a_job.m_kernel == KernelE::Blocked)
+      SiriusFMTM::GEMM<TIn, TAcc>(TM, TN, TK, A, N, B, N, C, N,
+                                  *a_job.m_micro, *a_job.m_blk, add);
+
+    // Sum of the tile entries, row by row:
+    double sum = 0.0;
+    for (long i = 0; i < TM; ++i)
+      sum += PairwiseSum(C + i * N, TN);
+    return sum;
+  }
+
+  //=========================================================================//
+  // "DoJob": "ReduceJob":                                                   //
+  //=========================================================================//
+  inline double DoJob(ReduceJob const& a_job)
+    { return PairwiseSum(a_job.m_sums + a_job.m_i0, a_job.m_i1 - a_job.m_i0); }
+
+  //=========================================================================//
+  // "DoJob": "StrassenJob":                                                 //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  double DoJob(StrassenJob<TIn, TAcc> const& a_job)
+  {
+    // Strassen is only used with the same input and accumulator types:
+    if constexpr (std::is_same_v<TIn, TAcc>)
+    {
+      // The Thread-local arena only grows on the 1st use by each Thread
+      // (the sub-products are all of the same size, up to 1):
+      thread_local SiriusFMTM::WorkspaceArena<TAcc> arena;
+      arena.Reserve(SiriusFMTM::StrassenWorkspace<TAcc>
+                    (a_job.m_product->m_n, a_job.m_params->m_cutoff));
+      SiriusFMTM::StrassenWinograd<TAcc>(*a_job.m_product, *a_job.m_params,
+                                         arena);
+    }
+    return 0.0;
+  }
+
+  //=========================================================================//
+  // "DoJob": "FreivaldsJob": The Freivalds Check on a Band of Rows:         //
+  //=========================================================================//
+  // "FreivaldsB" makes the rows of Y = B*X and AbsY = |B|*|X|; then, once all
+  // of them are done, "FreivaldsAC" makes the rows of A*Y - C*X, which is 0
+  // if C = A*B. Each residual is divided by the matching entry of |A|*AbsY,
+  // (the bound for the rounding errors of A*B is proportional to it), and
+  // the max of these is returned. All in double:
+  //
+  template<typename TIn, typename TAcc>
+  double DoJob(FreivaldsJob<TIn, TAcc> const& a_job)
+  {
+    long                 N   = a_job.m_N;
+    FreivaldsData const& frv = *a_job.m_frv;
+    long                 k   = frv.m_k;
+    std::vector<double>  z(size_t(3 * k));
+    double               res = 0.0;
+
+    for (long i = a_job.m_i0; i < a_job.m_i1; ++i)
+    {
+      std::fill(z.begin(), z.end(), 0.0);
+      if (!a_job.m_AC)
+      {
+        TIn const* rowB = a_job.m_B + i * N;
+        for (long j = 0; j < N; ++j)
+        {
+          double        b = double(rowB[j]);
+          double const* x = frv.m_X + j * k;
+          for (long r = 0; r < k; ++r)
+          {
+            z[size_t(r)]     += b * x[r];
+            z[size_t(k + r)] += std::fabs(b) * std::fabs(x[r]);
+          }
+        }
+        std::copy_n(z.begin(),     k, frv.m_Y    + i * k);
+        std::copy_n(z.begin() + k, k, frv.m_absY + i * k);
+        continue;
+      }
+      // FreivaldsAC: z[0..k) = (A*Y)[i], z[k..2k) = (|A|*AbsY)[i],
+      // z[2k..3k) = (C*X)[i]:
+      TIn  const* rowA = a_job.m_A + i * N;
+      TAcc const* rowC = a_job.m_C + i * N;
+      for (long j = 0; j < N; ++j)
+      {
+        double        a = double(rowA[j]);
+        double        c = double(rowC[j]);
+        double const* x = frv.m_X    + j * k;
+        double const* y = frv.m_Y    + j * k;
+        double const* w = frv.m_absY + j * k;
+        for (long r = 0; r < k; ++r)
+        {
+          z[size_t(r)]         += a * y[r];
+          z[size_t(k + r)]     += std::fabs(a) * w[r];
+          z[size_t(2 * k + r)] += c * x[r];
+        }
+      }
+      for (long r = 0; r < k; ++r)
+        res = std::max(res, std::fabs(z[size_t(r)] - z[size_t(2 * k + r)]) /
+                            std::max(z[size_t(k + r)], 1e-300));
+    }
+    return res;
+  }
+
+  //=========================================================================//
+  // "DoJob": "SparseJob": A Band of Rows of a Sparse Product:               //
+  //=========================================================================//
+  // Also makes the sums of these rows of C (the total is then made over the
+  // rows, so it does not depend on the bands):
+  //
+  template<typename TIn, typename TAcc>
+  double DoJob(SparseJob<TIn, TAcc> const& a_job)
+  {
+    SparseData<TIn, TAcc> const& sp = *a_job.m_sparse;
+    long                         i0 = a_job.m_i0;
+    long                         i1 = a_job.m_i1;
+
+    if (a_job.m_kernel == KernelE::SpMM)
+    {
+      SiriusFMTM::SpMMRows(*sp.m_A, sp.m_denseB, sp.m_m, sp.m_m,
+                           sp.m_denseC, sp.m_m, i0, i1);
+      for (long i = i0; i < i1; ++i)
+        sp.m_rowSums[i] = PairwiseSum(sp.m_denseC + i * sp.m_m, sp.m_m);
+      return 0.0;
+    }
+    // The dense accumulator (of the size of a row of C) is Thread-local:
+    thread_local SiriusFMTM::SpGEMMWorkspace<TAcc> ws;
+    SiriusFMTM::CSRMatrix<TAcc>& band = (*sp.m_bandsC)[size_t(a_job.m_band)];
+    band = SiriusFMTM::SpGEMMRows(*sp.m_A, *sp.m_B, i0, i1, ws);
+    for (long i = 0; i < band.m_nRows; ++i)
+      sp.m_rowSums[i0 + i] =
+        PairwiseSum(band.m_vals.data() + band.m_rowPtr[size_t(i)],
+                    band.m_rowPtr[size_t(i + 1)] - band.m_rowPtr[size_t(i)]);
+    return 0.0;
+  }
+
+  //=========================================================================//
+  // "DoJob": "BatchJob":                                                    //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  double DoJob(BatchJob<TIn, TAcc> const& a_job)
+  {
+    // The matrices of the batch are stored contiguously:
+    long N  = a_job.m_N;
+    long N2 = N * N;
+    long n  = a_job.m_i1 - a_job.m_i0;
+    a_job.m_batch->m_func(N, n, a_job.m_A + a_job.m_i0 * N2, N2,
+                                a_job.m_B + a_job.m_i0 * N2, N2,
+                                a_job.m_C + a_job.m_i0 * N2, N2);
+    return PairwiseSum(a_job.m_C + a_job.m_i0 * N2, n * N2);
+  }
+
+  //=========================================================================//
+  // "DoJob": "PanelJob":                                                    //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  double DoJob(PanelJob<TIn, TAcc> const& a_job)
+  {
+    // The panels and the local block of C are dense:
+    long N  = a_job.m_N;
+    long TK = a_job.m_k;
+    SiriusFMTM::GEMM<TIn, TAcc>(a_job.m_i1 - a_job.m_i0, N, TK,
+                                a_job.m_A + a_job.m_i0 * TK, TK,
+                                a_job.m_B,                   N,
+                                a_job.m_C + a_job.m_i0 * N,  N,
+                                *a_job.m_micro, *a_job.m_blk, true);
+    return 0.0;
+  }
+
+  //=========================================================================//
+  // "DoJob": "DistBlockJob": The Coordinator Side of 1 Worker's Product:    //
+  //=========================================================================//
+  // Streams the k-panels of A (rows [m_i0, m_i1)) and of B (cols [m_j0,
+  // m_j1)) to the Worker "m_dist", then receives its block of C, directly
+  // into C. The TCP flow control provides the back-pressure; the Worker
+  // computes a panel while receiving the next one:
+  //
+  template<typename TIn, typename TAcc>
+  double DoJob(DistBlockJob<TIn, TAcc> const& a_job)
+  {
+    using namespace SiriusFMTM;
+    int  sd = a_job.m_dist->m_sd;
+    long N  = a_job.m_N;
+    long kb = a_job.m_dist->m_kb;
+    long M  = a_job.m_i1 - a_job.m_i0;
+    long NC = a_job.m_j1 - a_job.m_j0;
+
+    // The packed panels (Thread-local, so only allocated once):
+    thread_local AlignedArray<TIn> panel;
+    try
+    {
+      DistSendHdr(sd, DistMsgE::Start);
+      for (long k0 = 0; k0 < N; k0 += kb)
+      {
+        int64_t k  = std::min(kb, N - k0);
+        size_t  n  = size_t((M + NC) * k);
+        TIn*    Ap = panel.Reserve(n);
+        TIn*    Bp = Ap + M * k;
+        for (long i = 0; i < M; ++i)
+          std::copy_n(a_job.m_A + (a_job.m_i0 + i) * N + k0, k, Ap + i * k);
+        for (long p = 0; p < k; ++p)
+          std::copy_n(a_job.m_B + (k0 + p) * N + a_job.m_j0, NC, Bp + p * NC);
+
+        size_t bytes = n * sizeof(TIn);
+        DistSendHdr(sd, DistMsgE::Panel, sizeof(k) + bytes);
+        DistSendAll(sd, &k, sizeof(k), true);
+        DistSendAll(sd, Ap, bytes);
+      }
+      DistSendHdr(sd, DistMsgE::Finish);
+
+      DistMsgHdr hdr = DistRecvHdr(sd);
+      if (hdr.m_type != DistMsgE::Result ||
+          hdr.m_len  != uint64_t(M * NC) * sizeof(TAcc))
+        throw std::runtime_error("DistBlock: Invalid Result");
+      for (long i = 0; i < M; ++i)
+        DistRecvAll(sd, a_job.m_C + (a_job.m_i0 + i) * N + a_job.m_j0,
+                    size_t(NC) * sizeof(TAcc));
+    }
+    catch (std::exception const& exn)
+    {
+      // The job is marked as Failed; report the reason here:
+      std::cerr << "Worker SD=" << sd << ": " << exn.what() << std::endl;
+      throw;
+    }
+    return 0.0;
+  }
+
+  //=========================================================================//
+  // "MultAndSum": Run any Job:                                              //
+  //=========================================================================//
+  template<typename TIn, typename TAcc>
+  double MultAndSum(WorkItem<TIn, TAcc> a_wi)
+  {
+    return std::visit([](auto const& a_job) { return DoJob(a_job); },
+                      a_wi.m_job);
+  }
+
+  //=========================================================================//
+  // "DefaultTile": Cache-Aware Default Tile Size:                           //
+  //=========================================================================//
+  // A tile of C should fit in 1/4 of L2 (along with the packed A block), be
+  // a multiple of the micro-kernel size, and there should be enough tiles
+  // for good load balancing (at least 256 if N allows it). Depends on N and
+  // the caches only, NOT on the number of Threads, so that the results are
+  // the same for any number of Threads:
+  //
+  template<typename TIn, typename TAcc>
+  void DefaultTile(long a_N,
+                   SiriusFMTM::GEMMMicroKernel<TIn, TAcc> const& a_kern,
+                   SiriusFMTM::GEMMBlocking               const& a_blk,
+                   long* a_TM, long* a_TN)
+  {
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 <= 0)
+      l2 = 256 * 1024;
+    long const MinTM = 4 * a_kern.m_MR;
+    long const MinTN = 4 * a_kern.m_NR;
+
+    // Start from the largest square tile which fits, as the packing overhead
+    // per tile is proportional to (1/TM + 1/TN):
+    long side = long(std::sqrt(double(l2 / 4) / double(sizeof(TAcc))));
+    long TM   = std::max(std::min(side, a_blk.m_MC) / a_kern.m_MR * a_kern.m_MR,
+                         MinTM);
+    long TN   = std::max(side / a_kern.m_NR * a_kern.m_NR, MinTN);
+
+    auto nTiles = [a_N](long tm, long tn)
+      { return ((a_N + tm - 1) / tm) * ((a_N + tn - 1) / tn); };
+
+    while (nTiles(TM, TN) < 256 && (TM > MinTM || TN > MinTN))
+      if (TM > MinTM && (TM >= TN || TN == MinTN))
+        TM = std::max(TM / 2 / a_kern.m_MR * a_kern.m_MR, MinTM);
+      else
+        TN = std::max(TN / 2 / a_kern.m_NR * a_kern.m_NR, MinTN);
+
+    *a_TM = TM;
+    *a_TN = TN;
+  }
+
+  //=========================================================================//
+  // "DefaultBlock": Block Size for the Out-of-Core Mode:                    //
+  //=========================================================================//
+  // The blocks of A, B and C in use (and the next ones, being prefetched)
+  // should take about 1/4 of the physical memory. The block size must be a
+  // multiple of both tile dimensions, so that the tiles do not straddle the
+  // block boundaries:
+  //
+  long DefaultBlock(long a_N, long a_TM, long a_TN, size_t a_elemSz)
+  {
+    long pages  = sysconf(_SC_PHYS_PAGES);
+    long pageSz = sysconf(_SC_PAGESIZE);
+    double mem  = (pages > 0 && pageSz > 0)
+                  ? double(pages) * double(pageSz)
+                  : double(1L << 30);
+    long side   = long(std::sqrt(mem / 4.0 / 6.0 / double(a_elemSz)));
+    long unit   = std::lcm(a_TM, a_TN);
+    return std::min(std::max(side / unit * unit, unit), a_N);
+  }
+
+  //=========================================================================//
+  // "Verify": Re-compute some rows of C with the Naive kernel:              //
+  //=========================================================================//
+  // Returns the max relative error:
+  //
+  template<typename TIn, typename TAcc>
+  double Verify(long a_N, TIn const* a_A, TIn const* a_B, TAcc const* a_C)
+  {
+    long const NRows = std::min<long>(a_N, 64);
+    double*    row   = new double[a_N];
+    double     err   = 0.0;
+
+    for (long r = 0; r < NRows; ++r)
+    {
+      long i = r * a_N / NRows;
+      (void) NaiveRow(a_N, a_A + i * a_N, a_B, row);
+      for (long j = 0; j < a_N; ++j)
+      {
+        double ref = row[j];
+        double d   = std::fabs(double(a_C[i * a_N + j]) - ref);
+        err        = std::max(err, d / std::max(std::fabs(ref), 1e-300));
+      }
+    }
+    delete[] row;
+    return err;
+  }
+
+  //=========================================================================//
+  // "VerifySparse": Re-compute some rows of a Sparse Product, in double:    //
+  //=========================================================================//
+  // Either "a_B" (sparse) or "a_denseB" (a_A.m_nCols x a_m) is given, and
+  // C is "a_C" (sparse) or "a_denseC" (a_A.m_nRows x a_m). The errors are
+  // relative to |A|*|B| (the entries of C may cancel out to ~0). Returns the
+  // max one:
+  //
+  template<typename TIn, typename TAcc>
+  double VerifySparse(SiriusFMTM::CSRMatrix<TIn>  const& a_A,
+                      SiriusFMTM::CSRMatrix<TIn>  const* a_B,
+                      TIn                         const* a_denseB,
+                      long                               a_m,
+                      SiriusFMTM::CSRMatrix<TAcc> const* a_C,
+                      TAcc                        const* a_denseC)
+  {
+    long const          NRows = std::min<long>(a_A.m_nRows, 64);
+    long const          nCols = (a_B != nullptr) ? a_B->m_nCols : a_m;
+    std::vector<double> ref   (static_cast<size_t>(nCols));
+    std::vector<double> absRef(static_cast<size_t>(nCols));
+    std::vector<double> got   (static_cast<size_t>(nCols));
+    double              err   = 0.0;
+
+    for (long r = 0; r < NRows; ++r)
+    {
+      long i = r * a_A.m_nRows / NRows;
+      std::fill(ref.begin(), ref.end(), 0.0);
+      std::fill(absRef.begin(), absRef.end(), 0.0);
+      for (long p = a_A.m_rowPtr[size_t(i)]; p < a_A.m_rowPtr[size_t(i + 1)];
+           ++p)
+      {
+        double a = double(a_A.m_vals[size_t(p)]);
+        long   k = a_A.m_colIdx[size_t(p)];
+        if (a_B != nullptr)
+          for (long q = a_B->m_rowPtr[size_t(k)];
+               q < a_B->m_rowPtr[size_t(k + 1)]; ++q)
+          {
+            double b = double(a_B->m_vals[size_t(q)]);
+            ref[size_t(a_B->m_colIdx[size_t(q)])] += a * b;
+            absRef[size_t(a_B->m_colIdx[size_t(q)])] += std::fabs(a * b);
+          }
+        else
+          for (long j = 0; j < a_m; ++j)
+          {
+            double b = double(a_denseB[k * a_m + j]);
+            ref[size_t(j)] += a * b;
+            absRef[size_t(j)] += std::fabs(a * b);
+          }
+      }
+      if (a_C != nullptr)
+      {
+        std::fill(got.begin(), got.end(), 0.0);
+        for (long p = a_C->m_rowPtr[size_t(i)];
+             p < a_C->m_rowPtr[size_t(i + 1)]; ++p)
+          got[size_t(a_C->m_colIdx[size_t(p)])] =
+            double(a_C->m_vals[size_t(p)]);
+      }
+      else
+        for (long j = 0; j < a_m; ++j)
+          got[size_t(j)] = double(a_denseC[i * a_m + j]);
+
+      for (long j = 0; j < nCols; ++j)
+        err = std::max(err, std::fabs(got[size_t(j)] - ref[size_t(j)]) /
+                            std::max(absRef[size_t(j)], 1e-300));
+    }
+    return err;
+  }
+
+  void Usage()
+  {
+    std::cerr << "Params: [-k naive|blocked|strassen|spmm|spgemm|batched]\n"
+                 "        [-e f64|f32|f32f64|i8i32]"
+                 " [-s auto|avx512|avx2|scalar|generic] [-c Cutoff]"
+                 "\n"
+                 "        [-t TM[xTN]] [-f Dir [-b BlockSize]] [-r Seed] [-v] "
+                 "[-F Rounds]\n"
+                 "        [-D Density] [-i A.mtx[,B.mtx]] [-m Cols] "
+                 "[-B Count]\n"
+                 "        [-C Port:NWorkers] [-H hugetlb|thp|off] [-w WarmUps] "
+                 "[-n Reps]\n"
+                 "        [-o File.{json|csv}]\n"
+                 "        MatrixSize[,...] NThreads[,...]\n"
+                 "    or: [-H hugetlb|thp|off] -W Host:Port NThreads\n"
+                 "  -k: Multiplication kernel(s), comma-separated (default: "
+                 "blocked)\n"
+                 "  -e: Element types of A, B and of C (default: f64; "
+                 "f32f64: float inputs,\n"
+                 "      double accumulation; i8i32: int8 inputs, int32 "
+                 "accumulation)\n"
+                 "  -s: Micro-kernel for \"blocked\", \"strassen\" and "
+                 "\"batched\" (default: auto,\n"
+                 "      ie the best one for this CPU; \"generic\" is "
+                 "for \"batched\" only)\n"
+                 "  -c: Size below which \"strassen\" uses \"blocked\" "
+                 "(default: 512)\n"
+                 "  -t: Tile size, rows x columns of C (default: cache-aware)\n"
+                 "  -D: Density of the random sparse matrices for \"spmm\" "
+                 "(A) and \"spgemm\"\n"
+                 "      (A and B) (default: 0.01)\n"
+                 "  -i: Read the sparse A (and B; default: A) from Matrix "
+                 "Market files; then\n"
+                 "      MatrixSize is ignored\n"
+                 "  -m: Number of columns of the dense B and C of \"spmm\" "
+                 "(default: 64)\n"
+                 "  -B: Number of (MatrixSize x MatrixSize) products of "
+                 "\"batched\" (default:\n"
+                 "      as many as fit in 256 MiB)\n"
+                 "  -f: Out-of-core mode: A, B, C are memory-mapped files "
+                 "Dir/{A,B,C}.bin\n"
+                 "      (A and B are generated if they do not exist)\n"
+                 "  -b: Out-of-core block size (default: from the physical "
+                 "memory size);\n"
+                 "      in the distributed mode, the panel width (default: "
+                 "256)\n"
+                 "  -C: Distributed mode (\"blocked\" only): wait for "
+                 "NWorkers Workers to\n"
+                 "      connect to Port, and multiply on them (NThreads only "
+                 "generate A and B)\n"
+                 "  -W: Be a Worker of the Coordinator at Host:Port, with "
+                 "NThreads Threads\n"
+                 "  -H: Pages of the in-memory matrices and workspaces: "
+                 "2 MiB ones reserved\n"
+                 "      by vm.nr_hugepages (hugetlb; if not enough, as thp), "
+                 "Transparent Huge\n"
+                 "      Pages (thp), or 4 KiB ones (off) (default: hugetlb)\n"
+                 "  -r: Random seed (default: from the curr time)\n"
+                 "  -v: Verify the result against the naive kernel\n"
+                 "  -F: Freivalds' randomised check of the result, with "
+                 "Rounds random vectors\n"
+                 "      (O(Rounds * N^2), so usable at any size)\n"
+                 "  -w: Number of untimed warm-up runs (default: 0)\n"
+                 "  -n: Number of timed runs; the median time is reported "
+                 "(default: 1)\n"
+                 "  -o: Write the results of all tests (all combinations of "
+                 "the kernels,\n"
+                 "      sizes and numbers of Threads) to a JSON (or \".csv\") "
+                 "file"
+              << std::endl;
+  }
+
+  //=========================================================================//
+  // "SubmitJobs": Submit jobs with back-pressure:                           //
+  //=========================================================================//
+  // Each job goes to the NUMA Node given by its "m_node" (if any). Their
+  // results go into "a_res", their statuses into "*a_stats":
+  //
+  template<typename TP, typename WI>
+  void SubmitJobs(TP& a_tp, std::vector<WI> const& a_wis, double* a_res,
+                  std::vector<typename TP::JobStatusE>* a_stats)
+  {
+    using JobStatusE = typename TP::JobStatusE;
+    size_t const n = a_wis.size();
+    a_stats->assign(n, JobStatusE::UNDEFINED);
+
+    // 0.1 msec = 10^5 nsec:
+    timespec const shortPause { 0, 100'000 };
+
+    for (size_t i = 0; i < n; ++i)
+      // If the queue is full, wait until the Workers take some jobs off it:
+      while (!a_tp.SubmitOnNode(a_wis[i].m_node, a_wis[i], a_res + i,
+                                &(*a_stats)[i]))
+        nanosleep(&shortPause, nullptr);
+  }
+
+  //=========================================================================//
+  // "WaitJobs": Wait for all submitted jobs:                                //
+  //=========================================================================//
+  // Returns "false" if any of them has failed:
+  //
+  template<typename JobStatusE>
+  bool WaitJobs(std::vector<JobStatusE> const& a_stats)
+  {
+    // 1 msec = 10^6 nsec:
+    timespec const pause { 0, 1'000'000 };
+
+    // Yield at first (the jobs may be short, eg small batched products, and
+    // then a pause of 1 msec would be longer than all of them), then poll
+    // with pauses:
+    int const MaxYields = 10'000;
+    bool      ok        = true;
+    for (size_t i = 0, polls = 0; i < a_stats.size(); )
+    {
+      JobStatusE st = a_stats[i];
+      if (st == JobStatusE::Completed || st == JobStatusE::Failed)
+      {
+        ok = ok && (st == JobStatusE::Completed);
+        ++i;
+      }
+      else
+      if (++polls <= MaxYields)
+        sched_yield();
+      else
+        nanosleep(&pause, nullptr);
+    }
+    return ok;
+  }
+
+  //=========================================================================//
+  // "RunJobs": Submit jobs, and wait for all of them:                       //
+  //=========================================================================//
+  // Returns "false" if any of them has failed:
+  //
+  template<typename TP, typename WI>
+  bool RunJobs(TP& a_tp, std::vector<WI> const& a_wis, double* a_res)
+  {
+    std::vector<typename TP::JobStatusE> stats;
+    SubmitJobs(a_tp, a_wis, a_res, &stats);
+    return WaitJobs(stats);
+  }
+
+  //=========================================================================//
+  // "VerifyTol": Max Relative Error Accepted by "Verify":                  //
+  //=========================================================================//
+  template<typename TAcc>
+  double VerifyTol(KernelE a_kernel)
+  {
+    if constexpr (std::is_integral_v<TAcc>)
+      return 0.0;
+    else
+    if constexpr (std::is_same_v<TAcc, float>)
+      return 1e-3;
+    else
+      return (a_kernel == KernelE::Strassen) ? 1e-8 : 1e-10;
+  }
+
+  //=========================================================================//
+  // "FreivaldsTol": Max Residual Accepted by the Freivalds Check:           //
+  //=========================================================================//
+  // The residuals are relative to |A|*|B|*|X|, so the rounding errors of a
+  // classical product are below N*eps (the usual a-priori bound); Strassen
+  // only has a norm-wise bound, so some more is allowed:
+  //
+  template<typename TAcc>
+  double FreivaldsTol(KernelE a_kernel, long a_N)
+  {
+    if constexpr (std::is_integral_v<TAcc>)
+      return 0.0;
+    else
+      return double(a_N) * double(std::numeric_limits<TAcc>::epsilon()) *
+             ((a_kernel == KernelE::Strassen) ? 16.0 : 1.0);
+  }
+
+  //=========================================================================//
+  // "Options": From the Command Line:                                       //
+  //=========================================================================//
+  struct Options
+  {
+    KernelE     m_kernel;
+    bool        m_verify;
+    char const* m_micro;
+    long        m_TM;
+    long        m_TN;
+    long        m_seed;
+    std::string m_dir;
+    long        m_S;
+    long        m_cutoff;
+    long        m_N;
+    int         m_T;
+    int         m_warmups;
+    int         m_reps;
+    int         m_freivalds;  // Number of Freivalds rounds, 0: none
+    double      m_density;    // Of the random sparse matrices
+    std::string m_mtxA;       // Matrix Market files of the sparse A and B,
+    std::string m_mtxB;       //   if non-empty
+    long        m_m;          // Cols of the dense B and C of "SpMM"
+    long        m_count;      // Number of products of "Batched", 0: default
+    ElemTypesE  m_types;      // As the template params of "Run"
+    std::vector<int> const* m_workers;  // Sockets of the distributed mode
+  };
+
+  //=========================================================================//
+  // "BenchResult": Of 1 Test (Matrix Size, Number of Threads, Kernel):      //
+  //=========================================================================//
+  struct BenchResult
+  {
+    long        m_N;
+    int         m_T;
+    KernelE     m_kernel;
+    std::string m_micro;      // Empty for "Naive"
+    long        m_TM;
+    long        m_TN;
+    double      m_medianSec;
+    double      m_minSec;
+    double      m_flops;      // Per product
+    double      m_bytes;      // Memory traffic per product (see "Run")
+    double      m_total;
+    double      m_err;        // Of "Verify", < 0 if not verified
+    double      m_residual;   // Of the Freivalds check, < 0 if not done
+    double      m_dtlbMisses; // dTLB load misses per product, < 0: unknown
+    bool        m_ok;         // Verified (if done), and deterministic
+  };
+
+  //=========================================================================//
+  // "Median": Of a non-empty vector:                                        //
+  //=========================================================================//
+  double Median(std::vector<double> a_xs)
+  {
+    std::sort(a_xs.begin(), a_xs.end());
+    size_t n = a_xs.size();
+    return (n % 2 == 1) ? a_xs[n / 2] : 0.5 * (a_xs[n / 2 - 1] + a_xs[n / 2]);
+  }
+
+  //=========================================================================//
+  // "SplitList": "a,b,c" -> {"a", "b", "c"}:                                //
+  //=========================================================================//
+  std::vector<std::string> SplitList(char const* a_str)
+  {
+    std::vector<std::string> res;
+    std::string              str(a_str);
+    for (size_t from = 0; ; )
+    {
+      size_t comma = str.find(',', from);
+      res.push_back(str.substr(from, comma - from));
+      if (comma == std::string::npos)
+        break;
+      from = comma + 1;
+    }
+    return res;
+  }
+
+  //=========================================================================//
+  // "PrintHugePages": The Pages actually obtained by "HugeAlloc":           //
+  //=========================================================================//
+  // To be called once the matrices have been touched (THP are allocated on
+  // the 1st access, and only then counted in "m_anonHugeBytes"):
+  //
+  void PrintHugePages()
+  {
+    using namespace SiriusFMTM;
+    HugePagesStats st = HugePagesGetStats();
+    long const     HP = long(HugePageSize);
+    std::cout << "HugePages: Mode=" << HugePagesNames[int(HugePagesMode())]
+              << ", HugeTLB=" << st.m_hugeTLBPages << " pages, THP="
+              << (st.m_anonHugeBytes / HP) << " pages (of "
+              << (st.m_thpBytes / HP) << " advised)";
+    if (st.m_nFallbacks > 0)
+      std::cout << ", HugeTLB failed: " << st.m_nFallbacks << " times";
+    std::cout << std::endl;
+  }
+
+  //=========================================================================//
+  // "StopDTLB": Stop the dTLB Counter of the Timed Runs:                    //
+  //=========================================================================//
+  // Prints and returns the misses per product ("a_R" products were timed),
+  // or returns -1 if they are not counted:
+  //
+  double StopDTLB(SiriusFMTM::PerfCounter const& a_dtlb, int a_R)
+  {
+    a_dtlb.Disable();
+    if (!a_dtlb.Valid())
+      return -1.0;
+    double res = double(a_dtlb.Read()) / double(a_R);
+    std::cout << "dTLB: LoadMisses=" << res << " per product" << std::endl;
+    return res;
+  }
+
+  //=========================================================================//
+  // "ReportRun": Print and Record the Results of the Timed Runs:            //
+  //=========================================================================//
+  // "a_run" gives the test (N, T, kernel, micro, tile), "m_flops", "m_bytes"
+  // and "m_total"; the times ("a_secs", non-empty), the dTLB misses (if
+  // "a_dtlb" is not NULL), the error and "m_ok" are filled in here, and the
+  // result is stored into "*a_res" (if not NULL). "a_info" goes after N on
+  // the printed line; "a_net": "m_bytes" is the network traffic, whose rate
+  // is printed too. "a_verify" computes the max relative error of C; it is
+  // called if "a_check" (a failure is then an error), and always for
+  // "Strassen", which trades some accuracy for speed. Returns the exit code:
+  //
+  template<typename TAcc, typename VerifyF>
+  int ReportRun(BenchResult const& a_run, std::vector<double> const& a_secs,
+                bool a_deterministic, bool a_check, VerifyF const& a_verify,
+                SiriusFMTM::PerfCounter const* a_dtlb, BenchResult* a_res,
+                std::string const& a_info = "", bool a_net = false)
+  {
+    BenchResult res = a_run;
+    int         R   = int(a_secs.size());
+    res.m_medianSec = Median(a_secs);
+    res.m_minSec    = *std::min_element(a_secs.begin(), a_secs.end());
+    std::cout << "N=" << res.m_N << a_info << ", TotalSum="
+              << std::setprecision(17) << res.m_total << std::setprecision(6)
+              << ", Time=" << res.m_medianSec << " sec, "
+              << (std::is_integral_v<TAcc> ? "GOP/s=" : "GFLOP/s=")
+              << (res.m_flops / res.m_medianSec * 1e-9);
+    if (a_net)
+      std::cout << ", Net: GB/s=" << (res.m_bytes / res.m_medianSec * 1e-9);
+    if (R > 1)
+      std::cout << " (median of " << R << " runs, min Time=" << res.m_minSec
+                << " sec)";
+    std::cout << std::endl;
+    res.m_dtlbMisses = (a_dtlb != nullptr) ? StopDTLB(*a_dtlb, R) : -1.0;
+
+    int rc = 0;
+    if (!a_deterministic)
+    {
+      std::cerr << "ERROR: TotalSum differs between runs" << std::endl;
+      rc = 2;
+    }
+    res.m_err      = -1.0;
+    res.m_residual = -1.0;
+    res.m_ok       = a_deterministic;
+    if (a_check || res.m_kernel == KernelE::Strassen)
+    {
+      res.m_err  = a_verify();
+      bool exact = res.m_err <= VerifyTol<TAcc>(res.m_kernel);
+      std::cout << "Verify: MaxRelErr=" << res.m_err
+                << (exact ? ", OK" : ", FAILED") << std::endl;
+      res.m_ok = res.m_ok && exact;
+      if (a_check && !exact)
+        rc = 2;
+    }
+
+    if (a_res != nullptr)
+      *a_res = res;
+    return rc;
+  }
 
   //=========================================================================//
-  // "MultAndSum":                                                           //
+  // "WriteResults": Machine-Readable Benchmark Results (JSON or CSV):       //
   //=========================================================================//
-  double MultAndSum(WorkItem a_wi)
+  // The parallel efficiency is against the 1-Thread test with the same N and
+  // kernel, if there was one (otherwise it is null / empty). Returns false
+  // if the file cannot be written:
+  //
+  bool WriteResults(std::string const& a_path, char const* a_types,
+                    char const* a_pages, std::vector<BenchResult> const& a_res)
   {
-    double        sum  = 0.0;
-    long          N    = a_wi.m_N;
-    long          N2   = a_wi.m_N2;
-    double const* rowA = a_wi.m_rowA;
-    double const* B    = a_wi.m_B;
-    double*       rowC = a_wi.m_rowC;
+    std::ofstream out(a_path);
+    if (!out)
+      return false;
+    bool csv = a_path.size() >= 4 &&
+               a_path.compare(a_path.size() - 4, 4, ".csv") == 0;
+    out << std::setprecision(9);
+    auto num = [](double a_x)
+      { std::ostringstream str; str << std::setprecision(6) << a_x;
+        return str.str(); };
+
+    if (csv)
+      out << "n,threads,kernel,micro,types,huge_pages,tile_m,tile_n,"
+             "median_sec,min_sec,gflops,gbytes_per_sec,efficiency,total_sum,"
+             "max_rel_err,freivalds_residual,dtlb_load_misses,ok\n";
+    else
+      out << "{\n  \"benchmark\": \"HugeMatrixMult\",\n  \"results\": [";
 
-    for (long j = 0; j < N; ++j)
+    for (size_t r = 0; r < a_res.size(); ++r)
     {
-      // Fill in rowC[j]:
-      double* rowCj = rowC + j;
-      *rowCj = 0.0;
+      BenchResult const& res = a_res[r];
+      double base = 0.0;
+      for (BenchResult const& other: a_res)
+        if (other.m_T == 1 && other.m_N == res.m_N &&
+            other.m_kernel == res.m_kernel)
+          base = other.m_medianSec;
 
-      // Initial offset of B[*,j]:
-      double const* colBj = B + j;
-      for (long k = 0; k < N; ++k)
+      double      gfl  = res.m_flops / res.m_medianSec * 1e-9;
+      double      gbs  = res.m_bytes / res.m_medianSec * 1e-9;
+      std::string eff  = (base > 0.0)
+                         ? num(base / (res.m_medianSec * res.m_T))
+                         : std::string(csv ? "" : "null");
+      std::string err  = (res.m_err >= 0.0)
+                         ? num(res.m_err)
+                         : std::string(csv ? "" : "null");
+      std::string frv  = (res.m_residual >= 0.0)
+                         ? num(res.m_residual)
+                         : std::string(csv ? "" : "null");
+      std::string tlb  = (res.m_dtlbMisses >= 0.0)
+                         ? num(res.m_dtlbMisses)
+                         : std::string(csv ? "" : "null");
+      char const* kern = KernelNames[int(res.m_kernel)];
+
+      if (csv)
+        out << res.m_N << ',' << res.m_T << ',' << kern << ','
+            << res.m_micro << ',' << a_types << ',' << a_pages << ','
+            << res.m_TM << ',' << res.m_TN << ',' << res.m_medianSec << ','
+            << res.m_minSec << ',' << gfl << ',' << gbs << ',' << eff << ','
+            << std::setprecision(17) << res.m_total << std::setprecision(9)
+            << ',' << err << ',' << frv << ',' << tlb << ','
+            << (res.m_ok ? 1 : 0) << '\n';
+      else
+        out << (r == 0 ? "\n" : ",\n")
+            << "    { \"n\": " << res.m_N << ", \"threads\": " << res.m_T
+            << ", \"kernel\": \"" << kern << "\", \"micro\": \""
+            << res.m_micro << "\", \"types\": \"" << a_types
+            << "\", \"huge_pages\": \"" << a_pages
+            << "\",\n      \"tile\": [" << res.m_TM << ", " << res.m_TN
+            << "], \"median_sec\": " << res.m_medianSec
+            << ", \"min_sec\": " << res.m_minSec
+            << ",\n      \"gflops\": " << gfl
+            << ", \"gbytes_per_sec\": " << gbs
+            << ", \"efficiency\": " << eff
+            << ",\n      \"total_sum\": " << std::setprecision(17)
+            << res.m_total << std::setprecision(9)
+            << ", \"max_rel_err\": " << err
+            << ", \"freivalds_residual\": " << frv
+            << ",\n      \"dtlb_load_misses\": " << tlb
+            << ", \"ok\": " << (res.m_ok ? "true" : "false") << " }";
+    }
+    if (!csv)
+      out << "\n  ]\n}\n";
+    return bool(out);
+  }
+}
+
+//===========================================================================//
+// "RunSparse": The Test for the Sparse Kernels:                             //
+//===========================================================================//
+// A (and B for "SpGEMM") are random with the given density, or come from
+// Matrix Market files. The rows of C are split into bands of about equal
+// cost (NNZ of A for "SpMM", multiply-adds for "SpGEMM"), a few per Thread:
+//
+template<typename TIn, typename TAcc>
+int RunSparse(Options const& a_opts, BenchResult* a_res)
+{
+  KernelE kernel = a_opts.m_kernel;
+  bool    spgemm = (kernel == KernelE::SpGEMM);
+  long    N      = a_opts.m_N;
+  long    m      = a_opts.m_m;
+  int     T      = a_opts.m_T;
+
+  if (a_opts.m_freivalds > 0)
+  {
+    std::cerr << "The Freivalds check is for the dense kernels only"
+              << std::endl;
+    return 1;
+  }
+
+  // Load or generate the sparse matrices:
+  using CSR = SiriusFMTM::CSRMatrix<TIn>;
+  CSR      A { 0, 0, {}, {}, {} };
+  CSR      B { 0, 0, {}, {}, {} };
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  try
+  {
+    if (!a_opts.m_mtxA.empty())
+    {
+      A = SiriusFMTM::CSRLoadMatrixMarket<TIn>(a_opts.m_mtxA);
+      if (spgemm)
+        B = a_opts.m_mtxB.empty()
+            ? A : SiriusFMTM::CSRLoadMatrixMarket<TIn>(a_opts.m_mtxB);
+    }
+    else
+    {
+      // Streams 0 and 1 of the seed, as for the dense A and B:
+      auto elem = [](uint32_t a_w0, uint32_t a_w1)
+        { return RandomElem<TIn>(a_w0, a_w1); };
+      unsigned long seed = (unsigned long)(a_opts.m_seed);
+      A = SiriusFMTM::CSRRandom<TIn>(N, N, a_opts.m_density,
+                                     SiriusFMTM::Philox4x32(seed, 0), elem);
+      if (spgemm)
+        B = SiriusFMTM::CSRRandom<TIn>(N, N, a_opts.m_density,
+                                       SiriusFMTM::Philox4x32(seed, 1), elem);
+    }
+  }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
+    return 1;
+  }
+  if (spgemm && A.m_nCols != B.m_nRows)
+  {
+    std::cerr << "Incompatible sizes of A and B" << std::endl;
+    return 1;
+  }
+
+  // The dense B of "SpMM" (A.m_nCols x m) is from the stream 1:
+  std::vector<TIn> denseB;
+  if (!spgemm)
+  {
+    denseB.resize(size_t(A.m_nCols * m));
+    RandomFill(SiriusFMTM::Philox4x32((unsigned long)(a_opts.m_seed), 1),
+               denseB.data(), 0, A.m_nCols * m);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  std::cout << "Sparse: A=" << A.m_nRows << 'x' << A.m_nCols << ", NNZ="
+            << A.NNZ();
+  if (spgemm)
+    std::cout << "; B=" << B.m_nRows << 'x' << B.m_nCols << ", NNZ="
+              << B.NNZ();
+  else
+    std::cout << "; Dense B=" << A.m_nCols << 'x' << m;
+  std::cout << "; Init: Time="
+            << (double(t1.tv_sec  - t0.tv_sec) +
+                double(t1.tv_nsec - t0.tv_nsec) * 1e-9)
+            << " sec" << std::endl;
+
+  // Bands of rows of C:
+  std::vector<long> costs  = spgemm ? SiriusFMTM::SpGEMMCosts(A, B)
+                                    : A.m_rowPtr;
+  std::vector<long> bounds = SiriusFMTM::BalancedSplit(costs, 4 * long(T));
+  size_t            nBands = bounds.size() - 1;
+  double            flops  = 2.0 * double(costs.back()) *
+                             (spgemm ? 1.0 : double(m));
+
+  using WI   = WorkItem<TIn, TAcc>;
+  using Pool = SiriusFMTM::ThreadPool<WI, double,
+                                      decltype(MultAndSum<TIn, TAcc>)>;
+  Pool TP(size_t(T), size_t(4 * T + 16), MultAndSum<TIn, TAcc>);
+
+  std::vector<TAcc>                        denseC;
+  std::vector<SiriusFMTM::CSRMatrix<TAcc>> bandsC(spgemm ? nBands : 0);
+  SiriusFMTM::CSRMatrix<TAcc>              C { 0, 0, {}, {}, {} };
+  std::vector<double>                      rowSums(size_t(A.m_nRows));
+  if (!spgemm)
+    denseC.resize(size_t(A.m_nRows * m));
+  SparseData<TIn, TAcc> sp { &A, &B, denseB.data(), m, denseC.data(),
+                             &bandsC, rowSums.data() };
+
+  std::vector<WI> bands;
+  for (size_t b = 0; b < nBands; ++b)
+    bands.push_back(WI{ SparseJob<TIn, TAcc>{ .m_kernel = kernel,
+                                              .m_i0     = bounds[b],
+                                              .m_i1     = bounds[b + 1],
+                                              .m_band   = long(b),
+                                              .m_sparse = &sp },
+                        -1 });
+  std::vector<double> dummy(nBands);
+
+  // Warm-up and timed runs, as for the dense kernels:
+  int                 W             = a_opts.m_warmups;
+  int                 R             = a_opts.m_reps;
+  std::vector<double> secs;
+  double              total         = 0.0;
+  double              prevTotal     = 0.0;
+  bool                deterministic = true;
+
+  for (int rep = -W; rep < R; ++rep)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    RunJobs(TP, bands, dummy.data());
+    if (spgemm)
+      C = SiriusFMTM::CSRConcat(bandsC);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    total = PairwiseSum(rowSums.data(), long(rowSums.size()));
+    if (rep >= 0)
+      secs.push_back(double(t1.tv_sec  - t0.tv_sec) +
+                     double(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+    if (rep > -W && total != prevTotal)
+      deterministic = false;
+    prevTotal = total;
+  }
+
+  // The minimum memory traffic: A and B read, C written once:
+  double bytes  = double(A.Bytes()) +
+                  (spgemm ? double(B.Bytes() + C.Bytes())
+                          : double(denseB.size() * sizeof(TIn) +
+                                   denseC.size() * sizeof(TAcc)));
+  std::string info = ", Bands=" + std::to_string(nBands);
+  if (spgemm)
+    info += ", NNZ(C)=" + std::to_string(C.NNZ());
+  auto verify = [&]()
+  {
+    return spgemm
+           ? VerifySparse<TIn, TAcc>(A, &B, nullptr, 0, &C, nullptr)
+           : VerifySparse<TIn, TAcc>(A, nullptr, denseB.data(), m, nullptr,
+                                     denseC.data());
+  };
+  return ReportRun<TAcc>(BenchResult{ A.m_nRows, T, kernel, "", 0, 0, 0.0,
+                                      0.0, flops, bytes, total, -1.0, -1.0,
+                                      -1.0, false },
+                         secs, deterministic, a_opts.m_verify, verify,
+                         nullptr, a_res, info);
+}
+
+//===========================================================================//
+// "RunBatched": The Test for Batches of Small Products:                     //
+//===========================================================================//
+// C[b] = A[b] * B[b] for b in [0, Count), all N x N, stored contiguously.
+// The batch is split into chunks of a fixed size (each one of at least
+// "BatchChunkElems" entries of C, independent of the number of Threads, so
+// that the sum is the same for any number of them); 1 job per chunk, so the
+// cost of "Submit" is amortised over many products:
+//
+long const BatchChunkElems = 65536;
+
+template<typename TIn, typename TAcc>
+int RunBatched(Options const& a_opts, BenchResult* a_res)
+{
+  KernelE kernel = a_opts.m_kernel;
+  long    N      = a_opts.m_N;
+  long    N2     = N * N;
+  int     T      = a_opts.m_T;
+
+  if (a_opts.m_freivalds > 0)
+  {
+    std::cerr << "The Freivalds check is for the dense kernels only"
+              << std::endl;
+    return 1;
+  }
+
+  // The kernel for this size (checked against the generic one):
+  SiriusFMTM::BatchGEMMKernel<TIn, TAcc> batchKern {};
+  try
+    { batchKern = SiriusFMTM::BatchGEMMSelectKernel<TIn, TAcc>
+                  (N, a_opts.m_micro); }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
+    return 1;
+  }
+
+  // By default, A, B and C take 256 MiB together:
+  double elemBytes = double(2 * sizeof(TIn) + sizeof(TAcc));
+  long   count     = (a_opts.m_count > 0)
+                     ? a_opts.m_count
+                     : std::max(1L, long(double(1L << 28) /
+                                         (double(N2) * elemBytes)));
+  long   chunk     = std::max(1L, (BatchChunkElems + N2 - 1) / N2);
+  long   nChunks   = (count + chunk - 1) / chunk;
+  std::cout << "Batched: Kernel=" << batchKern.m_name
+            << ((batchKern.m_N == 0) ? " (any size)" : " (size-specialised)")
+            << ", Count=" << count << ", Chunk=" << chunk << ", NChunks="
+            << nChunks << std::endl;
+
+  SiriusFMTM::AlignedArray<TIn>  memA, memB;
+  SiriusFMTM::AlignedArray<TAcc> memC;
+  TIn*  A = memA.Reserve(size_t(count * N2));
+  TIn*  B = memB.Reserve(size_t(count * N2));
+  TAcc* C = memC.Reserve(size_t(count * N2));
+
+  using WI   = WorkItem<TIn, TAcc>;
+  using Pool = SiriusFMTM::ThreadPool<WI, double,
+                                      decltype(MultAndSum<TIn, TAcc>)>;
+  // As in "Run", the dTLB counter must be created before the Pool:
+  SiriusFMTM::PerfCounter dtlb = SiriusFMTM::PerfCounter::DTLBLoadMisses();
+  Pool TP(size_t(T), size_t(4 * T + 16), MultAndSum<TIn, TAcc>);
+
+  // Fill in A and B, chunk by chunk, in parallel: as "Init" rows of N^2
+  // entries, so that the entries are the same as those of the dense A and B
+  // of size N^2 x N^2 (ie they only depend on the seed):
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  std::vector<WI> inits, chunks;
+  for (long b0 = 0; b0 < count; b0 += chunk)
+  {
+    long b1 = std::min(count, b0 + chunk);
+    inits.push_back (WI{ InitJob<TIn, TAcc>{ .m_N    = N2,
+                                             .m_i0   = b0,
+                                             .m_i1   = b1,
+                                             .m_j0   = 0,
+                                             .m_j1   = N2,
+                                             .m_A    = A,
+                                             .m_B    = B,
+                                             .m_C    = C,
+                                             .m_seed = (unsigned long)
+                                                       (a_opts.m_seed) },
+                         -1 });
+    chunks.push_back(WI{ BatchJob<TIn, TAcc>{ .m_batch = &batchKern,
+                                              .m_N     = N,
+                                              .m_i0    = b0,
+                                              .m_i1    = b1,
+                                              .m_A     = A,
+                                              .m_B     = B,
+                                              .m_C     = C },
+                         -1 });
+  }
+  std::vector<double> chunkSums(chunks.size());
+  RunJobs(TP, inits, chunkSums.data());
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  std::cout << "Init: Time="
+            << (double(t1.tv_sec  - t0.tv_sec) +
+                double(t1.tv_nsec - t0.tv_nsec) * 1e-9)
+            << " sec" << std::endl;
+  PrintHugePages();
+
+  // Warm-up and timed runs, as for the dense kernels:
+  int                 W             = a_opts.m_warmups;
+  int                 R             = a_opts.m_reps;
+  std::vector<double> secs;
+  double              total         = 0.0;
+  double              prevTotal     = 0.0;
+  bool                deterministic = true;
+
+  for (int rep = -W; rep < R; ++rep)
+  {
+    if (rep == 0)
+      dtlb.Enable();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    RunJobs(TP, chunks, chunkSums.data());
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    total = PairwiseSum(chunkSums.data(), nChunks);
+    if (rep >= 0)
+      secs.push_back(double(t1.tv_sec  - t0.tv_sec) +
+                     double(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+    if (rep > -W && total != prevTotal)
+      deterministic = false;
+    prevTotal = total;
+  }
+
+  // A and B read, C written once:
+  double flops  = 2.0 * double(N) * double(N2) * double(count);
+  double bytes  = double(count * N2) * elemBytes;
+
+  // Verify up to 64 of the products, spread over the batch:
+  auto verify = [&]()
+  {
+    long const NCheck = std::min(count, 64L);
+    double     err    = 0.0;
+    for (long r = 0; r < NCheck; ++r)
+    {
+      long b = r * count / NCheck;
+      err    = std::max(err, Verify(N, A + b * N2, B + b * N2, C + b * N2));
+    }
+    return err;
+  };
+  return ReportRun<TAcc>(BenchResult{ N, T, kernel, batchKern.m_name, 0, 0,
+                                      0.0, 0.0, flops, bytes, total, -1.0,
+                                      -1.0, -1.0, false },
+                         secs, deterministic, a_opts.m_verify, verify,
+                         &dtlb, a_res);
+}
+
+//===========================================================================//
+// "RunDistributed": The Test for the "Blocked" Kernel on Remote Workers:    //
+//===========================================================================//
+// A and B are generated here (as in "Run", so they are the same), and the
+// product is computed by the Workers (see "DistGEMM.hpp"), 1 "DistBlock" job
+// per Worker; the Threads of this process only generate A and B:
+//
+long const DistDefaultPanel = 256;
+
+template<typename TIn, typename TAcc>
+int RunDistributed(Options const& a_opts, BenchResult* a_res)
+{
+  using namespace SiriusFMTM;
+  KernelE                 kernel  = a_opts.m_kernel;
+  long                    N       = a_opts.m_N;
+  int                     T       = a_opts.m_T;
+  std::vector<int> const& workers = *a_opts.m_workers;
+  int                     P       = int(workers.size());
+  DistGrid                grid(P);
+  long                    kb      = (a_opts.m_S > 0) ? std::min(a_opts.m_S, N)
+                                                     : DistDefaultPanel;
+
+  if (a_opts.m_freivalds > 0)
+  {
+    std::cerr << "The Freivalds check is not available in the distributed "
+                 "mode" << std::endl;
+    return 1;
+  }
+  if (N < grid.m_Pc)
+  {
+    std::cerr << "MatrixSize is too small for " << P << " Workers"
+              << std::endl;
+    return 1;
+  }
+  std::cout << "Distributed: Workers=" << P << ", Grid=" << grid.m_Pr << 'x'
+            << grid.m_Pc << ", Panel=" << kb << std::endl;
+
+  long                N2 = N * N;
+  AlignedArray<TIn>   memA, memB;
+  AlignedArray<TAcc>  memC;
+  TIn*                A  = memA.Reserve(size_t(N2));
+  TIn*                B  = memB.Reserve(size_t(N2));
+  TAcc*               C  = memC.Reserve(size_t(N2));
+
+  // The Pool for "Init" (T Threads), and the one for the communication with
+  // the Workers (1 Thread per Worker):
+  using WI   = WorkItem<TIn, TAcc>;
+  using Pool = ThreadPool<WI, double, decltype(MultAndSum<TIn, TAcc>)>;
+  Pool TP   (size_t(T), size_t(4 * T + 16), MultAndSum<TIn, TAcc>);
+  Pool commTP(size_t(P), size_t(P + 16),    MultAndSum<TIn, TAcc>);
+
+  // Fill in A and B in bands of rows, in parallel:
+  timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  std::vector<WI> inits;
+  long            band = std::max(1L, N / (4 * long(T)));
+  for (long i0 = 0; i0 < N; i0 += band)
+    inits.push_back(WI{ InitJob<TIn, TAcc>{ .m_N    = N,
+                                            .m_i0   = i0,
+                                            .m_i1   = std::min(N, i0 + band),
+                                            .m_j0   = 0,
+                                            .m_j1   = N,
+                                            .m_A    = A,
+                                            .m_B    = B,
+                                            .m_C    = nullptr,
+                                            .m_seed = (unsigned long)
+                                                      (a_opts.m_seed) },
+                        -1 });
+  std::vector<double> dummy(inits.size());
+  RunJobs(TP, inits, dummy.data());
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  std::cout << "Init: Time="
+            << (double(t1.tv_sec  - t0.tv_sec) +
+                double(t1.tv_nsec - t0.tv_nsec) * 1e-9)
+            << " sec" << std::endl;
+  PrintHugePages();
+
+  // The blocks of C, and the Setup of the Workers:
+  std::vector<DistData> dists;
+  std::vector<WI>       blocks;
+  for (int w = 0; w < P; ++w)
+    dists.push_back(DistData{ workers[size_t(w)], kb });
+  try
+  {
+    for (int w = 0; w < P; ++w)
+    {
+      int  r  = w / grid.m_Pc;
+      int  c  = w % grid.m_Pc;
+      long i0 = DistGrid::BandBegin(N, grid.m_Pr, r);
+      long i1 = DistGrid::BandBegin(N, grid.m_Pr, r + 1);
+      long j0 = DistGrid::BandBegin(N, grid.m_Pc, c);
+      long j1 = DistGrid::BandBegin(N, grid.m_Pc, c + 1);
+      blocks.push_back(WI{ DistBlockJob<TIn, TAcc>{ .m_dist = &dists[size_t(w)],
+                                                    .m_N    = N,
+                                                    .m_i0   = i0,
+                                                    .m_i1   = i1,
+                                                    .m_j0   = j0,
+                                                    .m_j1   = j1,
+                                                    .m_A    = A,
+                                                    .m_B    = B,
+                                                    .m_C    = C },
+                           -1 });
+
+      DistSetup setup { uint32_t(a_opts.m_types), uint32_t(sizeof(TIn)),
+                        uint32_t(sizeof(TAcc)), 0, N, i1 - i0, j1 - j0, kb,
+                        {} };
+      strncpy(setup.m_micro, a_opts.m_micro, sizeof(setup.m_micro) - 1);
+      DistSendHdr(workers[size_t(w)], DistMsgE::Setup, sizeof(setup));
+      DistSendAll(workers[size_t(w)], &setup, sizeof(setup));
+    }
+  }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
+    return 1;
+  }
+
+  // Warm-up and timed runs, as for the local kernels:
+  int                 W             = a_opts.m_warmups;
+  int                 R             = a_opts.m_reps;
+  std::vector<double> secs;
+  std::vector<double> rowSums(static_cast<size_t>(N));
+  double              total         = 0.0;
+  double              prevTotal     = 0.0;
+  bool                deterministic = true;
+
+  for (int rep = -W; rep < R; ++rep)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    std::vector<double> blockRes(blocks.size());
+    if (!RunJobs(commTP, blocks, blockRes.data()))
+    {
+      std::cerr << "The distributed multiplication has failed" << std::endl;
+      return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    // The sum does not depend on how C is split between the Workers:
+    for (long i = 0; i < N; ++i)
+      rowSums[size_t(i)] = PairwiseSum(C + i * N, N);
+    total = PairwiseSum(rowSums.data(), N);
+    if (rep >= 0)
+      secs.push_back(double(t1.tv_sec  - t0.tv_sec) +
+                     double(t1.tv_nsec - t0.tv_nsec) * 1e-9);
+    if (rep > -W && total != prevTotal)
+      deterministic = false;
+    prevTotal = total;
+  }
+
+  // The network traffic: each panel of A goes to the Pc Workers of a grid
+  // row, each one of B to the Pr Workers of a grid column; C comes back once:
+  double flops  = 2.0 * double(N) * double(N2);
+  double bytes  = double(N2) *
+                  (double(grid.m_Pr + grid.m_Pc) * double(sizeof(TIn)) +
+                   double(sizeof(TAcc)));
+  return ReportRun<TAcc>(BenchResult{ N, T, kernel, a_opts.m_micro, 0, 0,
+                                      0.0, 0.0, flops, bytes, total, -1.0,
+                                      -1.0, -1.0, false },
+                         secs, deterministic, a_opts.m_verify,
+                         [&]() { return Verify(N, A, B, C); }, nullptr,
+                         a_res, "", true);
+}
+
+//===========================================================================//
+// "RunWorker": The Worker Side of the Distributed Mode:                     //
+//===========================================================================//
+// Computes the products of the block of C given by "a_setup", with "a_T"
+// Threads, until the next "Setup" or "Quit" (returned in "*a_next"). Each
+// panel product is computed (by bands of rows, in parallel) while the next
+// panel is being received, into the other buffer:
+//
+template<typename TIn, typename TAcc>
+void RunWorker(int a_sd, SiriusFMTM::DistSetup const& a_setup, int a_T,
+               SiriusFMTM::DistMsgHdr* a_next)
+{
+  using namespace SiriusFMTM;
+  if (a_setup.m_inSz != sizeof(TIn) || a_setup.m_accSz != sizeof(TAcc))
+    throw std::runtime_error("RunWorker: Incompatible element types");
+
+  char micro[sizeof(a_setup.m_micro) + 1] {};
+  memcpy(micro, a_setup.m_micro, sizeof(a_setup.m_micro));
+  GEMMMicroKernel<TIn, TAcc> microKern =
+    GEMMSelectKernel<TIn, TAcc>(micro);
+  GEMMBlocking blk =
+    GEMMBlocking::ForCaches(microKern.m_MR, microKern.m_NR, sizeof(TIn));
+
+  long M  = a_setup.m_M;
+  long NC = a_setup.m_NC;
+  long kb = a_setup.m_kb;
+  std::cout << "Worker: Block=" << M << 'x' << NC << ", Panel=" << kb
+            << ", Micro-Kernel=" << microKern.m_name << std::endl;
+
+  // 2 panel buffers, and the local block of C:
+  AlignedArray<TIn>  panels[2];
+  AlignedArray<TAcc> memC;
+  (void) panels[0].Reserve(size_t((M + NC) * kb));
+  (void) panels[1].Reserve(size_t((M + NC) * kb));
+  size_t const       sizeC = size_t(M * NC);
+  TAcc*              C     = memC.Reserve(sizeC);
+
+  // Bands of rows of the block, a few per Thread (all of them fit in the
+  // queue, so "SubmitJobs" does not block):
+  using WI   = WorkItem<TIn, TAcc>;
+  using Pool = ThreadPool<WI, double, decltype(MultAndSum<TIn, TAcc>)>;
+  Pool TP(size_t(a_T), size_t(4 * a_T + 16), MultAndSum<TIn, TAcc>);
+  long band  = std::max(long(microKern.m_MR), M / (4 * long(a_T)));
+
+  std::vector<typename Pool::JobStatusE> stats;
+  std::vector<double>                    dummy;
+  std::vector<WI>                        jobs;
+  bool                                   pending = false;
+  int                                    cur     = 0;
+  for (;;)
+  {
+    DistMsgHdr hdr = DistRecvHdr(a_sd);
+    switch (hdr.m_type)
+    {
+      case DistMsgE::Start:
+        std::fill_n(C, sizeC, TAcc(0));
+        break;
+
+      case DistMsgE::Panel:
       {
-        assert(colBj < B + N2);
-        (*rowCj) += rowA[k] * (*colBj);
-        colBj    += N;
+        int64_t k = 0;
+        DistRecvAll(a_sd, &k, sizeof(k));
+        size_t bytes = size_t((M + NC) * k) * sizeof(TIn);
+        if (k <= 0 || k > kb || hdr.m_len != sizeof(k) + bytes)
+          throw std::runtime_error("RunWorker: Invalid Panel");
+        DistRecvAll(a_sd, panels[cur].Data(), bytes);
+
+        // The previous panel must be done before this one is added to C:
+        if (pending && !WaitJobs(stats))
+          throw std::runtime_error("RunWorker: Panel product failed");
+        jobs.clear();
+        TIn* Ap = panels[cur].Data();
+        for (long i0 = 0; i0 < M; i0 += band)
+          jobs.push_back(WI{ PanelJob<TIn, TAcc>{ .m_micro = &microKern,
+                                                  .m_blk   = &blk,
+                                                  .m_N     = NC,
+                                                  .m_i0    = i0,
+                                                  .m_i1    = std::min(M, i0 +
+                                                                      band),
+                                                  .m_k     = long(k),
+                                                  .m_A     = Ap,
+                                                  .m_B     = Ap + M * k,
+                                                  .m_C     = C },
+                             -1 });
+        dummy.resize(jobs.size());
+        SubmitJobs(TP, jobs, dummy.data(), &stats);
+        pending = true;
+        cur     = 1 - cur;
+        break;
       }
 
-      // Increment the sum:
-      sum += (*rowCj);
+      case DistMsgE::Finish:
+        if (pending && !WaitJobs(stats))
+          throw std::runtime_error("RunWorker: Panel product failed");
+        pending = false;
+        DistSendHdr(a_sd, DistMsgE::Result, sizeC * sizeof(TAcc));
+        DistSendAll(a_sd, C, sizeC * sizeof(TAcc));
+        break;
+
+      case DistMsgE::Setup:
+      case DistMsgE::Quit:
+        if (pending)
+          (void) WaitJobs(stats);
+        *a_next = hdr;
+        return;
+
+      default:
+        throw std::runtime_error("RunWorker: Unexpected message");
     }
-    return sum;
   }
 }
 
 //===========================================================================//
-// "main":                                                                   //
+// "WorkerMain": Connect to the Coordinator, and serve it until "Quit":      //
 //===========================================================================//
-int main(int argc, char* argv[])
+int WorkerMain(std::string const& a_hostPort, int a_T)
 {
-  // Params: MtxSizeN NThreads
-  if (argc < 3)
+  using namespace SiriusFMTM;
+  size_t colon = a_hostPort.rfind(':');
+  int    port  = (colon == std::string::npos)
+                 ? 0 : atoi(a_hostPort.c_str() + colon + 1);
+  if (port <= 0)
   {
-    std::cerr << "Params: MatrixSize NThreads" << std::endl;
+    Usage();
     return 1;
   }
-  long N = atol(argv[1]);
-  int  T = atoi(argv[2]);
-  if (N <= 0 || T <= 0)
+  std::string host = a_hostPort.substr(0, colon);
+  int         sd   = ClientConnect(host.c_str(), port);
+  if (sd < 0)
+    return 1;
+  std::cout << "Worker: Connected to " << a_hostPort << ", NThreads=" << a_T
+            << std::endl;
+
+  int rc = 0;
+  try
   {
-    std::cerr << "Invalid MatrixSize or NThreads" << std::endl;
+    DistMsgHdr hdr = DistRecvHdr(sd);
+    while (hdr.m_type == DistMsgE::Setup)
+    {
+      DistSetup setup;
+      if (hdr.m_len != sizeof(setup))
+        throw std::runtime_error("WorkerMain: Invalid Setup");
+      DistRecvAll(sd, &setup, sizeof(setup));
+      switch (ElemTypesE(setup.m_types))
+      {
+        case ElemTypesE::F64:
+          RunWorker<double, double> (sd, setup, a_T, &hdr); break;
+        case ElemTypesE::F32:
+          RunWorker<float,  float>  (sd, setup, a_T, &hdr); break;
+        case ElemTypesE::F32F64:
+          RunWorker<float,  double> (sd, setup, a_T, &hdr); break;
+        case ElemTypesE::I8I32:
+          RunWorker<int8_t, int32_t>(sd, setup, a_T, &hdr); break;
+        default:
+          throw std::runtime_error("WorkerMain: Invalid element types");
+      }
+    }
+    if (hdr.m_type != DistMsgE::Quit)
+      throw std::runtime_error("WorkerMain: Unexpected message");
+  }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
+    rc = 1;
+  }
+  close(sd);
+  return rc;
+}
+
+//===========================================================================//
+// "Run": The Test for the given Element Types:                              //
+//===========================================================================//
+// The result of the test goes into "*a_res" (if not NULL):
+//
+template<typename TIn, typename TAcc>
+int Run(Options const& a_opts, BenchResult* a_res)
+{
+  KernelE     kernel = a_opts.m_kernel;
+  bool        verify = a_opts.m_verify;
+  long        TM     = a_opts.m_TM;
+  long        TN     = a_opts.m_TN;
+  std::string dir    = a_opts.m_dir;
+  long        S      = a_opts.m_S;
+  long        cutoff = a_opts.m_cutoff;
+  long        N      = a_opts.m_N;
+  int         T      = a_opts.m_T;
+
+  if (kernel == KernelE::SpMM || kernel == KernelE::SpGEMM)
+    return RunSparse<TIn, TAcc>(a_opts, a_res);
+  if (kernel == KernelE::Batched)
+    return RunBatched<TIn, TAcc>(a_opts, a_res);
+
+  if (!a_opts.m_workers->empty())
+    return RunDistributed<TIn, TAcc>(a_opts, a_res);
+
+  // Strassen needs the sums of A and B entries, which may not be
+  // representable in "TIn" (eg int8) or lose precision (float into double):
+  if (kernel == KernelE::Strassen && !std::is_same_v<TIn, TAcc>)
+  {
+    std::cerr << "The \"strassen\" kernel needs the same input and "
+                 "accumulator types" << std::endl;
+    return 1;
+  }
+
+  // Select the Micro-Kernel (checked against the portable one):
+  SiriusFMTM::GEMMMicroKernel<TIn, TAcc> microKern {};
+  try
+    { microKern = SiriusFMTM::GEMMSelectKernel<TIn, TAcc>(a_opts.m_micro); }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
     return 1;
   }
+  SiriusFMTM::GEMMBlocking blk =
+    SiriusFMTM::GEMMBlocking::ForCaches(microKern.m_MR, microKern.m_NR,
+                                        sizeof(TIn));
+  if (TM == 0)
+    DefaultTile(N, microKern, blk, &TM, &TN);
+  TM = std::min(TM, N);
+  TN = std::min(TN, N);
+
+  if (kernel != KernelE::Naive)
+    std::cout << "Micro-Kernel: " << microKern.m_name << " ("
+              << microKern.m_MR << 'x' << microKern.m_NR << "), MC="
+              << blk.m_MC << ", KC=" << blk.m_KC << ", NC=" << blk.m_NC
+              << std::endl;
 
-  // Create square matrices of size N:
+  // Create square matrices of size N, in memory (on huge pages, see "-H") or
+  // in (mapped) files. They are not touched here: the "Init" jobs below do
+  // it, in parallel:
   long    N2   = N*N;
-  double* A    = new double[N2];
-  double* B    = new double[N2];
-  double* C    = new double[N2];
-  double* sums = new double[N];    // Sums of C entries for each row
+  size_t  szIn = size_t(N2) * sizeof(TIn);
+  size_t  szC  = size_t(N2) * sizeof(TAcc);
+  TIn*    A    = nullptr;
+  TIn*    B    = nullptr;
+  TAcc*   C    = nullptr;
+  SiriusFMTM::AlignedArray<TIn>           memA, memB;
+  SiriusFMTM::AlignedArray<TAcc>          memC;
+  std::unique_ptr<SiriusFMTM::MappedFile> fileA, fileB, fileC;
+  bool    fill = true;
 
-  // Fill in "a" and "b" randomly:
-  srand48(long(time(nullptr)));
+  try
+  {
+    if (dir.empty())
+    {
+      A = memA.Reserve(size_t(N2));
+      B = memB.Reserve(size_t(N2));
+      C = memC.Reserve(size_t(N2));
+    }
+    else
+    {
+      // Existing A and B (of the right size) are used as they are:
+      fill  = !(SiriusFMTM::MappedFile::Exists(dir + "/A.bin", szIn) &&
+                SiriusFMTM::MappedFile::Exists(dir + "/B.bin", szIn));
+      fileA.reset(new SiriusFMTM::MappedFile(dir + "/A.bin", szIn, fill));
+      fileB.reset(new SiriusFMTM::MappedFile(dir + "/B.bin", szIn, fill));
+      fileC.reset(new SiriusFMTM::MappedFile(dir + "/C.bin", szC,  true));
+      A = reinterpret_cast<TIn*> (fileA->Data());
+      B = reinterpret_cast<TIn*> (fileB->Data());
+      C = reinterpret_cast<TAcc*>(fileC->Data());
+    }
+  }
+  catch (std::exception const& exn)
+  {
+    std::cerr << exn.what() << std::endl;
+    return 1;
+  }
 
-  for (long n = 0; n < N2; ++n)
+  // In the out-of-core mode, C is computed in S x S blocks, each one from
+  // N/S pairs of blocks of A and B; in memory, there is just 1 block:
+  if (dir.empty())
+    S = N;
+  else
   {
-    A[n] = drand48();
-    B[n] = drand48();
+    if (S == 0)
+      S = DefaultBlock(N, TM, TN, sizeof(TIn));
+    long unit = std::lcm(TM, TN);
+    S = std::min(std::max(S / unit * unit, unit), N);
+    std::cout << "Out-of-Core: Dir=" << dir << ", Block=" << S << 'x' << S
+              << std::endl;
   }
 
+  // 2-D tiles of C, 1 job per tile; the tiles are numbered row by row over
+  // the whole C (so the reduction below is the same in both modes):
+  long nTileCols = (N + TN - 1) / TN;
+  long nTiles    = ((N + TM - 1) / TM) * nTileCols;
+  std::cout << "Tiles: " << TM << 'x' << TN << ", NTiles=" << nTiles
+            << std::endl;
+
+  // NUMA Nodes (with CPUs): if there are several, the Threads are spread
+  // over them, and the bands of rows of the matrices are assigned to the
+  // Nodes in order; a tile is initialised and computed on the Node of its
+  // band:
+  std::vector<int> nodes;
+  SiriusFMTM::CPUTopology topo = SiriusFMTM::CPUTopology::Detect();
+  for (size_t n = 0; n < topo.NNodes(); ++n)
+    if (!topo.m_nodeCPUs[n].empty())
+      nodes.push_back(int(n));
+  bool numa   = nodes.size() > 1;
+  auto nodeOf = [&](long a_i0)
+    { return numa ? nodes[size_t(a_i0 * long(nodes.size()) / N)] : -1; };
+
+  // The dTLB misses of the timed runs, in all Threads (so the counter must
+  // be created before the Pool):
+  SiriusFMTM::PerfCounter dtlb = SiriusFMTM::PerfCounter::DTLBLoadMisses();
+
   // Create a ThreadPool:
-  // "T" is the number of Threads, "N" is BuffSize:
+  // "T" is the number of Threads; the jobs are submitted with back-pressure,
+  // so a few jobs per Thread in the queue are enough:
   //
-  SiriusFMTM::ThreadPool<WorkItem, double, decltype(MultAndSum)> TP
-    (size_t(T), size_t(N), MultAndSum);
+  using WI   = WorkItem<TIn, TAcc>;
+  using Pool = SiriusFMTM::ThreadPool<WI, double,
+                                      decltype(MultAndSum<TIn, TAcc>)>;
+  Pool TP(size_t(T), { typename Pool::LaneConfig{ size_t(4 * T + 16), 1 } },
+          MultAndSum<TIn, TAcc>, Pool::SchedPolicyE::StrictPriority, 64,
+          SiriusFMTM::ThreadConfig{ numa ? SiriusFMTM::ThreadAffinityE::Scatter
+                                         : SiriusFMTM::ThreadAffinityE::None,
+                                    {}, 0 });
+  if (numa)
+    std::cout << "NUMA: NNodes=" << nodes.size() << std::endl;
+
+  timespec t0, t1;
+
+  // Fill in A and B randomly (and zero C, in memory), tile by tile, in
+  // parallel. The entries only depend on the seed, so the results are the
+  // same for any number of Threads, and in both modes:
+  if (fill)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    std::vector<WI> inits;
+    for (long i0 = 0; i0 < N; i0 += TM)
+      for (long j0 = 0; j0 < N; j0 += TN)
+        inits.push_back(WI{ InitJob<TIn, TAcc>{ .m_N    = N,
+                                                .m_i0   = i0,
+                                                .m_i1   = std::min(N, i0 + TM),
+                                                .m_j0   = j0,
+                                                .m_j1   = std::min(N, j0 + TN),
+                                                .m_A    = A,
+                                                .m_B    = B,
+                                                .m_C    = fileC ? nullptr : C,
+                                                .m_seed = (unsigned long)
+                                                          (a_opts.m_seed) },
+                            nodeOf(i0) });
+    std::vector<double> dummy(inits.size());
+    RunJobs(TP, inits, dummy.data());
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    std::cout << "Init: Time="
+              << (double(t1.tv_sec  - t0.tv_sec) +
+                  double(t1.tv_nsec - t0.tv_nsec) * 1e-9)
+              << " sec" << std::endl;
+  }
+  else
+    std::cout << "Using the existing " << dir << "/{A,B}.bin" << std::endl;
+  PrintHugePages();
+
+  // The product is computed "W" times for warm-up (not timed), then "R"
+  // times for measurement:
+  int                 W             = a_opts.m_warmups;
+  int                 R             = a_opts.m_reps;
+  std::vector<double> secs;
+  double              total         = 0.0;
+  double              prevTotal     = 0.0;
+  bool                deterministic = true;
+
+  for (int rep = -W; rep < R; ++rep)
+  {
+    if (rep == 0)
+      dtlb.Enable();
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    std::vector<double> sums(static_cast<size_t>(nTiles));  // Per-tile sums
+    std::vector<WI>     tiles;
+    std::vector<double> tileSums;
+
+    if constexpr (std::is_same_v<TIn, TAcc>)
+      if (kernel == KernelE::Strassen)
+      {
+        // Expand the top levels of the recursion until there are enough
+        // independent sub-products for all Threads (7 per level), and compute
+        // them in parallel; the tile jobs below then only make the sums:
+        int depth = 0;
+        for (long n = 1; n < T && (N >> depth) > cutoff; n *= 7)
+          ++depth;
+        SiriusFMTM::StrassenParams<TAcc> params { &microKern, &blk, cutoff };
+        SiriusFMTM::StrassenPlan<TAcc>   plan
+          ({ N, A, N, B, N, C, N }, params, depth);
+
+        std::vector<WI> prods;
+        for (auto const& prod: plan.Products())
+          prods.push_back(WI{ StrassenJob<TIn, TAcc>{ .m_product = &prod,
+                                                      .m_params  = &params },
+                              -1 });
+        std::vector<double> dummy(prods.size());
+        RunJobs(TP, prods, dummy.data());
+        plan.Finish();
+        if (rep == -W)
+          std::cout << "Strassen: Cutoff=" << cutoff << ", ParallelDepth="
+                  << depth << ", NProducts=" << prods.size() << std::endl;
+      }
+
+    // Start reading the blocks A[I, K] and B[K, J] (rows of the files):
+    auto prefetch = [&](long a_I, long a_J, long a_K)
+    {
+      if (!fileA)
+        return;
+      long nk = std::min(S, N - a_K);
+      for (long i = a_I; i < std::min(N, a_I + S); ++i)
+        fileA->Prefetch(size_t(i * N + a_K) * sizeof(TIn),
+                        size_t(nk)          * sizeof(TIn));
+      for (long k = a_K; k < a_K + nk; ++k)
+        fileB->Prefetch(size_t(k * N + a_J) * sizeof(TIn),
+                        size_t(std::min(S, N - a_J)) * sizeof(TIn));
+    };
+    prefetch(0, 0, 0);
+
+    for (long I = 0; I < N; I += S)
+    {
+      long I1 = std::min(N, I + S);
+      for (long J = 0; J < N; J += S)
+      {
+        long J1 = std::min(N, J + S);
+        for (long K = 0; K < N; K += S)
+        {
+          long K1 = std::min(N, K + S);
+
+          // The next step's blocks are read in while this one is computed:
+          if (K1 < N)
+            prefetch(I, J, K1);
+          else
+          if (J1 < N)
+            prefetch(I, J1, 0);
+          else
+          if (I1 < N)
+            prefetch(I1, 0, 0);
+
+          tiles.clear();
+          for (long i0 = I; i0 < I1; i0 += TM)
+            for (long j0 = J; j0 < J1; j0 += TN)
+              tiles.push_back(WI{ MultiplyJob<TIn, TAcc>
+                                  { .m_kernel = kernel,
+                                    .m_micro  = &microKern,
+                                    .m_blk    = &blk,
+                                    .m_N      = N,
+                                    .m_i0     = i0,
+                                    .m_i1     = std::min(N, i0 + TM),
+                                    .m_j0     = j0,
+                                    .m_j1     = std::min(N, j0 + TN),
+                                    .m_k0     = K,
+                                    .m_k1     = K1,
+                                    .m_A      = A,
+                                    .m_B      = B,
+                                    .m_C      = C },
+                                  nodeOf(i0) });
+          tileSums.resize(tiles.size());
+          RunJobs(TP, tiles, tileSums.data());
+
+          // Only the last step gives the final tile sums:
+          if (K1 == N)
+            for (size_t t = 0; t < tiles.size(); ++t)
+            {
+              auto const& tile =
+                std::get<MultiplyJob<TIn, TAcc>>(tiles[t].m_job);
+              sums[size_t((tile.m_i0 / TM) * nTileCols + tile.m_j0 / TN)] =
+                tileSums[t];
+            }
+        }
+      }
+      // The rows [I, I1) of C are done, and those of A are not needed any
+      // more:
+      if (fileC)
+      {
+        fileC->WriteBack(size_t(I * N) * sizeof(TAcc),
+                         size_t((I1 - I) * N) * sizeof(TAcc));
+        fileA->Release  (size_t(I * N) * sizeof(TIn),
+                         size_t((I1 - I) * N) * sizeof(TIn));
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double sec = double(t1.tv_sec  - t0.tv_sec) +
+                 double(t1.tv_nsec - t0.tv_nsec) * 1e-9;
 
-  // Completion flags:
-  decltype(TP)::JobStatusE* stats = new decltype(TP)::JobStatusE[N];
+    // All done, make the final sum: a tree reduction, with the lower levels
+    // (fixed-size chunks of "sums") done in parallel:
+    std::vector<WI> chunks;
+    for (long i0 = 0; i0 < nTiles; i0 += ReduceChunk)
+      chunks.push_back(WI{ ReduceJob{ .m_sums = sums.data(),
+                                      .m_i0   = i0,
+                                      .m_i1   = std::min(nTiles,
+                                                         i0 + ReduceChunk) },
+                           -1 });
+    std::vector<double> chunkSums(chunks.size());
+    RunJobs(TP, chunks, chunkSums.data());
+    total = PairwiseSum(chunkSums.data(), long(chunkSums.size()));
 
-  // Will create 1 job per each C row:
-  for (long i = 0; i < N; ++i)
+    // The warm-up runs are not timed. The result must not change between
+    // the runs (the reduction order is fixed):
+    if (rep >= 0)
+      secs.push_back(sec);
+    if (rep > -W && total != prevTotal)
+      deterministic = false;
+    prevTotal = total;
+  }
+
+  // The memory traffic which the blocking implies: each block of A is read
+  // once per block column of C, each block of B once per block row of C, and
+  // the blocks of C are written N/S times, and read back N/S-1 times (in
+  // memory, S=N, so this is the minimum: A and B read, C written once):
+  double nBlks  = double((N + S - 1) / S);
+  double bytes  = double(N2) * (2.0 * nBlks * double(sizeof(TIn)) +
+                                (2.0 * nBlks - 1.0) * double(sizeof(TAcc)));
+
+  BenchResult res {};
+  int         rc  =
+    ReportRun<TAcc>(BenchResult{ N, T, kernel,
+                                 (kernel == KernelE::Naive)
+                                 ? "" : microKern.m_name,
+                                 TM, TN, 0.0, 0.0,
+                                 2.0 * double(N) * double(N2), bytes, total,
+                                 -1.0, -1.0, -1.0, false },
+                    secs, deterministic, verify,
+                    [&]() { return Verify(N, A, B, C); }, &dtlb, &res);
+
+  // Freivalds' check with "k" random vectors: O(k*N^2) instead of O(N^3),
+  // so it is affordable at any size; a wrong C passes it with a negligible
+  // probability. Done in row bands, on the same Nodes as the multiply:
+  if (a_opts.m_freivalds > 0)
   {
-    // According to our (C/C++) convention, matrices are stored row-wise:
-    // "offI" is the offset of row "i" in "A" and "C":
-    long     offI = i * N;
-    WorkItem wi     { N, N2, A + offI, B, C + offI };
-    double* resI  = sums  + i;   // Sum C[i,*] comes here!
-    auto    stat  = stats + i;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long                k = a_opts.m_freivalds;
+    std::vector<double> X(size_t(N * k)), Y(X.size()), absY(X.size());
+
+    // X is from the stream 2 of the seed (after A and B), in [-1, 1); with
+    // integers, it is +-1, so that the whole check is exact:
+    SiriusFMTM::Philox4x32 genX((unsigned long)(a_opts.m_seed), 2);
+    RandomFill(genX, X.data(), 0, N * k);
+    for (double& x: X)
+      x = std::is_integral_v<TAcc> ? ((x < 0.5) ? -1.0 : 1.0) : 2.0 * x - 1.0;
+    FreivaldsData frv { k, X.data(), Y.data(), absY.data() };
+
+    double residual = 0.0;
+    for (bool AC: { false, true })
+    {
+      std::vector<WI> bands;
+      for (long i0 = 0; i0 < N; i0 += TM)
+        bands.push_back(WI{ FreivaldsJob<TIn, TAcc>
+                              { .m_AC  = AC,
+                                .m_N   = N,
+                                .m_i0  = i0,
+                                .m_i1  = std::min(N, i0 + TM),
+                                .m_A   = A,
+                                .m_B   = B,
+                                .m_C   = C,
+                                .m_frv = &frv },
+                            nodeOf(i0) });
+      std::vector<double> bandRes(bands.size());
+      RunJobs(TP, bands, bandRes.data());
+      for (double r: bandRes)
+        residual = std::max(residual, r);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    bool pass = residual <= FreivaldsTol<TAcc>(kernel, N);
+    std::cout << "Freivalds: Rounds=" << k << ", MaxResidual=" << residual
+              << ", Time="
+              << (double(t1.tv_sec  - t0.tv_sec) +
+                  double(t1.tv_nsec - t0.tv_nsec) * 1e-9)
+              << " sec" << (pass ? ", OK" : ", FAILED") << std::endl;
+    res.m_residual = residual;
+    res.m_ok       = res.m_ok && pass;
+    if (!pass)
+      rc = 2;
+  }
+
+  if (a_res != nullptr)
+    *a_res = res;
+  return rc;
+}
+
+//===========================================================================//
+// "main":                                                                   //
+//===========================================================================//
+int main(int argc, char* argv[])
+{
+  // Options:
+  std::vector<KernelE> kernels { KernelE::Blocked };
+  ElemTypesE  types   = ElemTypesE::F64;
+  bool        verify  = false;
+  char const* micro   = "auto";
+  long        TM      = 0;    // 0: Default tile size
+  long        TN      = 0;
+  long        seed    = long(time(nullptr));
+  std::string dir;            // Non-empty: out-of-core mode
+  long        S       = 0;    // Out-of-core block size; 0: Default
+  long        cutoff  = 512;  // For "Strassen"
+  int         warmups = 0;
+  int         reps    = 1;
+  std::string out;            // Non-empty: JSON or CSV results file
+  int         rounds  = 0;    // Freivalds rounds; 0: no Freivalds check
+  double      density = 0.01; // For the sparse kernels
+  std::string mtxA, mtxB;     // Non-empty: sparse A, B from these files
+  long        m       = 64;   // Cols of the dense B of "SpMM"
+  long        count   = 0;    // Size of the batch of "Batched"; 0: Default
+  std::string coord;          // Non-empty: "Port:NWorkers" (Coordinator)
+  std::string worker;         // Non-empty: "Host:Port" (Worker)
+  int         opt;
+  while ((opt = getopt(argc, argv,
+                       "k:e:s:c:t:f:b:r:w:n:o:vF:D:i:m:B:C:W:H:")) != -1)
+    switch (opt)
+    {
+      case 'k':
+        kernels.clear();
+        for (std::string const& name: SplitList(optarg))
+        {
+          int k = 0;
+          int const nk = int(std::size(KernelNames));
+          while (k < nk && name != KernelNames[k])
+            ++k;
+          if (k == nk)
+          {
+            Usage();
+            return 1;
+          }
+          kernels.push_back(KernelE(k));
+        }
+        break;
+      case 'e':
+      {
+        int e = 0;
+        while (e < 4 && strcmp(optarg, ElemTypesNames[e]) != 0)
+          ++e;
+        if (e == 4)
+        {
+          Usage();
+          return 1;
+        }
+        types   = ElemTypesE(e);
+        break;
+      }
+      case 's':
+        micro   = optarg;
+        break;
+      case 'c':
+        cutoff  = atol(optarg);
+        if (cutoff <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 't':
+      {
+        int n = sscanf(optarg, "%ldx%ld", &TM, &TN);
+        if (n == 1)
+          TN = TM;
+        if (n < 1 || TM <= 0 || TN <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      }
+      case 'f':
+        dir     = optarg;
+        break;
+      case 'b':
+        S       = atol(optarg);
+        if (S <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'r':
+        seed    = atol(optarg);
+        break;
+      case 'w':
+        warmups = atoi(optarg);
+        if (warmups < 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'n':
+        reps    = atoi(optarg);
+        if (reps <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'o':
+        out     = optarg;
+        break;
+      case 'v':
+        verify  = true;
+        break;
+      case 'F':
+        rounds  = atoi(optarg);
+        if (rounds <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'D':
+        density = atof(optarg);
+        if (!(density > 0.0 && density <= 1.0))
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'i':
+      {
+        std::vector<std::string> files = SplitList(optarg);
+        if (files.size() > 2 || files[0].empty())
+        {
+          Usage();
+          return 1;
+        }
+        mtxA    = files[0];
+        mtxB    = (files.size() == 2) ? files[1] : "";
+        break;
+      }
+      case 'm':
+        m       = atol(optarg);
+        if (m <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'C':
+        coord   = optarg;
+        break;
+      case 'W':
+        worker  = optarg;
+        break;
+      case 'B':
+        count   = atol(optarg);
+        if (count <= 0)
+        {
+          Usage();
+          return 1;
+        }
+        break;
+      case 'H':
+      {
+        int h = 0;
+        while (h < 3 && strcmp(optarg, SiriusFMTM::HugePagesNames[h]) != 0)
+          ++h;
+        if (h == 3)
+        {
+          Usage();
+          return 1;
+        }
+        SiriusFMTM::HugePagesSetMode(SiriusFMTM::HugePagesE(h));
+        break;
+      }
+      default:
+        Usage();
+        return 1;
+    }
 
-    // Submit the WorkItem:
-    TP.Submit(wi, resI, stat);
+  // Worker: the only Param is NThreads, the rest comes from the Coordinator:
+  if (!worker.empty())
+  {
+    int T = (argc - optind == 1) ? atoi(argv[optind]) : 0;
+    if (T <= 0)
+    {
+      Usage();
+      return 1;
+    }
+    return WorkerMain(worker, T);
   }
 
-  // Wait for completion of all WorkItems:
-  while (true)
+  // Params: MtxSizeN[,...] NThreads[,...]
+  if (argc - optind < 2)
+  {
+    Usage();
+    return 1;
+  }
+  std::vector<long> Ns, Ts;
+  for (std::string const& n: SplitList(argv[optind]))
+    Ns.push_back(atol(n.c_str()));
+  for (std::string const& t: SplitList(argv[optind + 1]))
+    Ts.push_back(atol(t.c_str()));
+  // With Matrix Market files, the size is theirs:
+  if ((mtxA.empty() && *std::min_element(Ns.begin(), Ns.end()) <= 0) ||
+      *std::min_element(Ts.begin(), Ts.end()) <= 0)
   {
-    bool allCompleted = true;
-    for (long i = 0; allCompleted && i < N; ++i)
-      if (stats[i] != decltype(TP)::JobStatusE::Completed)
-        allCompleted = false;
+    std::cerr << "Invalid MatrixSize or NThreads" << std::endl;
+    return 1;
+  }
+  for (KernelE kernel: kernels)
+    if (!dir.empty() && kernel != KernelE::Naive && kernel != KernelE::Blocked)
+    {
+      std::cerr << "The \"" << KernelNames[int(kernel)]
+                << "\" kernel is in-memory only" << std::endl;
+      return 1;
+    }
 
-    if (allCompleted)
-      break;
+  for (KernelE kernel: kernels)
+    if (!coord.empty() && (kernel != KernelE::Blocked || !dir.empty()))
+    {
+      std::cerr << "The distributed mode is for the in-memory \"blocked\" "
+                   "kernel only" << std::endl;
+      return 1;
+    }
 
-    // Otherwise, sleep for a short while (1 msec = 10^6 nsec):
-    timespec   msec { 0, 1'000'000 };
-    nanosleep(&msec, nullptr);
+  // Coordinator: wait for all Workers to connect; they stay connected for
+  // all the tests:
+  std::vector<int> workers;
+  if (!coord.empty())
+  {
+    int port = 0, nWorkers = 0;
+    if (sscanf(coord.c_str(), "%d:%d", &port, &nWorkers) != 2 ||
+        port <= 0 || nWorkers <= 0)
+    {
+      Usage();
+      return 1;
+    }
+    int lsd = ListenerSetup(port);
+    if (lsd < 0)
+      return 1;
+    std::cout << "Coordinator: Port=" << port << ", waiting for "
+              << nWorkers << " Workers..." << std::endl;
+    while (int(workers.size()) < nWorkers)
+    {
+      int sd = -1;
+      if (ServerAccept(lsd, &sd, 1) < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        std::cerr << "accept: " << strerror(errno) << std::endl;
+        return 1;
+      }
+      workers.push_back(sd);
+    }
+    close(lsd);
   }
 
-  // All done, make the final sum:
-  double total = 0.0;
-  for (long i = 0; i < N; ++i)
-    total += sums[i];
-  std::cout << "N=" << N << ", TotalSum=" << total << std::endl;
+  // All combinations of the matrix sizes, kernels and numbers of Threads:
+  bool                     sweep = Ns.size() * Ts.size() * kernels.size() > 1;
+  std::vector<BenchResult> results;
+  int                      rc    = 0;
+  for (long N: Ns)
+    for (KernelE kernel: kernels)
+      for (long T: Ts)
+      {
+        if (sweep)
+          std::cout << "==> N=" << N << ", NThreads=" << T << ", Kernel="
+                    << KernelNames[int(kernel)] << std::endl;
+        Options opts { kernel, verify, micro, TM, TN, seed, dir, S, cutoff,
+                       N, int(T), warmups, reps, rounds, density, mtxA,
+                       mtxB, m, count, types, &workers };
+        BenchResult res {};
+        int         r   = 1;
+        switch (types)
+        {
+          case ElemTypesE::F64:    r = Run<double, double> (opts, &res); break;
+          case ElemTypesE::F32:    r = Run<float,  float>  (opts, &res); break;
+          case ElemTypesE::F32F64: r = Run<float,  double> (opts, &res); break;
+          case ElemTypesE::I8I32:  r = Run<int8_t, int32_t>(opts, &res); break;
+        }
+        if (r == 1)
+          return 1;
+        rc = std::max(rc, r);
+        results.push_back(res);
+      }
+
+  // Let the Workers go:
+  for (int sd: workers)
+  {
+    try
+      { SiriusFMTM::DistSendHdr(sd, SiriusFMTM::DistMsgE::Quit); }
+    catch (std::exception const&)
+      {}
+    close(sd);
+  }
 
-  delete[] A;     A     = nullptr;
-  delete[] B;     B     = nullptr;
-  delete[] C;     C     = nullptr;
-  delete[] sums;  sums  = nullptr;
-  delete[] stats; stats = nullptr;
-  return 0;
+  if (!out.empty() &&
+      !WriteResults(out, ElemTypesNames[int(types)],
+                    SiriusFMTM::HugePagesNames
+                      [int(SiriusFMTM::HugePagesMode())], results))
+  {
+    std::cerr << "Cannot write " << out << std::endl;
+    return 1;
+  }
+  return rc;
 }
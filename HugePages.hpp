@@ -0,0 +1,195 @@
+// vim:ts=2:et
+//============================================================================//
+//                                "HugePages.hpp":                            //
+//            Allocation of Large Arrays on Huge (2 MiB) Pages, Linux         //
+//============================================================================//
+// With 4 KiB pages, a large matrix spans far more pages than the TLB has
+// entries, so strided accesses (eg down the columns of B) miss in it all the
+// time; a 2 MiB page covers 512 times more memory per TLB entry. The pages
+// are requested according to the mode:
+// (*) "HugeTLB": with MAP_HUGETLB, from the pool of reserved huge pages (see
+//     "vm.nr_hugepages"); if there are not enough of them, as with "THP";
+// (*) "THP":     aligned to 2 MiB, and advised with MADV_HUGEPAGE, so that
+//     Transparent Huge Pages are used (also if THP is only "madvise"); the
+//     kernel may still use 4 KiB pages, if it has no free 2 MiB ones;
+// (*) "Off":     4 KiB pages (MADV_NOHUGEPAGE, even if THP is "always"), as
+//     the baseline for benchmarks.
+// Allocations smaller than a huge page always get 4 KiB pages. The memory is
+// page-aligned and zero-filled:
+//
+#pragma once
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // Modes:                                                                   //
+  //==========================================================================//
+  enum class HugePagesE
+  {
+    Off,
+    THP,
+    HugeTLB
+  };
+
+  // As given on the command line:
+  char const* const HugePagesNames[] { "off", "thp", "hugetlb" };
+
+  constexpr size_t HugePageSize = size_t(2) << 20;
+
+  //==========================================================================//
+  // "HugePagesStats": Counters since the start of the process:               //
+  //==========================================================================//
+  struct HugePagesStats
+  {
+    long m_nAllocs;       // Total "HugeAlloc" calls
+    long m_nFallbacks;    //   for which MAP_HUGETLB failed
+    long m_hugeTLBPages;  // Pages mapped with MAP_HUGETLB (currently)
+    long m_thpBytes;      // Bytes advised with MADV_HUGEPAGE (currently)
+    long m_anonHugeBytes; // THP actually obtained, by the whole process
+  };
+
+  namespace Detail
+  {
+    struct HugePagesState
+    {
+      std::atomic<HugePagesE> m_mode         { HugePagesE::HugeTLB };
+      std::atomic<long>       m_nAllocs      { 0 };
+      std::atomic<long>       m_nFallbacks   { 0 };
+      std::atomic<long>       m_hugeTLBPages { 0 };
+      std::atomic<long>       m_thpBytes     { 0 };
+    };
+
+    inline HugePagesState& HugePagesGlobal()
+    {
+      static HugePagesState s_state;
+      return s_state;
+    }
+  } // End namespace Detail
+
+  //==========================================================================//
+  // Mode and Stats:                                                          //
+  //==========================================================================//
+  // The mode applies to subsequent allocations:
+  //
+  inline void HugePagesSetMode(HugePagesE a_mode)
+    { Detail::HugePagesGlobal().m_mode.store(a_mode); }
+
+  inline HugePagesE HugePagesMode()
+    { return Detail::HugePagesGlobal().m_mode.load(); }
+
+  // "m_anonHugeBytes" is "AnonHugePages" of "/proc/self/smaps_rollup" (0 if
+  // not available); it is only known after the pages have been touched:
+  //
+  inline HugePagesStats HugePagesGetStats()
+  {
+    Detail::HugePagesState const& st = Detail::HugePagesGlobal();
+    HugePagesStats res
+      { st.m_nAllocs.load(std::memory_order_relaxed),
+        st.m_nFallbacks.load(std::memory_order_relaxed),
+        st.m_hugeTLBPages.load(std::memory_order_relaxed),
+        st.m_thpBytes.load(std::memory_order_relaxed), 0 };
+
+    std::ifstream smaps("/proc/self/smaps_rollup");
+    for (std::string key; smaps >> key; )
+      if (key == "AnonHugePages:")
+      {
+        long kb = 0;
+        if (smaps >> kb)
+          res.m_anonHugeBytes = kb * 1024;
+        break;
+      }
+    return res;
+  }
+
+  //==========================================================================//
+  // "HugeBlock": An Allocated Block:                                         //
+  //==========================================================================//
+  struct HugeBlock
+  {
+    void*      m_data;
+    size_t     m_size;    // Mapped size (rounded up), in bytes
+    HugePagesE m_pages;   // What was actually requested (Off: 4 KiB pages)
+  };
+
+  //==========================================================================//
+  // "HugeAlloc": Throws "std::bad_alloc" if no memory can be mapped:         //
+  //==========================================================================//
+  inline HugeBlock HugeAlloc(size_t a_bytes)
+  {
+    Detail::HugePagesState& st = Detail::HugePagesGlobal();
+    st.m_nAllocs.fetch_add(1, std::memory_order_relaxed);
+
+    HugePagesE mode = st.m_mode.load();
+    bool       huge = (a_bytes >= HugePageSize);
+    size_t     gran = huge ? HugePageSize : size_t(sysconf(_SC_PAGESIZE));
+    size_t     len  = (std::max<size_t>(a_bytes, 1) + gran - 1) / gran * gran;
+
+    if (huge && mode == HugePagesE::HugeTLB)
+    {
+      void* data = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (data != MAP_FAILED)
+      {
+        st.m_hugeTLBPages.fetch_add(long(len / HugePageSize),
+                                    std::memory_order_relaxed);
+        return HugeBlock{ data, len, HugePagesE::HugeTLB };
+      }
+      st.m_nFallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // For huge pages, map 1 more of them, so that the block can be aligned
+    // to 2 MiB, and unmap the excess at both ends:
+    size_t extra = huge ? HugePageSize : 0;
+    void*  raw   = mmap(nullptr, len + extra, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+      throw std::bad_alloc();
+    if (!huge)
+      return HugeBlock{ raw, len, HugePagesE::Off };
+
+    char*  from = static_cast<char*>(raw);
+    char*  data = reinterpret_cast<char*>
+                  ((uintptr_t(from) + HugePageSize - 1) & ~(HugePageSize - 1));
+    size_t head = size_t(data - from);
+    if (head > 0)
+      (void) munmap(from, head);
+    if (head < extra)
+      (void) munmap(data + len, extra - head);
+
+    if (mode == HugePagesE::Off)
+    {
+      (void) madvise(data, len, MADV_NOHUGEPAGE);
+      return HugeBlock{ data, len, HugePagesE::Off };
+    }
+    (void) madvise(data, len, MADV_HUGEPAGE);
+    st.m_thpBytes.fetch_add(long(len), std::memory_order_relaxed);
+    return HugeBlock{ data, len, HugePagesE::THP };
+  }
+
+  //==========================================================================//
+  // "HugeFree": Nothing is done for a NULL block:                            //
+  //==========================================================================//
+  inline void HugeFree(HugeBlock const& a_block)
+  {
+    if (a_block.m_data == nullptr)
+      return;
+    (void) munmap(a_block.m_data, a_block.m_size);
+
+    Detail::HugePagesState& st = Detail::HugePagesGlobal();
+    if (a_block.m_pages == HugePagesE::HugeTLB)
+      st.m_hugeTLBPages.fetch_sub(long(a_block.m_size / HugePageSize),
+                                  std::memory_order_relaxed);
+    else
+    if (a_block.m_pages == HugePagesE::THP)
+      st.m_thpBytes.fetch_sub(long(a_block.m_size),
+                              std::memory_order_relaxed);
+  }
+} // End namespace SiriusFMTM
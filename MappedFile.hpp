@@ -0,0 +1,155 @@
+// vim:ts=2:et
+//============================================================================//
+//                               "MappedFile.hpp":                            //
+//                     Memory-Mapped Files (RAII Wrapper, Linux)              //
+//============================================================================//
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/core/noncopyable.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "MappedFile":                                                            //
+  //==========================================================================//
+  class MappedFile: public boost::noncopyable
+  {
+  private:
+    int     m_fd;
+    char*   m_data;
+    size_t  m_size;
+    size_t  m_pageSz;
+
+    [[noreturn]] static void Fail(char const* a_what, std::string const& a_path)
+    {
+      throw std::runtime_error(std::string("MappedFile: ") + a_what + ": " +
+                               a_path + ": " + strerror(errno));
+    }
+
+    // Page-aligned range covering [a_off, a_off + a_len), clipped to the file:
+    bool PageRange(size_t a_off, size_t a_len, char** a_from, size_t* a_n)
+      const
+    {
+      if (a_off >= m_size || a_len == 0)
+        return false;
+      size_t from = a_off / m_pageSz * m_pageSz;
+      size_t to   = std::min(a_off + a_len, m_size);
+      *a_from     = m_data + from;
+      *a_n        = to - from;
+      return true;
+    }
+
+  public:
+    //------------------------------------------------------------------------//
+    // Non-Default Ctor:                                                      //
+    //------------------------------------------------------------------------//
+    // "a_writable": The file is created if it does not exist, and resized to
+    // "a_size" bytes; otherwise, it must exist and be of that size:
+    //
+    MappedFile(std::string const& a_path, size_t a_size, bool a_writable)
+    : m_fd    (-1),
+      m_data  (nullptr),
+      m_size  (a_size),
+      m_pageSz(size_t(sysconf(_SC_PAGESIZE)))
+    {
+      m_fd = a_writable ? open(a_path.c_str(), O_RDWR | O_CREAT, 0644)
+                        : open(a_path.c_str(), O_RDONLY);
+      if (m_fd < 0)
+        Fail("Cannot open", a_path);
+
+      struct stat st;
+      if (fstat(m_fd, &st) != 0)
+      {
+        close(m_fd);
+        Fail("Cannot stat", a_path);
+      }
+      if (size_t(st.st_size) != a_size)
+      {
+        if (!a_writable)
+        {
+          close(m_fd);
+          errno = EINVAL;
+          Fail("Wrong size", a_path);
+        }
+        if (ftruncate(m_fd, off_t(a_size)) != 0)
+        {
+          close(m_fd);
+          Fail("Cannot resize", a_path);
+        }
+      }
+      void* data = mmap(nullptr, a_size,
+                        a_writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+                        MAP_SHARED, m_fd, 0);
+      if (data == MAP_FAILED)
+      {
+        close(m_fd);
+        Fail("Cannot map", a_path);
+      }
+      m_data = static_cast<char*>(data);
+    }
+
+    ~MappedFile()
+    {
+      (void) munmap(m_data, m_size);
+      (void) close (m_fd);
+    }
+
+    //------------------------------------------------------------------------//
+    // Accessors:                                                             //
+    //------------------------------------------------------------------------//
+    char*  Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+
+    // Does the file exist with the given size?
+    static bool Exists(std::string const& a_path, size_t a_size)
+    {
+      struct stat st;
+      return stat(a_path.c_str(), &st) == 0 && size_t(st.st_size) == a_size;
+    }
+
+    //------------------------------------------------------------------------//
+    // "Prefetch": Start asynchronous read-ahead of a range:                  //
+    //------------------------------------------------------------------------//
+    void Prefetch(size_t a_off, size_t a_len) const
+    {
+      char*  from;
+      size_t n;
+      if (PageRange(a_off, a_len, &from, &n))
+        (void) madvise(from, n, MADV_WILLNEED);
+    }
+
+    //------------------------------------------------------------------------//
+    // "WriteBack": Start asynchronous write-back of a range, and drop it     //
+    // from the process (the data remain in the page cache until written):    //
+    //------------------------------------------------------------------------//
+    void WriteBack(size_t a_off, size_t a_len) const
+    {
+      char*  from;
+      size_t n;
+      if (PageRange(a_off, a_len, &from, &n))
+      {
+        (void) msync  (from, n, MS_ASYNC);
+        (void) madvise(from, n, MADV_DONTNEED);
+      }
+    }
+
+    //------------------------------------------------------------------------//
+    // "Release": Drop a (read-only) range from the process:                  //
+    //------------------------------------------------------------------------//
+    void Release(size_t a_off, size_t a_len) const
+    {
+      char*  from;
+      size_t n;
+      if (PageRange(a_off, a_len, &from, &n))
+        (void) madvise(from, n, MADV_DONTNEED);
+    }
+  };
+} // End namespace SiriusFMTM
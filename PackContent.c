@@ -0,0 +1,405 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                "PackContent.c":                           //
+//            Packing a Static Content Tree into a "ContentPack" Archive     //
+//===========================================================================//
+// All regular files under ContentDir (and symlinks to them) are packed
+// under the paths "/sub/dir/file", with the same response headers as those
+// of "ProcessHTTPReqs". The archive is written to "Archive.tmp" and then
+// renamed into place, so that running servers keep the (old) archive they
+// have mapped:
+//
+#define _XOPEN_SOURCE 700   // For "nftw"
+#include "ContentPack.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <assert.h>
+
+// Max displacement tried for a bucket, before trying another seed:
+#define MaxDisp   (1 << 20)
+#define MaxSeeds  64
+
+//===========================================================================//
+// The Files Found:                                                          //
+//===========================================================================//
+typedef struct FileInfo
+{
+  char*     m_path;       // As requested, ie relative to the root, with '/'
+  size_t    m_pathLen;
+  uint64_t  m_size;
+} FileInfo;
+
+static FileInfo*  s_files   = NULL;
+static size_t     s_nFiles  = 0;
+static size_t     s_cap     = 0;
+static size_t     s_rootLen = 0;
+
+//---------------------------------------------------------------------------//
+// "AddFile": The "nftw" call-back:                                          //
+//---------------------------------------------------------------------------//
+static int AddFile(char const* a_fpath, struct stat const* a_st, int a_flag,
+                   struct FTW* a_ftw)
+{
+  (void) a_ftw;
+  // Symlinks to regular files are packed as those files (as they would be
+  // served from the file system), but those to dirs are not followed:
+  struct stat target;
+  if (a_flag == FTW_SL && stat(a_fpath, &target) == 0)
+  {
+    a_st   = &target;
+    a_flag = FTW_F;
+  }
+  if (a_flag != FTW_F || !S_ISREG(a_st->st_mode))
+    return 0;
+
+  if (s_nFiles == s_cap)
+  {
+    size_t    cap   = (s_cap == 0) ? 1024 : 2 * s_cap;
+    FileInfo* files = (FileInfo*) realloc(s_files, cap * sizeof(FileInfo));
+    if (files == NULL)
+      return -1;
+    s_files = files;
+    s_cap   = cap;
+  }
+  char const* path = a_fpath + s_rootLen;
+  FileInfo*   fi   = s_files + s_nFiles;
+  fi->m_pathLen    = strlen(path);
+  fi->m_path       = strdup(path);
+  fi->m_size       = (uint64_t) a_st->st_size;
+  if (fi->m_path == NULL || fi->m_pathLen > UINT32_MAX)
+    return -1;
+  ++s_nFiles;
+  return 0;
+}
+
+//===========================================================================//
+// "BuildHash": Minimal Perfect Hash of the Paths, for the given Seed:       //
+//===========================================================================//
+// "Hash and displace": the buckets are placed largest first, each one with
+// the smallest displacement which puts all its paths into free slots; the
+// 1-path buckets then take the remaining slots directly. Fills in "a_disp"
+// (per bucket) and "a_slotOf" (per file). Returns 0 on success, (-1) if some
+// bucket could not be placed with this seed:
+//
+static int BuildHash(uint64_t a_seed, size_t a_nBuckets, int32_t* a_disp,
+                     uint32_t* a_slotOf)
+{
+  size_t const n       = s_nFiles;
+  uint32_t*    bucket  = (uint32_t*) malloc(n * sizeof(uint32_t));
+  uint32_t*    start   = (uint32_t*) calloc(a_nBuckets + 1, sizeof(uint32_t));
+  uint32_t*    members = (uint32_t*) malloc(n * sizeof(uint32_t));
+  uint32_t*    order   = (uint32_t*) malloc(a_nBuckets * sizeof(uint32_t));
+  char*        used    = (char*)     calloc(n, 1);
+  uint32_t*    slots   = NULL;
+  int          rc      = -1;
+  if (bucket == NULL || start == NULL || members == NULL || order == NULL ||
+      used   == NULL)
+    goto Done;
+
+  // The files of each bucket (counting sort), and the buckets by size:
+  size_t maxSize = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    bucket[i] = (uint32_t)
+      (ContentPackHash(s_files[i].m_path, s_files[i].m_pathLen, a_seed) %
+       a_nBuckets);
+    ++start[bucket[i] + 1];
+  }
+  for (size_t b = 0; b < a_nBuckets; ++b)
+  {
+    if (start[b + 1] > maxSize)
+      maxSize = start[b + 1];
+    start[b + 1] += start[b];
+  }
+  for (size_t i = 0; i < n; ++i)
+    members[start[bucket[i]]++] = (uint32_t) i;
+  for (size_t b = a_nBuckets; b > 0; --b)
+    start[b] = start[b - 1];
+  start[0] = 0;
+
+  size_t nOrder = 0;
+  for (size_t sz = maxSize; sz > 0; --sz)
+    for (size_t b = 0; b < a_nBuckets; ++b)
+      if (start[b + 1] - start[b] == sz)
+        order[nOrder++] = (uint32_t) b;
+
+  slots = (uint32_t*) malloc((maxSize + 1) * sizeof(uint32_t));
+  if (slots == NULL)
+    goto Done;
+  memset(a_disp, '\0', a_nBuckets * sizeof(int32_t));
+
+  size_t next = 0;    // The 1st possibly free slot, for the 1-path buckets
+  for (size_t o = 0; o < nOrder; ++o)
+  {
+    uint32_t b  = order[o];
+    size_t   sz = start[b + 1] - start[b];
+    if (sz == 1)
+    {
+      while (used[next])
+        ++next;
+      used[next]                   = 1;
+      a_slotOf[members[start[b]]]  = (uint32_t) next;
+      a_disp[b]                    = -(int32_t) next - 1;
+      continue;
+    }
+    int32_t d = 1;
+    for (; d <= MaxDisp; ++d)
+    {
+      size_t k = 0;
+      for (; k < sz; ++k)
+      {
+        FileInfo const* fi = s_files + members[start[b] + k];
+        uint32_t        s  = (uint32_t)
+          (ContentPackHash(fi->m_path, fi->m_pathLen, a_seed + (uint64_t) d)
+           % n);
+        size_t j = 0;
+        while (j < k && slots[j] != s)
+          ++j;
+        if (used[s] || j < k)
+          break;
+        slots[k] = s;
+      }
+      if (k == sz)
+        break;
+    }
+    if (d > MaxDisp)
+      goto Done;
+    for (size_t k = 0; k < sz; ++k)
+    {
+      used[slots[k]]                   = 1;
+      a_slotOf[members[start[b] + k]]  = slots[k];
+    }
+    a_disp[b] = d;
+  }
+  rc = 0;
+
+Done:
+  free(bucket);
+  free(start);
+  free(members);
+  free(order);
+  free(used);
+  free(slots);
+  return rc;
+}
+
+//===========================================================================//
+// "CopyFile": Copy "a_size" bytes of the file "a_path" to "a_off" in "a_fd"://
+//===========================================================================//
+static int CopyFile(char const* a_path, uint64_t a_size, int a_fd,
+                    uint64_t a_off, char* a_buff, size_t a_buffSize)
+{
+  int in = open(a_path, O_RDONLY);
+  if (in < 0)
+  {
+    fprintf(stderr, "ERROR: Cannot open %s: %s\n", a_path, strerror(errno));
+    return -1;
+  }
+  while (a_size > 0)
+  {
+    size_t  chunk = (a_size < a_buffSize) ? (size_t) a_size : a_buffSize;
+    ssize_t rc    = read(in, a_buff, chunk);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+    {
+      fprintf(stderr, "ERROR: Cannot read %s: %s\n", a_path,
+              (rc == 0) ? "File shrunk while packing" : strerror(errno));
+      close(in);
+      return -1;
+    }
+    if (pwrite(a_fd, a_buff, (size_t) rc, (off_t) a_off) != rc)
+    {
+      fprintf(stderr, "ERROR: Cannot write the archive: %s\n",
+              strerror(errno));
+      close(in);
+      return -1;
+    }
+    a_off  += (uint64_t) rc;
+    a_size -= (uint64_t) rc;
+  }
+  close(in);
+  return 0;
+}
+
+//===========================================================================//
+// "main":                                                                   //
+//===========================================================================//
+int main(int argc, char* argv[])
+{
+  if (argc != 3)
+  {
+    fputs("ARGUMENTS: ContentDir Archive\n", stderr);
+    return 1;
+  }
+  // The root, w/o trailing '/'s, so that the paths start with '/':
+  char* root = strdup(argv[1]);
+  s_rootLen  = strlen(root);
+  while (s_rootLen > 1 && root[s_rootLen - 1] == '/')
+    root[--s_rootLen] = '\0';
+
+  if (nftw(root, AddFile, 64, FTW_PHYS) != 0)
+  {
+    fprintf(stderr, "ERROR: Cannot scan %s: %s\n", root, strerror(errno));
+    return 1;
+  }
+  if (s_nFiles > INT32_MAX)
+  {
+    fputs("ERROR: Too many files\n", stderr);
+    return 1;
+  }
+
+  // The perfect hash, with as many buckets as files:
+  size_t    nBuckets = (s_nFiles > 0) ? s_nFiles : 1;
+  int32_t*  disp     = (int32_t*)  malloc(nBuckets * sizeof(int32_t));
+  uint32_t* slotOf   = (uint32_t*) malloc((s_nFiles + 1) * sizeof(uint32_t));
+  if (disp == NULL || slotOf == NULL)
+  {
+    fputs("ERROR: Out of memory\n", stderr);
+    return 1;
+  }
+  uint64_t seed = 0;
+  int      s    = 0;
+  for (; s < MaxSeeds; ++s)
+  {
+    seed = (uint64_t) s * 0x9E3779B97F4A7C15ULL + 1;
+    if (BuildHash(seed, nBuckets, disp, slotOf) == 0)
+      break;
+  }
+  if (s == MaxSeeds)
+  {
+    fputs("ERROR: Cannot build the perfect hash\n", stderr);
+    return 1;
+  }
+
+  // The index: header, displacements, entries, then the paths and headers:
+  size_t   pageSz     = (size_t) sysconf(_SC_PAGESIZE);
+  uint64_t dispOff    = sizeof(ContentPackHdr);
+  uint64_t entriesOff = (dispOff + nBuckets * sizeof(int32_t) + 7) / 8 * 8;
+  uint64_t strsOff    = entriesOff + s_nFiles * sizeof(ContentPackEntry);
+  uint64_t strsLen    = 0;
+  for (size_t i = 0; i < s_nFiles; ++i)
+    strsLen += s_files[i].m_pathLen + 2 * 128;
+  char* index = (char*) calloc(1, strsOff + strsLen);
+  if (index == NULL)
+  {
+    fputs("ERROR: Out of memory\n", stderr);
+    return 1;
+  }
+  memcpy(index + dispOff, disp, nBuckets * sizeof(int32_t));
+
+  ContentPackEntry* entries = (ContentPackEntry*) (index + entriesOff);
+  uint64_t          strsEnd = strsOff;
+  for (size_t i = 0; i < s_nFiles; ++i)
+  {
+    FileInfo const*   fi  = s_files + i;
+    ContentPackEntry* ent = entries + slotOf[i];
+    ent->m_pathOff        = strsEnd;
+    ent->m_pathLen        = (uint32_t) fi->m_pathLen;
+    memcpy(index + strsEnd, fi->m_path, fi->m_pathLen);
+    strsEnd              += fi->m_pathLen;
+
+    // As in "ProcessHTTPReqs", for "Connection: Close" and "Keep-Alive":
+    for (int keepAlive = 0; keepAlive < 2; ++keepAlive)
+    {
+      int len = snprintf(index + strsEnd, 128,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %llu\r\n"
+        "Connection: %s\r\n\r\n",
+        (unsigned long long) fi->m_size,
+        keepAlive ? "Keep-Alive" : "Close");
+      assert(len > 0 && len < 128);
+      ent->m_hdrOff[keepAlive] = strsEnd;
+      ent->m_hdrLen[keepAlive] = (uint16_t) len;
+      strsEnd                 += (uint64_t) len;
+    }
+  }
+
+  // The bodies, each one page-aligned:
+  uint64_t bodiesOff = (strsEnd + pageSz - 1) / pageSz * pageSz;
+  uint64_t size      = bodiesOff;
+  uint64_t nBytes    = 0;
+  for (size_t i = 0; i < s_nFiles; ++i)
+  {
+    ContentPackEntry* ent = entries + slotOf[i];
+    size                  = (size + pageSz - 1) / pageSz * pageSz;
+    ent->m_bodyOff        = size;
+    ent->m_bodySize       = s_files[i].m_size;
+    size                 += s_files[i].m_size;
+    nBytes               += s_files[i].m_size;
+  }
+
+  ContentPackHdr* hdr = (ContentPackHdr*) index;
+  memcpy(hdr->m_magic, ContentPackMagic, sizeof(hdr->m_magic));
+  hdr->m_size       = size;
+  hdr->m_seed       = seed;
+  hdr->m_nFiles     = s_nFiles;
+  hdr->m_nBuckets   = nBuckets;
+  hdr->m_dispOff    = dispOff;
+  hdr->m_entriesOff = entriesOff;
+  hdr->m_strsOff    = strsOff;
+  hdr->m_bodiesOff  = bodiesOff;
+
+  // Write it all out (the padding between the bodies is left as holes):
+  size_t tmpLen = strlen(argv[2]) + 5;
+  char*  tmp    = (char*) malloc(tmpLen);
+  (void) snprintf(tmp, tmpLen, "%s.tmp", argv[2]);
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    fprintf(stderr, "ERROR: Cannot create %s: %s\n", tmp, strerror(errno));
+    return 1;
+  }
+  if (pwrite(fd, index, strsEnd, 0) != (ssize_t) strsEnd)
+  {
+    fprintf(stderr, "ERROR: Cannot write %s: %s\n", tmp, strerror(errno));
+    goto Err;
+  }
+  size_t const BuffSize = 1 << 20;
+  char*        buff     = (char*) malloc(BuffSize);
+  size_t       pathSize = 0;
+  char*        path     = NULL;
+  for (size_t i = 0; i < s_nFiles; ++i)
+  {
+    FileInfo const* fi = s_files + i;
+    if (s_rootLen + fi->m_pathLen + 1 > pathSize)
+    {
+      pathSize = 2 * (s_rootLen + fi->m_pathLen + 1);
+      free(path);
+      path     = (char*) malloc(pathSize);
+    }
+    if (buff == NULL || path == NULL)
+    {
+      fputs("ERROR: Out of memory\n", stderr);
+      goto Err;
+    }
+    memcpy(path, root, s_rootLen);
+    memcpy(path + s_rootLen, fi->m_path, fi->m_pathLen + 1);
+    if (CopyFile(path, fi->m_size, fd, entries[slotOf[i]].m_bodyOff,
+                 buff, BuffSize) != 0)
+      goto Err;
+  }
+  if (ftruncate(fd, (off_t) size) != 0 || fsync(fd) != 0 || close(fd) != 0 ||
+      rename(tmp, argv[2]) != 0)
+  {
+    fprintf(stderr, "ERROR: Cannot write %s: %s\n", argv[2], strerror(errno));
+    (void) unlink(tmp);
+    return 1;
+  }
+  printf("%s: Files=%zu, Bodies=%llu B, Archive=%llu B, Seed=%d\n", argv[2],
+         s_nFiles, (unsigned long long) nBytes, (unsigned long long) size, s);
+  return 0;
+
+Err:
+  (void) close(fd);
+  (void) unlink(tmp);
+  return 1;
+}
@@ -0,0 +1,99 @@
+// vim:ts=2:et
+//============================================================================//
+//                               "PerfCounter.hpp":                           //
+//          Hardware / Software Event Counter of the curr Process (Linux)     //
+//============================================================================//
+// A "perf_event_open" counter of the calling Thread and of all Threads it
+// creates AFTER the counter (so it must be created before eg a ThreadPool,
+// to count its Workers too). It is created disabled, and counts user-space
+// events only, between "Enable" and "Disable". Hardware events are often not
+// available (eg in VMs, or with "kernel.perf_event_paranoid" > 2); then the
+// counter is not "Valid", and reads 0:
+//
+#pragma once
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "PerfCounter":                                                           //
+  //==========================================================================//
+  class PerfCounter
+  {
+  private:
+    int m_fd;
+
+  public:
+    //------------------------------------------------------------------------//
+    // Non-Default Ctor: "a_type", "a_config" as in "perf_event_attr":        //
+    //------------------------------------------------------------------------//
+    PerfCounter(uint32_t a_type, uint64_t a_config)
+    : m_fd(-1)
+    {
+      perf_event_attr attr;
+      memset(&attr, '\0', sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = a_type;
+      attr.config         = a_config;
+      attr.disabled       = 1;
+      attr.inherit        = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv     = 1;
+      m_fd = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                         PERF_FLAG_FD_CLOEXEC));
+    }
+
+    // Misses of the data TLB on loads:
+    static PerfCounter DTLBLoadMisses()
+    {
+      return PerfCounter(PERF_TYPE_HW_CACHE,
+                         PERF_COUNT_HW_CACHE_DTLB                  |
+                         (PERF_COUNT_HW_CACHE_OP_READ        <<  8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS    << 16));
+    }
+
+    PerfCounter(PerfCounter const&)            = delete;
+    PerfCounter& operator=(PerfCounter const&) = delete;
+
+    PerfCounter(PerfCounter&& a_other)
+    : m_fd(a_other.m_fd)
+      { a_other.m_fd = -1; }
+
+    ~PerfCounter()
+    {
+      if (m_fd >= 0)
+        (void) close(m_fd);
+    }
+
+    //------------------------------------------------------------------------//
+    // Control (including the counters inherited by the child Threads):      //
+    //------------------------------------------------------------------------//
+    bool Valid() const { return m_fd >= 0; }
+
+    void Enable() const
+    {
+      if (m_fd >= 0)
+        (void) ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    void Disable() const
+    {
+      if (m_fd >= 0)
+        (void) ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    // The total of all Threads (live or exited) while enabled:
+    uint64_t Read() const
+    {
+      uint64_t val = 0;
+      if (m_fd < 0 || read(m_fd, &val, sizeof(val)) != ssize_t(sizeof(val)))
+        return 0;
+      return val;
+    }
+  };
+} // End namespace SiriusFMTM
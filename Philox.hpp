@@ -0,0 +1,71 @@
+// vim:ts=2:et
+//============================================================================//
+//                                 "Philox.hpp":                              //
+//                   Philox4x32-10 Counter-Based Random Numbers               //
+//============================================================================//
+// Salmon et al, "Parallel Random Numbers: As Easy as 1, 2, 3" (SC'11). The
+// output is a pure function of (Key, Counter), so the i-th number of a stream
+// can be computed directly, by any Thread, in any order; there is no shared
+// state (unlike "drand48"):
+//
+#pragma once
+#include <array>
+#include <cstdint>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "Philox4x32":                                                            //
+  //==========================================================================//
+  class Philox4x32
+  {
+  public:
+    using Block = std::array<uint32_t, 4>;
+    using Key   = std::array<uint32_t, 2>;
+
+  private:
+    constexpr static uint32_t M0 = 0xD2511F53;
+    constexpr static uint32_t M1 = 0xCD9E8D57;
+    constexpr static uint32_t W0 = 0x9E3779B9;   // Golden ratio
+    constexpr static uint32_t W1 = 0xBB67AE85;   // sqrt(3) - 1
+
+    Key      m_key;
+    uint32_t m_stream;
+
+  public:
+    //------------------------------------------------------------------------//
+    // "Generate": The Bijection itself (10 Rounds):                          //
+    //------------------------------------------------------------------------//
+    static Block Generate(Block a_ctr, Key a_key)
+    {
+      for (int r = 0; r < 10; ++r)
+      {
+        if (r > 0)
+        {
+          a_key[0] += W0;
+          a_key[1] += W1;
+        }
+        uint64_t p0 = uint64_t(M0) * a_ctr[0];
+        uint64_t p1 = uint64_t(M1) * a_ctr[2];
+        a_ctr = Block{ uint32_t(p1 >> 32) ^ a_ctr[1] ^ a_key[0], uint32_t(p1),
+                       uint32_t(p0 >> 32) ^ a_ctr[3] ^ a_key[1], uint32_t(p0) };
+      }
+      return a_ctr;
+    }
+
+    //------------------------------------------------------------------------//
+    // Non-Default Ctor: A Stream of Blocks, for the given Seed and Id:       //
+    //------------------------------------------------------------------------//
+    Philox4x32(uint64_t a_seed, uint32_t a_stream)
+    : m_key   { uint32_t(a_seed), uint32_t(a_seed >> 32) },
+      m_stream(a_stream)
+    {}
+
+    // The "a_n"-th Block (4 x 32 random bits) of the stream:
+    Block operator()(uint64_t a_n) const
+    {
+      return Generate
+             (Block{ uint32_t(a_n), uint32_t(a_n >> 32), m_stream, 0 }, m_key);
+    }
+  };
+} // End namespace SiriusFMTM
@@ -4,78 +4,287 @@
 //        Processing HTTP Requests in an Established Client Connection       //
 //===========================================================================//
 #include "ProcessHTTPReqs.h"
+#include "BufferPool.h"
+#include "ContentPack.h"
+#include "ReqTrace.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
 
+// Sizes of the I/O Rings (rounded up to the page size). A response Ring is
+// sized by the actual response, up to the max:
+#define ReqRingSize       4096
+#define MaxRespRingSize  65536
+#define MaxRespHdrSize     256
+
+// Packed bodies of at least this size are sent with "sendfile" (after the
+// header); smaller ones are sent together with the header by 1 "sendmsg":
+#define MinSendFileSize  65536
+
+// The static content archive, if any (see "ProcessHTTPReqsSetup"):
+static ContentPack s_pack = { -1, NULL, 0, NULL, NULL, NULL };
+
+//===========================================================================//
+// "SendAll": Send all readable bytes from the Ring; 0 or (-1) on error:     //
+//===========================================================================//
+static int SendAll(ByteRing* a_out, int a_sd)
+{
+  while (ByteRingSize(a_out) > 0)
+  {
+    struct iovec rd = ByteRingReadSpan(a_out);
+    ssize_t      rc = send(a_sd, rd.iov_base, rd.iov_len, 0);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    // rc <  0: network error;
+    // rc == 0: client SWAMPED by our data;
+    if (rc <= 0)
+    {
+      fprintf(stderr, "ERROR: SD=%d: send returned %ld: %s, errno=%d\n",
+              a_sd, (long) rc, strerror(errno), errno);
+      return -1;
+    }
+    ByteRingConsume(a_out, (size_t) rc);
+  }
+  return 0;
+}
+
+//===========================================================================//
+// "SendStr": Send a short (eg error) response:                              //
+//===========================================================================//
+static int SendStr(int a_sd, char const* a_str)
+{
+  ByteRing out;
+  size_t   len = strlen(a_str);
+  if (BufferPoolGetRing(&out, len) != 0)
+    return -1;
+
+  struct iovec wr = ByteRingWriteSpan(&out);
+  assert(len <= wr.iov_len);
+  memcpy(wr.iov_base, a_str, len);
+  ByteRingCommit(&out, len);
+
+  int rc = SendAll(&out, a_sd);
+  BufferPoolPutRing(&out);
+  return rc;
+}
+
+//===========================================================================//
+// "ProcessHTTPReqsSetup":                                                   //
+//===========================================================================//
+int ProcessHTTPReqsSetup(int argc, char* argv[])
+{
+  if (ReqTraceSetup() != 0)
+    return -1;
+
+  // W/o the port, "ServerSetup" reports the error:
+  char const* packPath = (argc >= 2) ? strchr(argv[1], ':') : NULL;
+  if (packPath == NULL)
+    return 0;
+  ++packPath;
+
+  if (ContentPackOpen(&s_pack, packPath) != 0)
+  {
+    fprintf(stderr, "ERROR: Cannot open ContentPack %s: %s, errno=%d\n",
+            packPath, strerror(errno), errno);
+    return -1;
+  }
+  fprintf(stderr, "INFO: ContentPack %s: %llu files, %zu bytes\n", packPath,
+          (unsigned long long) s_pack.m_hdr->m_nFiles, s_pack.m_size);
+  return 0;
+}
+
+//===========================================================================//
+// "SendPacked": Send the File "a_path" from the ContentPack:                //
+//===========================================================================//
+// The precomputed header, and a small body, are sent directly from the
+// mapping, with no copying; a large body is sent by the kernel from the
+// archive file. Returns 0 (incl if the file is missing, as a 401 response is
+// sent then), or (-1) on error:
+//
+static int SendPacked(int a_sd, char const* a_path, size_t a_len,
+                      int a_keepAlive, ReqTraceRec* a_trace)
+{
+  ContentPackEntry const* ent = ContentPackFind(&s_pack, a_path, a_len);
+  ReqTraceMark(a_trace, ReqTraceAtOpened);
+  if (ent == NULL)
+  {
+    fprintf(stderr,  "INFO: Missing/Unaccessible file: %s\n", a_path);
+    // Send a 401 error to the client:
+    ReqTraceResp(a_trace, 401, 0);
+    return SendStr(a_sd, "HTTP/1.1 401 Missing File\r\n\r\n");
+  }
+  ReqTraceResp(a_trace, 200, ent->m_bodySize);
+  int          big    = (ent->m_bodySize >= MinSendFileSize);
+  struct iovec iov[2] =
+  {
+    { (void*) (s_pack.m_base + ent->m_hdrOff[a_keepAlive]),
+      ent->m_hdrLen[a_keepAlive] },
+    { (void*) (s_pack.m_base + ent->m_bodyOff),
+      big ? 0 : (size_t) ent->m_bodySize }
+  };
+  struct msghdr msg;
+  memset(&msg, '\0', sizeof(msg));
+  msg.msg_iov    = iov;
+  msg.msg_iovlen = 2;
+
+  // With a "sendfile" to follow, MSG_MORE lets the header go out together
+  // with the beginning of the body:
+  while (msg.msg_iovlen > 0)
+  {
+    ssize_t rc = sendmsg(a_sd, &msg, big ? MSG_MORE : 0);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+    {
+      fprintf(stderr, "ERROR: SD=%d: sendmsg returned %ld: %s, errno=%d\n",
+              a_sd, (long) rc, strerror(errno), errno);
+      return -1;
+    }
+    ReqTraceMark(a_trace, ReqTraceAtFirstByte);
+    // Skip what has been sent:
+    size_t sent = (size_t) rc;
+    while (msg.msg_iovlen > 0 && sent >= msg.msg_iov->iov_len)
+    {
+      sent -= msg.msg_iov->iov_len;
+      ++msg.msg_iov;
+      --msg.msg_iovlen;
+    }
+    if (msg.msg_iovlen > 0)
+    {
+      msg.msg_iov->iov_base  = (char*) msg.msg_iov->iov_base + sent;
+      msg.msg_iov->iov_len  -= sent;
+    }
+  }
+  if (!big)
+    return 0;
+
+  // "sendfile" with an explicit offset does not move the (shared) offset of
+  // the archive file, so it is safe in concurrent Threads and Processes:
+  off_t  off  = (off_t) ent->m_bodyOff;
+  size_t left = (size_t) ent->m_bodySize;
+  while (left > 0)
+  {
+    ssize_t rc = sendfile(a_sd, s_pack.m_fd, &off, left);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+    {
+      fprintf(stderr, "ERROR: SD=%d: sendfile returned %ld: %s, errno=%d\n",
+              a_sd, (long) rc, strerror(errno), errno);
+      return -1;
+    }
+    left -= (size_t) rc;
+  }
+  return 0;
+}
+
 //===========================================================================//
 // "ProcessHTTPReq":                                                         //
 //===========================================================================//
 int ProcessHTTPReqs(int a_sd)
 {
   assert(a_sd >= 0);
-  char reqBuff [1024];
-  char sendBuff[65536];
 
-  // For safety: 0-out both buffers:
-  memset(reqBuff,  '\0', sizeof(reqBuff));
-  memset(sendBuff, '\0', sizeof(sendBuff));
+  // I/O Rings from the pool: the req Ring is held for the whole connection
+  // (it may contain the beginning of the next req), a response Ring only for
+  // the duration of a response. Thanks to their mirrored mapping, data are
+  // received and sent in place, with no copying or compaction (and no need
+  // to 0-out anything):
+  ByteRing in  = { NULL, 0, 0, 0 };
+  ByteRing out = { NULL, 0, 0, 0 };
+
+  // Tracing of this connection, if it is sampled (see "ReqTrace.h"):
+  ReqTraceRec  traceRec;
+  ReqTraceRec* trace = ReqTracePickup(a_sd, &traceRec);
+
+  int      rc  = BufferPoolGetRing(&in, ReqRingSize);
+  if (rc != 0)
+  {
+    fprintf(stderr, "ERROR: SD=%d: Cannot create I/O Ring: %s, errno=%d\n",
+            a_sd, strerror(errno), errno);
+    close(a_sd);
+    return rc;
+  }
 
   // Receive multiple requests from the client:
   while (1)
   {
-    int rc = recv(a_sd, reqBuff, sizeof(reqBuff)-1, 0); // Space for '\0'
-    if (rc < 0)
-    {
-      if (errno == EINTR)
-        continue;
-      // Any other error: exit:
-      fprintf(stderr, "WARNING: SD=%d, recv failed: %s, errno=%d\n",
-              a_sd, strerror(errno), errno);
-      close(a_sd);
-      return rc;
-    }
-    else
-    if (rc == 0)
+    ReqTraceMark(trace, ReqTraceAtRecvStart);
+
+    // Receive until the "in" Ring contains a whole req (1st line + headers,
+    // terminated by "\r\n\r\n"). Any bytes beyond that belong to the next
+    // (pipelined) req, and stay in the Ring:
+    char* reqBuff  = NULL;
+    char* hdrsEnd  = NULL;
+    while (1)
     {
-      fprintf(stderr, "INFO: SD=%d: Client disconnected\n", a_sd);
-      close(a_sd);
-      return rc;
+      // 0-terminate the bytes received. There is always at least 1 free byte
+      // (see below), and it is contiguous with the readable ones:
+      struct iovec rd = ByteRingReadSpan(&in);
+      reqBuff         = (char*) rd.iov_base;
+      reqBuff[rd.iov_len] = '\0';
+
+      hdrsEnd = strstr(reqBuff, "\r\n\r\n");
+      if (hdrsEnd != NULL)
+        break;
+
+      // Keep 1 byte free for the terminating '\0':
+      struct iovec wr = ByteRingWriteSpan(&in);
+      if (wr.iov_len <= 1)
+      {
+        fprintf(stderr, "INFO: SD=%d, Req too long, disconnecting\n", a_sd);
+        rc = -1;
+        goto Close;
+      }
+      rc = recv(a_sd, wr.iov_base, wr.iov_len - 1, 0);
+      if (rc < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        // Any other error: exit:
+        fprintf(stderr, "WARNING: SD=%d, recv failed: %s, errno=%d\n",
+                a_sd, strerror(errno), errno);
+        goto Close;
+      }
+      else
+      if (rc == 0)
+      {
+        fprintf(stderr, "INFO: SD=%d: Client disconnected\n", a_sd);
+        goto Close;
+      }
+      ByteRingCommit(&in, (size_t) rc);
     }
-    // 0-terminate the bytes received:
-    reqBuff[rc] = '\0';
+    // The length of this req, incl the final "\r\n\r\n":
+    size_t reqLen = (size_t) (hdrsEnd + 4 - reqBuff);
+    ReqTraceMark(trace, ReqTraceAtRecvd);
+
+    // 0-terminate the req after the last header's "\r\n", so that the
+    // parsing below cannot run into the next req:
+    hdrsEnd[2] = '\0';
 
     // Disconnect this client at the end of servicing this req, UNLESS
     // explicitly asked to keep the connection alive:
     int keepAlive  = 0;
 
-    // If we got here: Received (rc) bytes, rc > 0:
-    // XXX: We assume that we have received the whole req (1st line + headers)
-    // at once, otherwise parsing would become REALLY complex:
-    // Full req must have "\r\n\r\n" at the end:
-    //
-    if (rc < 4 || strcmp(reqBuff + (rc - 4), "\r\n\r\n") != 0)
-    {
-      fprintf(stderr, "INFO: SD=%d, Incomplete Req, disconnecting", a_sd);
-      close(a_sd);
-      return rc;
-    }
     // OK, got a possibly complete req:
     // Parse the 1st line. The method must be GET, others not supported:
     if (strncmp(reqBuff, "GET ", 4) != 0)
     {
       fprintf(stderr,  "INFO: SD=%d: Unsupported Method: %s\n", a_sd, reqBuff);
       // Send the 501 error to the client:
-      strcpy(sendBuff, "HTTP/1.1 501 Unsupported request\r\n\r\n");
-      send  (a_sd, sendBuff, strlen(sendBuff), 0);
+      ReqTraceResp(trace, 501, 0);
+      if ((rc = SendStr(a_sd, "HTTP/1.1 501 Unsupported request\r\n\r\n")) != 0)
+        goto Close;
       goto NextReq;
     }
     // 0-terminate the 1st line:
@@ -93,13 +302,15 @@ int ProcessHTTPReqs(int a_sd)
     {
       fprintf(stderr,  "INFO: SD=%d: Missing Path: %s\n", a_sd, reqBuff);
       // Send the 501 error to the client:
-      strcpy(sendBuff, "HTTP/1.1 501 Missing Path\r\n\r\n");
-      send  (a_sd, sendBuff, strlen(sendBuff), 0);
+      ReqTraceResp(trace, 501, 0);
+      if ((rc = SendStr(a_sd, "HTTP/1.1 501 Missing Path\r\n\r\n")) != 0)
+        goto Close;
       goto NextReq;
     }
     // OK, got a valid and framed path:
     assert(path != NULL);
     *pathEnd = '\0';
+    ReqTracePath(trace, path);
 
     // Check the HTTP version (beyond pathEnd):
     char const* httpVer =  strstr (pathEnd + 1, "HTTP/");
@@ -107,9 +318,10 @@ int ProcessHTTPReqs(int a_sd)
     {
       fprintf(stderr,  "INFO: SD=%d: Invalid HTTPVer: %s\n", a_sd, reqBuff);
       // Send the 501 error to the client:
-      strcpy(sendBuff,
-        "HTTP/1.1 501 Unsupported/Invalid HTTP Version\r\n\r\n");
-      send  (a_sd, sendBuff, strlen(sendBuff), 0);
+      ReqTraceResp(trace, 501, 0);
+      if ((rc = SendStr(a_sd,
+             "HTTP/1.1 501 Unsupported/Invalid HTTP Version\r\n\r\n")) != 0)
+        goto Close;
       goto NextReq;
     }
     // Parse the Headers. We are only interested in the "Connection: " header:
@@ -122,7 +334,7 @@ int ProcessHTTPReqs(int a_sd)
       // Skip any further spaces:
       for (; *connHdrVal == ' '; ++connHdrVal) ;
 
-      if (strncasecmp(connHdrVal, "Keep-Alive", 11) == 0)
+      if (strncasecmp(connHdrVal, "Keep-Alive", 10) == 0)
         keepAlive = 1;
       else
       if (strncasecmp(connHdrVal, "Close", 5) != 0)
@@ -134,14 +346,26 @@ int ProcessHTTPReqs(int a_sd)
         "INFO: SD=%d: Missing/Invalid Connecton: Header\n", a_sd);
 
       // Send the 501 error to the client:
-      strcpy(sendBuff,
-        "HTTP/1.1 501 Missing/Invalid Connection Header\r\n\r\n");
-      send  (a_sd, sendBuff, strlen(sendBuff), 0);
+      ReqTraceResp(trace, 501, 0);
+      if ((rc = SendStr(a_sd,
+             "HTTP/1.1 501 Missing/Invalid Connection Header\r\n\r\n")) != 0)
+        goto Close;
       goto NextReq;
     }
     // Got Path and KeepAlive params!
     // FIXME: Security considerations are very weak here!
     assert(*path == '/');
+    ReqTraceMark(trace, ReqTraceAtParsed);
+
+    // Static content: just a look-up in the ContentPack (no file system
+    // access at all):
+    if (s_pack.m_hdr != NULL)
+    {
+      if ((rc = SendPacked(a_sd, path, (size_t) (pathEnd - path),
+                           keepAlive, trace)) != 0)
+        goto Close;
+      goto NextReq;
+    }
     // Prepend path with '.' to make it relative to the current working
     // directory of the server: XXX: Bad style, but wotks in this case:
     --path;
@@ -151,35 +375,70 @@ int ProcessHTTPReqs(int a_sd)
     int fd = open(path, O_RDONLY);
 
     struct stat statBuff;
-    rc   = fstat(fd, &statBuff);
-    // We can only service regular files:
-    int isRegFile = S_ISREG(statBuff.st_mode);
+    rc   = (fd < 0) ? -1 : fstat(fd, &statBuff);
+    ReqTraceMark(trace, ReqTraceAtOpened);
 
-    if (fd < 0 || rc < 0 || !isRegFile)
+    // We can only service regular files:
+    if (rc < 0 || !S_ISREG(statBuff.st_mode))
     {
       fprintf(stderr,  "INFO: Missing/Unaccessible file: %s\n", path);
+      if (fd >= 0)
+        close(fd);
       // Send a 401 error to the client:
-      strcpy(sendBuff, "HTTP/1.1 401 Missing File\r\n\r\n");
-      send  (a_sd, sendBuff, strlen(sendBuff), 0);
+      ReqTraceResp(trace, 401, 0);
+      if ((rc = SendStr(a_sd, "HTTP/1.1 401 Missing File\r\n\r\n")) != 0)
+        goto Close;
       goto NextReq;
     }
     // Get the file size:
     size_t fileSize = statBuff.st_size;
+    ReqTraceResp(trace, 200, fileSize);
 
-    // Response to the client:
-    sprintf(sendBuff,
+    // Response to the client. The header goes into the "out" Ring first, and
+    // the file contents right after it, so they are sent out together:
+    size_t respSize = MaxRespHdrSize + fileSize;
+    if ((rc = BufferPoolGetRing(&out, (respSize < MaxRespRingSize)
+                                      ? respSize : MaxRespRingSize)) != 0)
+    {
+      fprintf(stderr, "ERROR: SD=%d: Cannot create I/O Ring: %s, errno=%d\n",
+              a_sd, strerror(errno), errno);
+      close(fd);
+      goto Close;
+    }
+    struct iovec wr     = ByteRingWriteSpan(&out);
+    int          hdrLen = snprintf((char*) wr.iov_base, wr.iov_len,
       "HTTP/1.1 200 OK\r\n"
       "Content-Type: text/plain\r\n"
-      "Content-Length: %ld\r\n"
+      "Content-Length: %zu\r\n"
       "Connection: %s\r\n\r\n",
       fileSize,
       keepAlive ? "Keep-Alive" : "Close");
+    assert(hdrLen > 0 && (size_t) hdrLen < wr.iov_len);
+    ByteRingCommit(&out, (size_t) hdrLen);
 
-    // Read the file in chunks and send it to the client:
-    while (1)
+    // Read the file directly into the free space of the Ring, and send
+    // directly from its readable span, until all of the file is sent:
+    int eof = 0;
+    while (!eof || ByteRingSize(&out) > 0)
     {
-      int chunkSize = read(fd,  sendBuff, sizeof(sendBuff));
-      rc = send(a_sd, sendBuff, chunkSize, 0);
+      wr = ByteRingWriteSpan(&out);
+      if (!eof && wr.iov_len > 0)
+      {
+        ssize_t chunkSize = read(fd, wr.iov_base, wr.iov_len);
+        if (chunkSize < 0 && errno == EINTR)
+          continue;
+        // End of file (or file reading error):
+        if (chunkSize <= 0)
+          eof = 1;
+        else
+          ByteRingCommit(&out, (size_t) chunkSize);
+      }
+      struct iovec rd = ByteRingReadSpan(&out);
+      if (rd.iov_len == 0)
+        continue;
+      rc = send(a_sd, rd.iov_base, rd.iov_len, 0);
+      if (rc < 0 && errno == EINTR)
+        continue;
 
       // rc <  0: network error;
       // rc == 0: client SWAMPED by our data;
@@ -189,25 +448,33 @@ int ProcessHTTPReqs(int a_sd)
         fprintf(stderr, "ERROR: SD=%d: send returned %d: %s, errno=%d\n",
                 a_sd, rc, strerror(errno), errno);
         close(fd);
-        close(a_sd);
-        return rc;
-      }
-      // Exit normally if got to the end of file (or file reading error):
-      if (chunkSize < sizeof(sendBuff))
-      {
-        close(fd);
-        break;
+        goto Close;
       }
+      ReqTraceMark(trace, ReqTraceAtFirstByte);
+      ByteRingConsume(&out, (size_t) rc);
     }
+    close(fd);
+    BufferPoolPutRing(&out);
+
     // Done with this Req:
   NextReq:
+    ReqTraceEnd(trace);
+    ByteRingConsume(&in, reqLen);
     if (!keepAlive)
     {
-      close(a_sd);
       fprintf(stderr, "INFO: SD=%d closed: Keep-Alive=0\n", a_sd);
-      return 0;
+      rc = 0;
+      goto Close;
     }
   }
-  // This point is unreachable!
-  __builtin_unreachable();
+  // Close the connection and release the Rings. A req in progress (ie
+  // unless it is a Keep-Alive connection closed by the client between reqs)
+  // is traced as failed:
+Close:
+  if (rc != 0 || ByteRingSize(&in) > 0)
+    ReqTraceAbort(trace);
+  close(a_sd);
+  BufferPoolPutRing(&in);
+  BufferPoolPutRing(&out);
+  return rc;
 }
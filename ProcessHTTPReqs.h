@@ -13,3 +13,18 @@ extern "C" int ProcessHTTPReqs(int a_sd);
 #else
 extern     int ProcessHTTPReqs(int a_sd);
 #endif
+
+//---------------------------------------------------------------------------//
+// "ProcessHTTPReqsSetup": Optional Static Content, from the Command Line:   //
+//---------------------------------------------------------------------------//
+// If argv[1] is "ServerPort:ContentPack", the archive made by "PackContent"
+// is opened, and all files are then served from it, instead of from the
+// current dir. Also sets up the req tracing, if enabled (see "ReqTrace.h").
+// Must be called before "ServerSetup" (which may "chroot").
+// Returns 0 on success (incl no archive given), (-1) on error:
+//
+#ifdef __cplusplus
+extern "C" int ProcessHTTPReqsSetup(int argc, char* argv[]);
+#else
+extern     int ProcessHTTPReqsSetup(int argc, char* argv[]);
+#endif
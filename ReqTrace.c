@@ -0,0 +1,494 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                  "ReqTrace.c":                            //
+//        Sampled Per-Request Latency Tracing, in Chrome Trace Format        //
+//===========================================================================//
+#include "ReqTrace.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+// Max size of the JSON events of 1 record (with the path fully escaped):
+#define MaxRecJSON  2048
+// Max time between the flushes of all buffers (by the Flusher Thread):
+#define FlushSec    1
+
+//===========================================================================//
+// State:                                                                    //
+//===========================================================================//
+// A Thread buffer. Its mutex is held by the owner Thread while adding a
+// record (so it is normally uncontended), and by any Thread flushing it:
+typedef struct TraceBuff
+{
+  pthread_mutex_t   m_mutex;
+  struct TraceBuff* m_next;   // In the list of all buffers
+  int               m_pid;    // Of the owner Thread
+  int               m_tid;
+  int               m_n;
+  ReqTraceRec       m_recs[];
+} TraceBuff;
+
+static int            s_fd        = -1;   // The trace file, if enabled
+static unsigned long  s_sample    = 1;
+static int            s_buffCap   = 256;
+static unsigned long  s_nConns    = 0;
+
+// The accept time of each connection (by its socket descr), if sampled. It
+// is written by the Acceptor before the connection is handed over to a
+// Worker, and read by that Worker (after the hand-over, ie the ThreadPool
+// queue, "pthread_create" or "fork", which orders the accesses):
+static uint64_t*      s_accepted  = NULL;
+static size_t         s_nAccepted = 0;
+
+static __thread TraceBuff* t_buff = NULL;
+
+// All buffers (lock order: this mutex, then that of a buffer):
+static TraceBuff*      s_buffs      = NULL;
+static pthread_mutex_t s_buffsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_key_t  s_key;
+static pthread_once_t s_keyOnce = PTHREAD_ONCE_INIT;
+
+// The Flusher Thread. There is 1 per Process which has traced any reqs (a
+// forked Process does not inherit it, so it starts its own), and the
+// handlers of the termination signals hand the final flush over to it:
+static pid_t                 s_flusherPid = 0;    // Under "s_buffsMutex"
+static sem_t                 s_flusherSem;
+static volatile sig_atomic_t s_termSig    = 0;
+
+//===========================================================================//
+// Writing Out:                                                              //
+//===========================================================================//
+//---------------------------------------------------------------------------//
+// "WriteAll": To the trace file (O_APPEND, so each write is atomic):        //
+//---------------------------------------------------------------------------//
+static void WriteAll(char const* a_data, size_t a_len)
+{
+  while (a_len > 0)
+  {
+    ssize_t rc = write(s_fd, a_data, a_len);
+    if (rc < 0 && errno == EINTR)
+      continue;
+    if (rc <= 0)
+    {
+      fprintf(stderr, "WARNING: Cannot write the trace: %s, errno=%d\n",
+              strerror(errno), errno);
+      return;
+    }
+    a_data += rc;
+    a_len  -= (size_t) rc;
+  }
+}
+
+//---------------------------------------------------------------------------//
+// "Span": A complete ("X") event, if both points have been reached:         //
+//---------------------------------------------------------------------------//
+static int Span(char* a_out, size_t a_cap, char const* a_name, int a_pid,
+                int a_tid, uint64_t a_from, uint64_t a_to, char const* a_args)
+{
+  if (a_from == 0 || a_to < a_from)
+    return 0;
+  return snprintf(a_out, a_cap,
+    "{\"name\":\"%s\",\"cat\":\"http\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,"
+    "\"ts\":%.3f,\"dur\":%.3f%s},\n",
+    a_name, a_pid, a_tid, (double) a_from / 1000.0,
+    (double) (a_to - a_from) / 1000.0, a_args);
+}
+
+//---------------------------------------------------------------------------//
+// "RecJSON": The events of a record; returns their length:                  //
+//---------------------------------------------------------------------------//
+static size_t RecJSON(char* a_out, ReqTraceRec const* a_rec, int a_pid,
+                      int a_tid)
+{
+  uint64_t const* ts = a_rec->m_ts;
+
+  // The path comes from the client, so it is escaped:
+  char  path[6 * sizeof(a_rec->m_path)];
+  char* p = path;
+  for (char const* c = a_rec->m_path; *c != '\0'; ++c)
+    if (*c == '"' || *c == '\\')
+    {
+      *p++ = '\\';
+      *p++ = *c;
+    }
+    else
+    if ((unsigned char) *c < 0x20)
+      p   += sprintf(p, "\\u%04x", (unsigned) *c);
+    else
+      *p++ = *c;
+  *p = '\0';
+
+  char args[sizeof(path) + 128];
+  (void) snprintf(args, sizeof(args),
+    ",\"args\":{\"sd\":%d,\"path\":\"%s\",\"status\":%d,\"bytes\":%llu}",
+    a_rec->m_sd, path, a_rec->m_status, (unsigned long long) a_rec->m_bytes);
+
+  // "send" starts when the response is ready, ie at the last point reached
+  // before it (it is at the "recv" end for errors detected while parsing):
+  uint64_t ready = ts[ReqTraceAtOpened] ? ts[ReqTraceAtOpened] :
+                   ts[ReqTraceAtParsed] ? ts[ReqTraceAtParsed] :
+                                          ts[ReqTraceAtRecvd];
+  uint64_t last  = ts[ReqTraceAtLastByte];
+  size_t   n     = 0;
+  size_t   cap   = MaxRecJSON;
+  n += (size_t) Span(a_out + n, cap - n, "queue",   a_pid, a_tid,
+                     ts[ReqTraceAtAccept],    ts[ReqTraceAtPickup], "");
+  n += (size_t) Span(a_out + n, cap - n, "recv",    a_pid, a_tid,
+                     ts[ReqTraceAtRecvStart], ts[ReqTraceAtRecvd],  "");
+  n += (size_t) Span(a_out + n, cap - n, "request", a_pid, a_tid,
+                     ts[ReqTraceAtRecvd] ? ts[ReqTraceAtRecvd]
+                                         : ts[ReqTraceAtRecvStart],
+                     last,                                          args);
+  n += (size_t) Span(a_out + n, cap - n, "parse",   a_pid, a_tid,
+                     ts[ReqTraceAtRecvd],     ts[ReqTraceAtParsed], "");
+  n += (size_t) Span(a_out + n, cap - n, "open",    a_pid, a_tid,
+                     ts[ReqTraceAtParsed],    ts[ReqTraceAtOpened], "");
+  n += (size_t) Span(a_out + n, cap - n, "send",    a_pid, a_tid,
+                     ready,                   last,                 "");
+  if (ts[ReqTraceAtFirstByte] != 0)
+    n += (size_t) snprintf(a_out + n, cap - n,
+      "{\"name\":\"first_byte\",\"cat\":\"http\",\"ph\":\"i\",\"s\":\"t\","
+      "\"pid\":%d,\"tid\":%d,\"ts\":%.3f},\n",
+      a_pid, a_tid, (double) ts[ReqTraceAtFirstByte] / 1000.0);
+  assert(n < cap);
+  return n;
+}
+
+//---------------------------------------------------------------------------//
+// "FlushBuff": Write out and empty a (locked) buffer:                       //
+//---------------------------------------------------------------------------//
+// The events are written in chunks of whole records:
+//
+static void FlushBuff(TraceBuff* a_buff)
+{
+  char   chunk[16 * MaxRecJSON];
+  size_t n = 0;
+  for (int i = 0; i < a_buff->m_n; ++i)
+  {
+    if (n + MaxRecJSON > sizeof(chunk))
+    {
+      WriteAll(chunk, n);
+      n = 0;
+    }
+    n += RecJSON(chunk + n, a_buff->m_recs + i, a_buff->m_pid,
+                 a_buff->m_tid);
+  }
+  if (n > 0)
+    WriteAll(chunk, n);
+  a_buff->m_n = 0;
+}
+
+//---------------------------------------------------------------------------//
+// "ThreadExit": Flush and free the exiting Thread's buffer:                 //
+//---------------------------------------------------------------------------//
+static void ThreadExit(void* a_buff)
+{
+  TraceBuff* buff = (TraceBuff*) a_buff;
+  (void) pthread_mutex_lock(&s_buffsMutex);
+  TraceBuff** prev = &s_buffs;
+  while (*prev != buff)
+    prev = &(*prev)->m_next;
+  *prev = buff->m_next;
+  (void) pthread_mutex_unlock(&s_buffsMutex);
+
+  (void) pthread_mutex_lock(&buff->m_mutex);
+  FlushBuff(buff);
+  (void) pthread_mutex_unlock(&buff->m_mutex);
+  (void) pthread_mutex_destroy(&buff->m_mutex);
+  free(buff);
+  t_buff = NULL;
+}
+
+static void MakeKey(void)
+  { (void) pthread_key_create(&s_key, ThreadExit); }
+
+//===========================================================================//
+// Flushing in the Background and on Termination:                            //
+//===========================================================================//
+//---------------------------------------------------------------------------//
+// "ReRaise": Terminate by the signal, with its default action:              //
+//---------------------------------------------------------------------------//
+static void ReRaise(int a_sig)
+{
+  struct sigaction sa;
+  memset(&sa, '\0', sizeof(sa));
+  sa.sa_handler = SIG_DFL;
+  (void) sigaction(a_sig, &sa, NULL);
+  (void) raise(a_sig);
+}
+
+//---------------------------------------------------------------------------//
+// "TermHandler": For SIGTERM and SIGINT:                                    //
+//---------------------------------------------------------------------------//
+// Flushing is not async-signal-safe, so it is done by the Flusher Thread,
+// which then re-raises the signal. W/o a Flusher in this Process, there is
+// nothing to flush:
+//
+static void TermHandler(int a_sig)
+{
+  if (__atomic_load_n(&s_flusherPid, __ATOMIC_ACQUIRE) == getpid())
+  {
+    s_termSig = a_sig;
+    (void) sem_post(&s_flusherSem);
+  }
+  else
+    ReRaise(a_sig);
+}
+
+//---------------------------------------------------------------------------//
+// "FlusherBody": Flush all buffers every "FlushSec", and on termination:    //
+//---------------------------------------------------------------------------//
+static void* FlusherBody(void* a_arg)
+{
+  (void) a_arg;
+  while (1)
+  {
+    struct timespec dl;
+    (void) clock_gettime(CLOCK_REALTIME, &dl);
+    dl.tv_sec += FlushSec;
+    (void) sem_timedwait(&s_flusherSem, &dl);
+
+    ReqTraceFlush();
+    if (s_termSig != 0)
+      ReRaise(s_termSig);
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------//
+// "StartFlusher": In the curr Process (with "s_buffsMutex" locked):         //
+//---------------------------------------------------------------------------//
+static void StartFlusher(void)
+{
+  pid_t pid = getpid();
+  if (s_flusherPid == pid)
+    return;
+  // Also after a "fork": the parent's semaphore state is meaningless here:
+  (void) sem_init(&s_flusherSem, 0, 0);
+
+  pthread_attr_t attr;
+  pthread_t      th;
+  (void) pthread_attr_init(&attr);
+  (void) pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  int rc = pthread_create(&th, &attr, FlusherBody, NULL);
+  (void) pthread_attr_destroy(&attr);
+  if (rc != 0)
+  {
+    fprintf(stderr, "WARNING: Cannot start the trace flusher: %s\n",
+            strerror(rc));
+    return;
+  }
+  __atomic_store_n(&s_flusherPid, pid, __ATOMIC_RELEASE);
+}
+
+//---------------------------------------------------------------------------//
+// "CatchTerm": Install "TermHandler", unless the signal is ignored or has   //
+// a handler already:                                                        //
+//---------------------------------------------------------------------------//
+static void CatchTerm(int a_sig)
+{
+  struct sigaction sa;
+  if (sigaction(a_sig, NULL, &sa) != 0 || sa.sa_handler != SIG_DFL)
+    return;
+  memset(&sa, '\0', sizeof(sa));
+  sa.sa_handler = TermHandler;
+  sa.sa_flags   = SA_RESTART;
+  (void) sigemptyset(&sa.sa_mask);
+  (void) sigaction(a_sig, &sa, NULL);
+}
+
+//===========================================================================//
+// "ReqTraceSetup":                                                          //
+//===========================================================================//
+int ReqTraceSetup(void)
+{
+  char const* env = getenv("HTTP_TRACE");
+  if (env == NULL || *env == '\0')
+    return 0;
+
+  // Parse a copy, as "strtok_r" modifies it:
+  char spec[1024];
+  if (strlen(env) >= sizeof(spec))
+  {
+    fputs("ERROR: HTTP_TRACE too long\n", stderr);
+    return -1;
+  }
+  strcpy(spec, env);
+
+  char const* file = NULL;
+  char*       save = NULL;
+  for (char* opt = strtok_r(spec, ",", &save); opt != NULL;
+       opt = strtok_r(NULL, ",", &save))
+  {
+    char* val = strchr(opt, '=');
+    if (val != NULL)
+      *val++ = '\0';
+    if (val != NULL && strcmp(opt, "file") == 0 && *val != '\0')
+    {
+      file = val;
+      continue;
+    }
+    char* end = NULL;
+    long  n   = (val == NULL) ? 0 : strtol(val, &end, 10);
+    if (n >= 1 && n <= INT_MAX && *end == '\0' && strcmp(opt, "sample") == 0)
+      s_sample  = (unsigned long) n;
+    else
+    if (n >= 1 && n <= INT_MAX && *end == '\0' && strcmp(opt, "buffer") == 0)
+      s_buffCap = (int) n;
+    else
+    {
+      fprintf(stderr, "ERROR: HTTP_TRACE: Invalid Option: %s\n", opt);
+      return -1;
+    }
+  }
+  if (file == NULL)
+  {
+    fputs("ERROR: HTTP_TRACE: Missing file=Path\n", stderr);
+    return -1;
+  }
+
+  // The accept times, for all possible socket descrs:
+  struct rlimit rl;
+  s_nAccepted = 65536;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY)
+    s_nAccepted = (size_t) rl.rlim_cur;
+  if (s_nAccepted > (1 << 20))
+    s_nAccepted = (1 << 20);
+  s_accepted = (uint64_t*) calloc(s_nAccepted, sizeof(uint64_t));
+  if (s_accepted == NULL)
+  {
+    fputs("ERROR: HTTP_TRACE: Out of memory\n", stderr);
+    return -1;
+  }
+
+  s_fd = open(file, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+              0644);
+  if (s_fd < 0)
+  {
+    fprintf(stderr, "ERROR: Cannot create the trace %s: %s, errno=%d\n",
+            file, strerror(errno), errno);
+    return -1;
+  }
+  WriteAll("[\n", 2);
+
+  // The main Thread does not run the key destructors, and the other Threads
+  // may still be running, so flush all buffers on exit (eg of the
+  // per-connection Processes), and on the usual termination signals:
+  (void) atexit(ReqTraceFlush);
+  CatchTerm(SIGTERM);
+  CatchTerm(SIGINT);
+  fprintf(stderr, "INFO: Tracing 1 in %lu connections to %s\n", s_sample,
+          file);
+  return 0;
+}
+
+//===========================================================================//
+// "ReqTraceAccepted":                                                       //
+//===========================================================================//
+void ReqTraceAccepted(int a_sd)
+{
+  if (s_fd < 0 || a_sd < 0 || (size_t) a_sd >= s_nAccepted)
+    return;
+  unsigned long n =
+    __atomic_fetch_add(&s_nConns, 1, __ATOMIC_RELAXED);
+  s_accepted[a_sd] = (n % s_sample == 0) ? ReqTraceNow() : 0;
+}
+
+//===========================================================================//
+// "ReqTracePickup":                                                         //
+//===========================================================================//
+ReqTraceRec* ReqTracePickup(int a_sd, ReqTraceRec* a_rec)
+{
+  assert(a_rec != NULL);
+  if (s_fd < 0 || a_sd < 0 || (size_t) a_sd >= s_nAccepted ||
+      s_accepted[a_sd] == 0)
+    return NULL;
+
+  memset(a_rec, '\0', sizeof(ReqTraceRec));
+  a_rec->m_sd                   = a_sd;
+  a_rec->m_ts[ReqTraceAtAccept] = s_accepted[a_sd];
+  a_rec->m_ts[ReqTraceAtPickup] = ReqTraceNow();
+  s_accepted[a_sd]              = 0;
+  return a_rec;
+}
+
+//===========================================================================//
+// "ReqTraceEnd":                                                            //
+//===========================================================================//
+void ReqTraceEnd(ReqTraceRec* a_rec)
+{
+  if (a_rec == NULL)
+    return;
+  ReqTraceMark(a_rec, ReqTraceAtLastByte);
+
+  // The buffer of this Thread, created (and registered) on its 1st req:
+  TraceBuff* buff = t_buff;
+  if (buff == NULL)
+  {
+    buff = (TraceBuff*)
+      malloc(sizeof(TraceBuff) + (size_t) s_buffCap * sizeof(ReqTraceRec));
+    if (buff == NULL)
+      return;
+    (void) pthread_mutex_init(&buff->m_mutex, NULL);
+    buff->m_pid = (int) getpid();
+    buff->m_tid = (int) syscall(SYS_gettid);
+    buff->m_n   = 0;
+    (void) pthread_once(&s_keyOnce, MakeKey);
+    (void) pthread_setspecific(s_key, buff);
+
+    (void) pthread_mutex_lock(&s_buffsMutex);
+    buff->m_next = s_buffs;
+    s_buffs      = buff;
+    StartFlusher();
+    (void) pthread_mutex_unlock(&s_buffsMutex);
+    t_buff       = buff;
+  }
+  (void) pthread_mutex_lock(&buff->m_mutex);
+  buff->m_recs[buff->m_n++] = *a_rec;
+  if (buff->m_n == s_buffCap)
+    FlushBuff(buff);
+  (void) pthread_mutex_unlock(&buff->m_mutex);
+
+  // Ready for the next req on this connection:
+  int sd = a_rec->m_sd;
+  memset(a_rec, '\0', sizeof(ReqTraceRec));
+  a_rec->m_sd = sd;
+}
+
+//===========================================================================//
+// "ReqTraceAbort":                                                          //
+//===========================================================================//
+void ReqTraceAbort(ReqTraceRec* a_rec)
+{
+  // A reset record (after "ReqTraceEnd") has no req in progress:
+  if (a_rec == NULL || a_rec->m_ts[ReqTraceAtRecvStart] == 0)
+    return;
+  a_rec->m_status = ReqTraceStatusError;
+  ReqTraceEnd(a_rec);
+}
+
+//===========================================================================//
+// "ReqTraceFlush":                                                          //
+//===========================================================================//
+void ReqTraceFlush(void)
+{
+  (void) pthread_mutex_lock(&s_buffsMutex);
+  for (TraceBuff* buff = s_buffs; buff != NULL; buff = buff->m_next)
+  {
+    (void) pthread_mutex_lock(&buff->m_mutex);
+    FlushBuff(buff);
+    (void) pthread_mutex_unlock(&buff->m_mutex);
+  }
+  (void) pthread_mutex_unlock(&s_buffsMutex);
+}
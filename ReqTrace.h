@@ -0,0 +1,152 @@
+// vim:ts=2:et
+//===========================================================================//
+//                                  "ReqTrace.h":                            //
+//        Sampled Per-Request Latency Tracing, in Chrome Trace Format        //
+//===========================================================================//
+// Enabled by the env var "HTTP_TRACE" (a comma-separated list of
+// "Name=Value"):
+//   file=Path   the trace (JSON, for "chrome://tracing" or Perfetto);
+//   sample=N    trace 1 in N connections (default: 1, ie all);
+//   buffer=N    records per Thread buffer (default: 256).
+// The acceptor samples the connections ("ReqTraceAccepted"); all reqs of a
+// sampled connection are then traced by the Thread (or Process) which
+// services it, at the points below. The records go into a buffer of that
+// Thread (with an uncontended lock, and no I/O), which is appended to the
+// file when it is full, and when the Thread exits. All buffers are flushed
+// every second (by a Thread which each Process starts on its 1st traced
+// req), at exit, and on SIGTERM and SIGINT (unless the server ignores or
+// handles them itself). The file is a JSON array which is never closed (as
+// allowed by the format), so that several Processes may append to it, and
+// it stays valid if a server is killed.
+// The spans of a req (in usec, on the servicing Thread's track):
+//   queue       accept -> pickup (1st req of a connection only): the Submit
+//               to the ThreadPool and the wait in its queue (or the Thread /
+//               Process creation);
+//   recv        waiting for the req (incl the idle time of Keep-Alive);
+//   request     the whole req (args: path, status, bytes), from the end of
+//               "recv" (or its start, if the req was never fully received).
+//               Status "ReqTraceStatusError" means that the connection was
+//               closed (on an error, or by the client) before the response
+//               was complete;
+//   parse, open (of the file, or the ContentPack look-up), send (up to the
+//               last byte sent), and the instant "first_byte":
+//
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//---------------------------------------------------------------------------//
+// Points of the Req Lifecycle:                                              //
+//---------------------------------------------------------------------------//
+typedef enum ReqTracePointE
+{
+  ReqTraceAtAccept,     // Connection accepted (1st req only)
+  ReqTraceAtPickup,     // Connection picked up by a Worker (1st req only)
+  ReqTraceAtRecvStart,  // Start of receiving the req
+  ReqTraceAtRecvd,      // Whole req (headers) received
+  ReqTraceAtParsed,     // Path and headers parsed (not reached on errors)
+  ReqTraceAtOpened,     // File opened (or found in the ContentPack)
+  ReqTraceAtFirstByte,  // 1st byte of the response sent
+  ReqTraceAtLastByte,   // Last byte of the response sent
+  ReqTraceNPoints
+} ReqTracePointE;
+
+//---------------------------------------------------------------------------//
+// "ReqTraceRec": A Traced Req:                                              //
+//---------------------------------------------------------------------------//
+typedef struct ReqTraceRec
+{
+  uint64_t  m_ts[ReqTraceNPoints];  // CLOCK_MONOTONIC nsec; 0: not reached
+  uint64_t  m_bytes;                // Of the body
+  int       m_sd;
+  int       m_status;
+  char      m_path[64];             // Truncated
+} ReqTraceRec;
+
+#define ReqTraceStatusError (-1)
+
+//---------------------------------------------------------------------------//
+// "ReqTraceSetup": From the Env Var "HTTP_TRACE":                           //
+//---------------------------------------------------------------------------//
+// Creates the file (so it must be called before "chroot"). Returns 0 on
+// success (incl if tracing is not enabled), (-1) on error:
+//
+extern int ReqTraceSetup(void);
+
+//---------------------------------------------------------------------------//
+// "ReqTraceAccepted": Called by the Acceptor for each new Connection:       //
+//---------------------------------------------------------------------------//
+extern void ReqTraceAccepted(int a_sd);
+
+//---------------------------------------------------------------------------//
+// "ReqTracePickup": Called by the Worker, when it starts the Connection:    //
+//---------------------------------------------------------------------------//
+// Returns "a_rec" (initialised) if the connection is traced, NULL otherwise.
+// All functions below do nothing for a NULL "a_rec":
+//
+extern ReqTraceRec* ReqTracePickup(int a_sd, ReqTraceRec* a_rec);
+
+//---------------------------------------------------------------------------//
+// "ReqTraceEnd": The Req is done (its last byte sent):                      //
+//---------------------------------------------------------------------------//
+// The record is buffered, and reset for the next req on the connection:
+//
+extern void ReqTraceEnd(ReqTraceRec* a_rec);
+
+//---------------------------------------------------------------------------//
+// "ReqTraceAbort": The Connection is closed before the Req is done:         //
+//---------------------------------------------------------------------------//
+// The req in progress (if any) is buffered with "ReqTraceStatusError":
+//
+extern void ReqTraceAbort(ReqTraceRec* a_rec);
+
+//---------------------------------------------------------------------------//
+// "ReqTraceFlush": Write out the buffers of all Threads:                    //
+//---------------------------------------------------------------------------//
+extern void ReqTraceFlush(void);
+
+//---------------------------------------------------------------------------//
+// Recording (inline, as they are called on every req):                      //
+//---------------------------------------------------------------------------//
+static inline uint64_t ReqTraceNow(void)
+{
+  struct timespec ts;
+  (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+// Only the 1st time the point is reached counts (eg for "FirstByte"):
+static inline void ReqTraceMark(ReqTraceRec* a_rec, ReqTracePointE a_point)
+{
+  if (a_rec != NULL && a_rec->m_ts[a_point] == 0)
+    a_rec->m_ts[a_point] = ReqTraceNow();
+}
+
+static inline void ReqTraceResp(ReqTraceRec* a_rec, int a_status,
+                                uint64_t a_bytes)
+{
+  if (a_rec != NULL)
+  {
+    a_rec->m_status = a_status;
+    a_rec->m_bytes  = a_bytes;
+  }
+}
+
+static inline void ReqTracePath(ReqTraceRec* a_rec, char const* a_path)
+{
+  if (a_rec != NULL)
+  {
+    strncpy(a_rec->m_path, a_path, sizeof(a_rec->m_path) - 1);
+    a_rec->m_path[sizeof(a_rec->m_path) - 1] = '\0';
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
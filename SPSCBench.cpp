@@ -0,0 +1,226 @@
+// vim:ts=2:et
+//===========================================================================//
+//                               "SPSCBench.cpp":                            //
+//     Micro-Benchmark: Lock-Free SPSC Ring vs Mutex-Guarded CircularBuffer  //
+//===========================================================================//
+#include "CircularBuffer.hpp"
+#include "SPSCCircularBuffer.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  using namespace SiriusFMTM;
+
+  size_t const BuffSz = 4096;
+
+  //=========================================================================//
+  // Benchmark Params and Results:                                           //
+  //=========================================================================//
+  // The Producer pushes the values 1..m_nOps, the Consumer checks that they
+  // arrive in order and sums them up:
+  //
+  template<typename Buff>
+  struct Bench
+  {
+    Buff&     m_buff;
+    uint64_t  m_nOps;
+    size_t    m_batch;      // 1: Single-entry ops
+    uint64_t  m_sum;        // Computed by the Consumer
+    bool      m_ordered;
+  };
+
+  //=========================================================================//
+  // Lock-Free SPSC Ring:                                                    //
+  //=========================================================================//
+  using SPSC = SPSCCircularBuffer<uint64_t>;
+
+  void* SPSCProducer(void* a_arg)
+  {
+    Bench<SPSC>*          b = static_cast<Bench<SPSC>*>(a_arg);
+    std::vector<uint64_t> batch(b->m_batch);
+
+    for (uint64_t i = 1; i <= b->m_nOps; )
+    {
+      if (b->m_batch == 1)
+      {
+        if (b->m_buff.TryPush(i))
+          ++i;
+        else
+          sched_yield();
+        continue;
+      }
+      size_t n = 0;
+      for (; n < b->m_batch && i + n <= b->m_nOps; ++n)
+        batch[n] = i + n;
+      // Retry the rest of the batch until all of it is pushed:
+      for (size_t done = 0; done < n; )
+      {
+        size_t k = b->m_buff.try_push_n(batch.data() + done, n - done);
+        if (k == 0)
+          sched_yield();
+        done += k;
+      }
+      i += n;
+    }
+    return nullptr;
+  }
+
+  void* SPSCConsumer(void* a_arg)
+  {
+    Bench<SPSC>*          b = static_cast<Bench<SPSC>*>(a_arg);
+    std::vector<uint64_t> batch(b->m_batch);
+    uint64_t              expected = 1;
+
+    while (expected <= b->m_nOps)
+    {
+      size_t n = (b->m_batch == 1)
+                 ? size_t(b->m_buff.TryPop(batch[0]))
+                 : b->m_buff.try_pop_n(batch.data(), b->m_batch);
+      if (n == 0)
+      {
+        sched_yield();
+        continue;
+      }
+      for (size_t j = 0; j < n; ++j, ++expected)
+      {
+        b->m_ordered &= (batch[j] == expected);
+        b->m_sum     += batch[j];
+      }
+    }
+    return nullptr;
+  }
+
+  //=========================================================================//
+  // Mutex-Guarded CircularBuffer (the baseline):                            //
+  //=========================================================================//
+  struct Locked
+  {
+    CircularBuffer<uint64_t> m_cb;
+    pthread_mutex_t          m_mutex;
+
+    Locked(): m_cb(BuffSz), m_mutex(PTHREAD_MUTEX_INITIALIZER) {}
+  };
+
+  void* LockedProducer(void* a_arg)
+  {
+    Bench<Locked>* b = static_cast<Bench<Locked>*>(a_arg);
+    for (uint64_t i = 1; i <= b->m_nOps; )
+    {
+      (void) pthread_mutex_lock  (&b->m_buff.m_mutex);
+      for (size_t j = 0; j < b->m_batch && i <= b->m_nOps &&
+                         !b->m_buff.m_cb.IsFull(); ++j, ++i)
+        b->m_buff.m_cb.PushBack(i);
+      bool full = b->m_buff.m_cb.IsFull();
+      (void) pthread_mutex_unlock(&b->m_buff.m_mutex);
+      if (full)
+        sched_yield();
+    }
+    return nullptr;
+  }
+
+  void* LockedConsumer(void* a_arg)
+  {
+    Bench<Locked>* b        = static_cast<Bench<Locked>*>(a_arg);
+    uint64_t       expected = 1;
+    while (expected <= b->m_nOps)
+    {
+      (void) pthread_mutex_lock  (&b->m_buff.m_mutex);
+      size_t n = 0;
+      for (; n < b->m_batch && !b->m_buff.m_cb.IsEmpty(); ++n, ++expected)
+      {
+        uint64_t v    = b->m_buff.m_cb.PopFront();
+        b->m_ordered &= (v == expected);
+        b->m_sum     += v;
+      }
+      (void) pthread_mutex_unlock(&b->m_buff.m_mutex);
+      if (n == 0)
+        sched_yield();
+    }
+    return nullptr;
+  }
+
+  //=========================================================================//
+  // "Run": Returns the throughput (ops/sec):                                //
+  //=========================================================================//
+  template<typename Buff>
+  double Run(char const* a_name, Buff& a_buff,
+             void* (*a_prod)(void*), void* (*a_cons)(void*),
+             uint64_t a_nOps, size_t a_batch)
+  {
+    Bench<Buff> b{a_buff, a_nOps, a_batch, 0, true};
+    timespec    t0, t1;
+    pthread_t   prod, cons;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if (pthread_create(&cons, nullptr, a_cons, &b) != 0 ||
+        pthread_create(&prod, nullptr, a_prod, &b) != 0)
+    {
+      std::cerr << "ERROR: Cannot create Threads" << std::endl;
+      exit(1);
+    }
+    (void) pthread_join(prod, nullptr);
+    (void) pthread_join(cons, nullptr);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double   sec = double(t1.tv_sec  - t0.tv_sec) +
+                   double(t1.tv_nsec - t0.tv_nsec) * 1e-9;
+    double   ops = double(a_nOps) / sec;
+    bool     ok  = b.m_ordered && b.m_sum == a_nOps * (a_nOps + 1) / 2;
+
+    std::cout << a_name << ": Batch=" << a_batch << ", Time=" << sec
+              << " sec, " << (ops * 1e-6) << " Mops/sec"
+              << (ok ? "" : "  *** WRONG RESULT ***") << std::endl;
+    if (!ok)
+      exit(1);
+    return ops;
+  }
+}
+
+//===========================================================================//
+// "main":                                                                   //
+//===========================================================================//
+int main(int argc, char* argv[])
+{
+  // Params: NOps [BatchSize]
+  if (argc < 2)
+  {
+    std::cerr << "Params: NOps [BatchSize]" << std::endl;
+    return 1;
+  }
+  long   nOps  = atol(argv[1]);
+  long   batch = (argc >= 3) ? atol(argv[2]) : 64;
+  if (nOps <= 0 || batch <= 0 || size_t(batch) > BuffSz)
+  {
+    std::cerr << "Invalid NOps or BatchSize" << std::endl;
+    return 1;
+  }
+
+  // Each run gets a fresh buffer:
+  {
+    Locked lk;
+    Run("Mutex+CircularBuffer", lk, LockedProducer, LockedConsumer,
+        uint64_t(nOps), 1);
+  }
+  {
+    Locked lk;
+    Run("Mutex+CircularBuffer", lk, LockedProducer, LockedConsumer,
+        uint64_t(nOps), size_t(batch));
+  }
+  {
+    SPSC spsc(BuffSz);
+    Run("SPSCCircularBuffer  ", spsc, SPSCProducer, SPSCConsumer,
+        uint64_t(nOps), 1);
+  }
+  {
+    SPSC spsc(BuffSz);
+    Run("SPSCCircularBuffer  ", spsc, SPSCProducer, SPSCConsumer,
+        uint64_t(nOps), size_t(batch));
+  }
+  return 0;
+}
@@ -0,0 +1,197 @@
+// vim:ts=2:et
+//============================================================================//
+//                           "SPSCCircularBuffer.hpp":                        //
+//      Lock-Free Single-Producer / Single-Consumer Circular (Ring) Buffer    //
+//============================================================================//
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "SPSCCircularBuffer":                                                    //
+  //==========================================================================//
+  // Exactly ONE Producer Thread may call the "TryPush*" methods, and exactly
+  // ONE Consumer Thread the "TryPop*" ones; no locks are needed then:
+  // (*) "m_back" is only written by the Producer, "m_front" by the Consumer;
+  //     each of them is published with "release" and read with "acquire";
+  // (*) Producer-side and Consumer-side flds live in separate cache lines, so
+  //     the two Threads do not falsely share them;
+  // (*) Each side keeps a cached copy of the other side's idx, and only re-
+  //     reads the shared one when the cached value says Full (or Empty);
+  // (*) "TryPushN" and "TryPopN" publish a whole batch with one store.
+  // Capacity is rounded up to a power of 2, for indexing by masking:
+  //
+  template<typename T>
+  class SPSCCircularBuffer
+  {
+  private:
+    constexpr static size_t CacheLineSz = 64;
+
+    //==========================================================================//
+    // Data Flds:                                                               //
+    //==========================================================================//
+    // Read-only after construction:
+    size_t const  m_mask;     // Capacity minus 1
+    T*     const  m_buff;     // Raw storage, NOT constructed
+
+    // Producer side:
+    alignas(CacheLineSz) std::atomic<size_t> m_back;   // Running idx
+                         size_t              m_cachedFront;
+    // Consumer side:
+    alignas(CacheLineSz) std::atomic<size_t> m_front;  // Running idx
+                         size_t              m_cachedBack;
+    // Keep whatever follows this obj out of the Consumer's cache line:
+    char m_pad[CacheLineSz - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    static size_t StorageSize(size_t a_N)
+    {
+      size_t sz = 1;
+      while (sz < a_N)
+        sz <<= 1;
+      return sz;
+    }
+
+    T* Slot(size_t a_i) const { return m_buff + (a_i & m_mask); }
+
+  public:
+    //--------------------------------------------------------------------------//
+    // Non-Default Ctor, Dtor:                                                  //
+    //--------------------------------------------------------------------------//
+    SPSCCircularBuffer(size_t a_N)
+    : m_mask       (StorageSize(a_N) - 1),
+      m_buff       (static_cast<T*>
+                     (::operator new(sizeof(T) * (m_mask + 1),
+                                     std::align_val_t(alignof(T))))),
+      m_back       (0),
+      m_cachedFront(0),
+      m_front      (0),
+      m_cachedBack (0),
+      m_pad        ()
+    {
+      assert(a_N > 1);
+    }
+
+    SPSCCircularBuffer()                          = delete;
+    SPSCCircularBuffer(SPSCCircularBuffer const&) = delete;
+
+    // No concurrent access is possible any more:
+    ~SPSCCircularBuffer()
+    {
+      size_t back = m_back.load(std::memory_order_relaxed);
+      for (size_t i = m_front.load(std::memory_order_relaxed); i != back; ++i)
+        Slot(i)->~T();
+      ::operator delete(m_buff, std::align_val_t(alignof(T)));
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    //--------------------------------------------------------------------------//
+    // Producer: "TryEmplace", "TryPush": Returns "false" if Full:              //
+    //--------------------------------------------------------------------------//
+    template<typename... Args>
+    bool TryEmplace(Args&&... a_args)
+    {
+      size_t back = m_back.load(std::memory_order_relaxed);
+      if (back - m_cachedFront > m_mask)
+      {
+        // Looks Full, re-read the Consumer's idx:
+        m_cachedFront = m_front.load(std::memory_order_acquire);
+        if (back - m_cachedFront > m_mask)
+          return false;
+      }
+      new (Slot(back)) T(std::forward<Args>(a_args)...);
+      m_back.store(back + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool TryPush(T const& a_t) { return TryEmplace(a_t);            }
+    bool TryPush(T&&      a_t) { return TryEmplace(std::move(a_t)); }
+
+    //--------------------------------------------------------------------------//
+    // Producer: "TryPushN": Push up to "a_n" entries from "a_from":            //
+    //--------------------------------------------------------------------------//
+    // Returns the number of entries actually pushed (copied or, with a
+    // "std::move_iterator", moved). All of them are published at once:
+    //
+    template<typename InputIt>
+    size_t TryPushN(InputIt a_from, size_t a_n)
+    {
+      size_t back  = m_back.load(std::memory_order_relaxed);
+      size_t space = m_mask + 1 - (back - m_cachedFront);
+      if (space < a_n)
+      {
+        m_cachedFront = m_front.load(std::memory_order_acquire);
+        space         = m_mask + 1 - (back - m_cachedFront);
+      }
+      size_t n = (a_n < space) ? a_n : space;
+      for (size_t i = 0; i < n; ++i, ++a_from)
+        new (Slot(back + i)) T(*a_from);
+      if (n != 0)
+        m_back.store(back + n, std::memory_order_release);
+      return n;
+    }
+
+    //--------------------------------------------------------------------------//
+    // Consumer: "TryPop": Move the front entry out, "false" if Empty:          //
+    //--------------------------------------------------------------------------//
+    bool TryPop(T& a_res)
+    {
+      size_t front = m_front.load(std::memory_order_relaxed);
+      if (front == m_cachedBack)
+      {
+        // Looks Empty, re-read the Producer's idx:
+        m_cachedBack = m_back.load(std::memory_order_acquire);
+        if (front == m_cachedBack)
+          return false;
+      }
+      T* slot = Slot(front);
+      a_res   = std::move(*slot);
+      slot->~T();
+      m_front.store(front + 1, std::memory_order_release);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------//
+    // Consumer: "TryPopN": Move up to "a_n" entries out to "a_to":             //
+    //--------------------------------------------------------------------------//
+    // Returns the number of entries actually popped. All the slots are given
+    // back to the Producer at once:
+    //
+    template<typename OutputIt>
+    size_t TryPopN(OutputIt a_to, size_t a_n)
+    {
+      size_t front = m_front.load(std::memory_order_relaxed);
+      size_t avail = m_cachedBack - front;
+      if (avail < a_n)
+      {
+        m_cachedBack = m_back.load(std::memory_order_acquire);
+        avail        = m_cachedBack - front;
+      }
+      size_t n = (a_n < avail) ? a_n : avail;
+      for (size_t i = 0; i < n; ++i, ++a_to)
+      {
+        T* slot = Slot(front + i);
+        *a_to   = std::move(*slot);
+        slot->~T();
+      }
+      if (n != 0)
+        m_front.store(front + n, std::memory_order_release);
+      return n;
+    }
+
+    // For compatibility with the naming in the rest of the Buffers' API:
+    template<typename InputIt>
+    size_t try_push_n(InputIt  a_from, size_t a_n)
+      { return TryPushN(a_from, a_n); }
+
+    template<typename OutputIt>
+    size_t try_pop_n (OutputIt a_to,   size_t a_n)
+      { return TryPopN (a_to,   a_n); }
+  };
+} // End namespace SiriusFMTM
@@ -1,8 +1,9 @@
 // vim:ts=2:et
 //===========================================================================//
 //                                "ServerSetup.c":                           //
-//                          Common Setup for TCP Servers                     //
+//                     Common Setup for TCP Servers and Clients              //
 //===========================================================================//
+#define _GNU_SOURCE   // For "accept4"
 #include "ServerSetup.h"
 #include <stdio.h>
 #include <string.h>
@@ -14,55 +15,295 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <poll.h>
+#include <limits.h>
 #include <assert.h>
 
+// The max number of connections per "ServerAccept", as configured by the
+// last "ListenerSetupOpts":
+static int s_acceptBatch = 16;
+
 //===========================================================================//
-// "ServerSetup":                                                            //
+// "ServerOptsParse":                                                        //
 //===========================================================================//
-// Returns the Acceptor Socket, or (-1) on error:
-//
-int ServerSetup(int argc, char* argv[])
+int ServerOptsParse(char const* a_spec, ServerOpts* a_opts)
 {
-  if (argc != 2)
+  assert(a_opts != NULL);
+  memset(a_opts, '\0', sizeof(ServerOpts));
+  a_opts->m_backlog     = 1024;
+  a_opts->m_noDelay     = 1;
+  a_opts->m_acceptBatch = 16;
+  if (a_spec == NULL)
+    return 0;
+
+  // Parse a copy, as "strtok_r" modifies it:
+  char  spec[1024];
+  if (strlen(a_spec) >= sizeof(spec))
   {
-    fputs("ARGUMENT: ServerPort\n", stderr);
+    fputs("ERROR: ServerOpts too long\n", stderr);
     return -1;
   }
-  int port = atoi(argv[1]);
+  strcpy(spec, a_spec);
+
+  char* save = NULL;
+  for (char* opt = strtok_r(spec, ",", &save); opt != NULL;
+       opt = strtok_r(NULL, ",", &save))
+  {
+    char* val = strchr(opt, '=');
+    if (val == NULL)
+    {
+      fprintf(stderr, "ERROR: ServerOpts: Missing Value: %s\n", opt);
+      return -1;
+    }
+    *val++ = '\0';
+
+    if (strcmp(opt, "unix") == 0)
+    {
+      if (*val == '\0' || strlen(val) >= sizeof(a_opts->m_unixPath))
+      {
+        fprintf(stderr, "ERROR: ServerOpts: Invalid unix Path: %s\n", val);
+        return -1;
+      }
+      strcpy(a_opts->m_unixPath, val);
+      continue;
+    }
+    // All other options are non-negative ints:
+    char* end = NULL;
+    long  n   = strtol(val, &end, 10);
+    int*  dst =
+      (strcmp(opt, "backlog")  == 0) ? &a_opts->m_backlog     :
+      (strcmp(opt, "ipv6")     == 0) ? &a_opts->m_ipv6        :
+      (strcmp(opt, "nodelay")  == 0) ? &a_opts->m_noDelay     :
+      (strcmp(opt, "defer")    == 0) ? &a_opts->m_deferAccept :
+      (strcmp(opt, "fastopen") == 0) ? &a_opts->m_fastOpen    :
+      (strcmp(opt, "sndbuf")   == 0) ? &a_opts->m_sndBuf      :
+      (strcmp(opt, "rcvbuf")   == 0) ? &a_opts->m_rcvBuf      :
+      (strcmp(opt, "batch")    == 0) ? &a_opts->m_acceptBatch : NULL;
+    if (dst == NULL || end == val || *end != '\0' || n < 0 || n > INT_MAX)
+    {
+      fprintf(stderr, "ERROR: ServerOpts: Invalid Option: %s=%s\n", opt,
+              val);
+      return -1;
+    }
+    *dst = (int) n;
+  }
+  if (a_opts->m_acceptBatch < 1 ||
+      a_opts->m_acceptBatch > ServerMaxAcceptBatch)
+  {
+    fprintf(stderr, "ERROR: ServerOpts: batch must be 1..%d\n",
+            ServerMaxAcceptBatch);
+    return -1;
+  }
+  return 0;
+}
+
+//===========================================================================//
+// "SetOpt": "setsockopt" of an int, with a warning on failure:              //
+//===========================================================================//
+// The options are optimisations, so the server is still usable w/o them (eg
+// TCP_FASTOPEN may be disabled by "net.ipv4.tcp_fastopen"):
+//
+static void SetOpt(int a_sd, int a_level, int a_name, char const* a_str,
+                   int a_val)
+{
+  if (setsockopt(a_sd, a_level, a_name, &a_val, sizeof(a_val)) < 0)
+    fprintf(stderr, "WARNING: SD=%d: Cannot set %s=%d: %s, errno=%d\n",
+            a_sd, a_str, a_val, strerror(errno), errno);
+}
 
-  // Create the acceptor socket (NOT for data interchange!)
-  int sd = socket(AF_INET, SOCK_STREAM, 0);  // Default protocol: TCP
+//===========================================================================//
+// "ListenerSetupOpts":                                                      //
+//===========================================================================//
+// Returns the (non-blocking) Acceptor Socket bound to "port" on all
+// interfaces, or to the AF_UNIX path, or (-1) on error:
+//
+int ListenerSetupOpts(int port, ServerOpts const* a_opts)
+{
+  assert(a_opts != NULL);
+  int isUnix = (a_opts->m_unixPath[0] != '\0');
+  int family = isUnix ? AF_UNIX : a_opts->m_ipv6 ? AF_INET6 : AF_INET;
+
+  // Create the acceptor socket (NOT for data interchange!). It is
+  // non-blocking, so that "ServerAccept" can take all pending connections:
+  int sd = socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   if (sd < 0)
   {
     fprintf(stderr, "ERROR: Cannot create acceptor socket: %s\n",
             strerror(errno));
-    close(sd);
     return -1;
   }
 
-  // Bind the socket to the given port:
-  struct sockaddr_in sa;
-  sa.sin_family      = AF_INET;
-  sa.sin_addr.s_addr = INADDR_ANY;
-  sa.sin_port        = htons((uint16_t)port);
+  // Bind the socket to the given port (or path):
+  struct sockaddr_storage ss;
+  socklen_t               len = 0;
+  memset(&ss, 0, sizeof(ss));
+  if (isUnix)
+  {
+    struct sockaddr_un* sa = (struct sockaddr_un*) &ss;
+    sa->sun_family         = AF_UNIX;
+    strcpy(sa->sun_path, a_opts->m_unixPath);
+    len                    = sizeof(*sa);
+
+    // Remove a stale socket left by a previous run (but nothing else):
+    struct stat st;
+    if (lstat(a_opts->m_unixPath, &st) == 0 && S_ISSOCK(st.st_mode))
+      (void) unlink(a_opts->m_unixPath);
+  }
+  else
+  {
+    // Allow re-binding while the connections of a previous run are still in
+    // TIME_WAIT:
+    SetOpt(sd, SOL_SOCKET, SO_REUSEADDR, "SO_REUSEADDR", 1);
+
+    if (family == AF_INET6)
+    {
+      struct sockaddr_in6* sa = (struct sockaddr_in6*) &ss;
+      sa->sin6_family         = AF_INET6;
+      sa->sin6_addr           = in6addr_any;
+      sa->sin6_port           = htons((uint16_t)port);
+      len                     = sizeof(*sa);
+      SetOpt(sd, IPPROTO_IPV6, IPV6_V6ONLY, "IPV6_V6ONLY", 0);
+    }
+    else
+    {
+      struct sockaddr_in* sa = (struct sockaddr_in*) &ss;
+      sa->sin_family         = AF_INET;
+      sa->sin_addr.s_addr    = INADDR_ANY;
+      sa->sin_port           = htons((uint16_t)port);
+      len                    = sizeof(*sa);
+    }
+    SetOpt(sd, IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY",
+           a_opts->m_noDelay != 0);
+    // Do not wake up "accept" until the req has arrived:
+    if (a_opts->m_deferAccept > 0)
+      SetOpt(sd, IPPROTO_TCP, TCP_DEFER_ACCEPT, "TCP_DEFER_ACCEPT",
+             a_opts->m_deferAccept);
+  }
+  if (a_opts->m_sndBuf > 0)
+    SetOpt(sd, SOL_SOCKET, SO_SNDBUF, "SO_SNDBUF", a_opts->m_sndBuf);
+  if (a_opts->m_rcvBuf > 0)
+    SetOpt(sd, SOL_SOCKET, SO_RCVBUF, "SO_RCVBUF", a_opts->m_rcvBuf);
 
-  int rc = bind(sd, (struct sockaddr const*)(&sa), sizeof(sa));
+  int rc = bind(sd, (struct sockaddr const*)(&ss), len);
   if (rc < 0)
   {
-    fprintf(stderr, "ERROR: Cannot bind SD=%d to Port=%d: %s, errno=%d\n",
-            sd, port, strerror(errno), errno);
+    if (isUnix)
+      fprintf(stderr, "ERROR: Cannot bind SD=%d to Path=%s: %s, errno=%d\n",
+              sd, a_opts->m_unixPath, strerror(errno), errno);
+    else
+      fprintf(stderr, "ERROR: Cannot bind SD=%d to Port=%d: %s, errno=%d\n",
+              sd, port, strerror(errno), errno);
+    close(sd);
+    return -1;
+  }
+  // With TCP Fast Open, the req may come in the SYN (after the 1st
+  // connection of a client), saving a round trip:
+  if (!isUnix && a_opts->m_fastOpen > 0)
+    SetOpt(sd, IPPROTO_TCP, TCP_FASTOPEN, "TCP_FASTOPEN", a_opts->m_fastOpen);
+
+  // Create the listen queue:
+  if (listen(sd, a_opts->m_backlog) < 0)
+  {
+    fprintf(stderr, "ERROR: Cannot listen on SD=%d: %s, errno=%d\n",
+            sd, strerror(errno), errno);
+    close(sd);
+    return -1;
+  }
+  s_acceptBatch = a_opts->m_acceptBatch;
+  return sd;
+}
+
+//===========================================================================//
+// "ListenerSetup":                                                          //
+//===========================================================================//
+int ListenerSetup(int port)
+{
+  ServerOpts opts;
+  (void) ServerOptsParse(NULL, &opts);
+  return ListenerSetupOpts(port, &opts);
+}
+
+//===========================================================================//
+// "ServerAccept":                                                           //
+//===========================================================================//
+int ServerAccept(int a_lsd, int* a_sds, int a_max)
+{
+  assert(a_lsd >= 0 && a_sds != NULL && a_max >= 1);
+  if (a_max > s_acceptBatch)
+    a_max = s_acceptBatch;
+
+  int n = 0;
+  while (n < a_max)
+  {
+    int sd = accept4(a_lsd, NULL, NULL, SOCK_CLOEXEC);
+    if (sd >= 0)
+    {
+      a_sds[n++] = sd;
+      continue;
+    }
+    // The client has gone already: not an error:
+    if (errno == ECONNABORTED)
+      continue;
+    // Return what we have got (a real error will happen again next time):
+    if (n > 0)
+      break;
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+      return -1;
+
+    // Nothing pending: wait for a connection (or a signal):
+    struct pollfd pfd = { a_lsd, POLLIN, 0 };
+    if (poll(&pfd, 1, -1) < 0)
+      return -1;
+  }
+  return n;
+}
+
+//===========================================================================//
+// "ServerSetup":                                                            //
+//===========================================================================//
+// Returns the Acceptor Socket, or (-1) on error:
+//
+int ServerSetup(int argc, char* argv[])
+{
+  // Any further args (and ":ContentPack" after the port, for the HTTP
+  // servers) are server-specific:
+  if (argc < 2)
+  {
+    fputs("ARGUMENTS: ServerPort[:ContentPack] [...]\n"
+          "ENV:       SERVER_OPTS=backlog=N,ipv6=0|1,unix=Path,nodelay=0|1,"
+          "defer=Secs,\n"
+          "           fastopen=N,sndbuf=Bytes,rcvbuf=Bytes,batch=N\n", stderr);
     return -1;
   }
-  // Create listen queue for 1024 clients:
-  (void) listen(sd, 1024);
+  ServerOpts opts;
+  if (ServerOptsParse(getenv("SERVER_OPTS"), &opts) != 0)
+    return -1;
+
+  int port = atoi(argv[1]);
+  int sd   = ListenerSetupOpts(port, &opts);
+  if (sd < 0)
+    return -1;
+
+  if (opts.m_unixPath[0] != '\0')
+    fprintf(stderr, "INFO: Listening on Path=%s, Backlog=%d, Batch=%d\n",
+            opts.m_unixPath, opts.m_backlog, opts.m_acceptBatch);
+  else
+    fprintf(stderr, "INFO: Listening on Port=%d (%s), Backlog=%d, Batch=%d, "
+            "NoDelay=%d, DeferAccept=%d, FastOpen=%d, SndBuf=%d, "
+            "RcvBuf=%d\n", port, opts.m_ipv6 ? "IPv6+IPv4" : "IPv4",
+            opts.m_backlog, opts.m_acceptBatch, opts.m_noDelay,
+            opts.m_deferAccept, opts.m_fastOpen, opts.m_sndBuf,
+            opts.m_rcvBuf);
 
   // ALso, for safety, chroot to the current dir:
   if (geteuid() == 0)
   {
-    rc = chroot(".");
+    int rc = chroot(".");
     fprintf(stderr, "INFO: chroot: rc=%d, errno=%d\n", rc, errno);
     if (rc < 0)
       return -1;
@@ -71,3 +312,53 @@ int ServerSetup(int argc, char* argv[])
   assert(sd >= 0);
   return sd;
 }
+
+//===========================================================================//
+// "ClientConnect":                                                          //
+//===========================================================================//
+// Resolves "hostName" (getaddrinfo is thread-safe, unlike gethostbyname) and
+// tries its IPv4 addresses in turn. Returns the connected socket, or (-1) on
+// error:
+//
+int ClientConnect(char const* hostName, int port)
+{
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  char portStr[16];
+  (void) snprintf(portStr, sizeof(portStr), "%d", port);
+
+  struct addrinfo* ais = NULL;
+  int rc = getaddrinfo(hostName, portStr, &hints, &ais);
+  if (rc != 0)
+  {
+    fprintf(stderr, "ERROR: Cannot resolve HostName: %s: %s\n", hostName,
+            gai_strerror(rc));
+    return -1;
+  }
+  int sd = -1;
+  for (struct addrinfo const* ai = ais; ai != NULL; ai = ai->ai_next)
+  {
+    sd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (sd < 0)
+    {
+      fprintf(stderr, "ERROR: Cannot create socket: %s\n", strerror(errno));
+      continue;
+    }
+    if (connect(sd, ai->ai_addr, ai->ai_addrlen) == 0)
+    {
+      // Successfully connected. Small messages are sent at once:
+      SetOpt(sd, IPPROTO_TCP, TCP_NODELAY, "TCP_NODELAY", 1);
+      break;
+    }
+
+    fprintf(stderr, "ERROR: Cannot connect to %s:%d: %s, errno=%d\n",
+            hostName, port, strerror(errno), errno);
+    close(sd);
+    sd = -1;
+  }
+  freeaddrinfo(ais);
+  return sd;
+}
@@ -1,15 +1,102 @@
 // vim:ts=2:et
 //===========================================================================//
 //                                "ServerSetup.h":                           //
-//                          Common Setup for TCP Servers                     //
+//                     Common Setup for TCP Servers and Clients              //
 //===========================================================================//
 #pragma once
 
+#include <sys/un.h>
+
+//---------------------------------------------------------------------------//
+// "ServerOpts": Configuration of the Acceptor Socket:                       //
+//---------------------------------------------------------------------------//
+// The socket options are set on the acceptor socket, and are inherited by
+// the accepted ones. The TCP options do not apply to AF_UNIX sockets:
+//
+typedef struct ServerOpts
+{
+  int   m_backlog;      // Length of the "listen" queue
+  int   m_ipv6;         // Dual-stack IPv6 (IPv4 clients are accepted too)
+  char  m_unixPath[sizeof(((struct sockaddr_un*) 0)->sun_path)];
+                        // If not empty: AF_UNIX socket, the port is unused
+  int   m_noDelay;      // TCP_NODELAY: no Nagle delays of small responses
+  int   m_deferAccept;  // TCP_DEFER_ACCEPT: secs to wait for the req (0: off)
+  int   m_fastOpen;     // TCP_FASTOPEN: queue length (0: off)
+  int   m_sndBuf;       // SO_SNDBUF, bytes (0: system default)
+  int   m_rcvBuf;       // SO_RCVBUF, bytes (0: system default)
+  int   m_acceptBatch;  // Max connections returned by 1 "ServerAccept"
+} ServerOpts;
+
+// Max of "m_acceptBatch", ie the size of the "ServerAccept" array needed:
+#define ServerMaxAcceptBatch 64
+
+//---------------------------------------------------------------------------//
+// "ServerOptsParse": Options from a Spec String:                            //
+//---------------------------------------------------------------------------//
+// The spec is a comma-separated list of "Name=Value" (NULL or "": defaults):
+//   backlog=1024  ipv6=0   unix=Path  nodelay=1  defer=0  fastopen=0
+//   sndbuf=0      rcvbuf=0 batch=16
+// Returns 0 on success, (-1) on an invalid spec:
+//
+#ifdef __cplusplus
+extern "C" int ServerOptsParse(char const* a_spec, ServerOpts* a_opts);
+#else
+extern     int ServerOptsParse(char const* a_spec, ServerOpts* a_opts);
+#endif
+
 //---------------------------------------------------------------------------//
 // "ServerSetup": Returns the Acceptor Socket, or (-1) on error:             //
 //---------------------------------------------------------------------------//
+// The options are taken from the env var "SERVER_OPTS" (see above), so that
+// all servers can be tuned w/o changing their command lines:
+//
 #ifdef __cplusplus
 extern "C" int ServerSetup(int argc, char* argv[]);
 #else
 extern     int ServerSetup(int argc, char* argv[]);
 #endif
+
+//---------------------------------------------------------------------------//
+// "ListenerSetup": Acceptor Socket on the given Port, or (-1) on error:     //
+//---------------------------------------------------------------------------//
+// As "ServerSetup", but w/o the command-line parsing and "chroot", and with
+// the default options. The socket is non-blocking: use "ServerAccept":
+//
+#ifdef __cplusplus
+extern "C" int ListenerSetup(int port);
+#else
+extern     int ListenerSetup(int port);
+#endif
+
+//---------------------------------------------------------------------------//
+// "ListenerSetupOpts": As "ListenerSetup", with the given Options:          //
+//---------------------------------------------------------------------------//
+#ifdef __cplusplus
+extern "C" int ListenerSetupOpts(int port, ServerOpts const* a_opts);
+#else
+extern     int ListenerSetupOpts(int port, ServerOpts const* a_opts);
+#endif
+
+//---------------------------------------------------------------------------//
+// "ServerAccept": Accept 1 or more Connections:                             //
+//---------------------------------------------------------------------------//
+// Waits for a connection on the acceptor socket "a_lsd", then also accepts
+// all those already pending, up to "a_max" (and "m_acceptBatch"), so that a
+// burst of connections costs 1 wake-up. The accepted sockets are blocking,
+// and close-on-exec. Returns their number, or (-1) on error (incl EINTR, if
+// interrupted by a signal while waiting):
+//
+#ifdef __cplusplus
+extern "C" int ServerAccept(int a_lsd, int* a_sds, int a_max);
+#else
+extern     int ServerAccept(int a_lsd, int* a_sds, int a_max);
+#endif
+
+//---------------------------------------------------------------------------//
+// "ClientConnect": Socket connected to HostName:Port, or (-1) on error:     //
+//---------------------------------------------------------------------------//
+#ifdef __cplusplus
+extern "C" int ClientConnect(char const* hostName, int port);
+#else
+extern     int ClientConnect(char const* hostName, int port);
+#endif
@@ -0,0 +1,414 @@
+// vim:ts=2:et
+//============================================================================//
+//                                 "Sparse.hpp":                              //
+//        Compressed Sparse Row Matrices: Matrix Market Input, SpMM, SpGEMM   //
+//============================================================================//
+// Memory and time are proportional to the number of non-zeros (NNZ), not to
+// the matrix size. The products are computed by bands of rows, so that they
+// can be split between Threads (see "BalancedSplit"):
+//
+#pragma once
+#include "Philox.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "CSRMatrix": Compressed Sparse Row:                                      //
+  //==========================================================================//
+  // Row "i" is [m_rowPtr[i], m_rowPtr[i+1]) of "m_colIdx" and "m_vals"; the
+  // column indices in each row are sorted and unique:
+  //
+  template<typename T>
+  struct CSRMatrix
+  {
+    long              m_nRows;
+    long              m_nCols;
+    std::vector<long> m_rowPtr;     // Size m_nRows + 1
+    std::vector<long> m_colIdx;     // Size NNZ
+    std::vector<T>    m_vals;       // Size NNZ
+
+    long NNZ() const { return m_rowPtr.empty() ? 0 : m_rowPtr.back(); }
+
+    // Memory used by the arrays, in bytes:
+    size_t Bytes() const
+    {
+      return (m_rowPtr.size() + m_colIdx.size()) * sizeof(long) +
+             m_vals.size() * sizeof(T);
+    }
+  };
+
+  //==========================================================================//
+  // "CSRFromTriplets": (Row, Col, Val) Triplets in any order -> CSR:         //
+  //==========================================================================//
+  // Duplicate entries are summed up:
+  //
+  template<typename T>
+  CSRMatrix<T> CSRFromTriplets(long a_nRows, long a_nCols,
+                               std::vector<long> const& a_rows,
+                               std::vector<long> const& a_cols,
+                               std::vector<T>    const& a_vals)
+  {
+    CSRMatrix<T> res { a_nRows, a_nCols, std::vector<long>(size_t(a_nRows + 1)),
+                       {}, {} };
+    size_t const n = a_rows.size();
+
+    // Counting sort by rows:
+    for (size_t e = 0; e < n; ++e)
+      ++res.m_rowPtr[size_t(a_rows[e] + 1)];
+    for (long i = 0; i < a_nRows; ++i)
+      res.m_rowPtr[size_t(i + 1)] += res.m_rowPtr[size_t(i)];
+
+    std::vector<std::pair<long, T>> ents(n);
+    std::vector<long>               next(res.m_rowPtr.begin(),
+                                         res.m_rowPtr.end() - 1);
+    for (size_t e = 0; e < n; ++e)
+      ents[size_t(next[size_t(a_rows[e])]++)] = { a_cols[e], a_vals[e] };
+
+    // Sort each row by columns, and merge the duplicates:
+    res.m_colIdx.reserve(n);
+    res.m_vals  .reserve(n);
+    long from = 0;
+    for (long i = 0; i < a_nRows; ++i)
+    {
+      long to = res.m_rowPtr[size_t(i + 1)];
+      std::sort(ents.begin() + from, ents.begin() + to,
+                [](auto const& a_x, auto const& a_y)
+                  { return a_x.first < a_y.first; });
+      for (long e = from; e < to; ++e)
+        if (e > from && ents[size_t(e)].first == ents[size_t(e - 1)].first)
+          res.m_vals.back() += ents[size_t(e)].second;
+        else
+        {
+          res.m_colIdx.push_back(ents[size_t(e)].first);
+          res.m_vals  .push_back(ents[size_t(e)].second);
+        }
+      from = to;
+      res.m_rowPtr[size_t(i + 1)] = long(res.m_colIdx.size());
+    }
+    return res;
+  }
+
+  //==========================================================================//
+  // "CSRLoadMatrixMarket": Read a Matrix Market ".mtx" File:                 //
+  //==========================================================================//
+  // Only the "coordinate" format is supported, with "real", "integer" or
+  // "pattern" (all entries are 1) fields, and "general", "symmetric" or
+  // "skew-symmetric" storage. Throws "std::runtime_error" on errors:
+  //
+  template<typename T>
+  CSRMatrix<T> CSRLoadMatrixMarket(std::string const& a_path)
+  {
+    std::ifstream in(a_path);
+    if (!in)
+      throw std::runtime_error("CSRLoadMatrixMarket: Cannot open " + a_path);
+
+    auto fail = [&a_path](char const* a_what)
+    {
+      throw std::runtime_error
+            (std::string("CSRLoadMatrixMarket: ") + a_what + ": " + a_path);
+    };
+
+    // The Banner:
+    std::string line;
+    std::getline(in, line);
+    for (char& c: line)
+      c = char(std::tolower(static_cast<unsigned char>(c)));
+    std::istringstream banner(line);
+    std::string        magic, object, format, field, symm;
+    banner >> magic >> object >> format >> field >> symm;
+    if (magic != "%%matrixmarket" || object != "matrix")
+      fail("Not a Matrix Market file");
+    if (format != "coordinate")
+      fail("Only the \"coordinate\" format is supported");
+    bool pattern = (field == "pattern");
+    if (!pattern && field != "real" && field != "integer")
+      fail("Unsupported field type");
+    bool symmetric = (symm == "symmetric");
+    bool skew      = (symm == "skew-symmetric");
+    if (!symmetric && !skew && symm != "general")
+      fail("Unsupported symmetry type");
+
+    // Skip the comments, then the sizes:
+    do
+      std::getline(in, line);
+    while (in && (line.empty() || line[0] == '%'));
+    long nRows = 0, nCols = 0, nnz = 0;
+    if (!(std::istringstream(line) >> nRows >> nCols >> nnz) ||
+        nRows <= 0 || nCols <= 0 || nnz < 0)
+      fail("Invalid sizes line");
+
+    // The entries (1-based), with the mirror images of the off-diagonal ones
+    // for symmetric matrices:
+    std::vector<long> rows, cols;
+    std::vector<T>    vals;
+    size_t            cap = size_t(nnz) * ((symmetric || skew) ? 2 : 1);
+    rows.reserve(cap);
+    cols.reserve(cap);
+    vals.reserve(cap);
+    for (long e = 0; e < nnz; ++e)
+    {
+      long   i = 0, j = 0;
+      double v = 1.0;
+      if (!(in >> i >> j) || (!pattern && !(in >> v)))
+        fail("Truncated or invalid entries");
+      if (i < 1 || i > nRows || j < 1 || j > nCols)
+        fail("Entry index out of range");
+      rows.push_back(i - 1);
+      cols.push_back(j - 1);
+      vals.push_back(T(v));
+      if ((symmetric || skew) && i != j)
+      {
+        rows.push_back(j - 1);
+        cols.push_back(i - 1);
+        vals.push_back(T(skew ? -v : v));
+      }
+    }
+    return CSRFromTriplets(nRows, nCols, rows, cols, vals);
+  }
+
+  //==========================================================================//
+  // "CSRRandom": Random Sparse Matrix of the given Density:                  //
+  //==========================================================================//
+  // Row "i" has (a_density * a_nCols) non-zeros on average, in uniformly
+  // random columns; it is made from the Blocks (i << 32) + 0, 1, ... of
+  // "a_gen", so it only depends on the generator and "i". The values are
+  // made by "a_elem(uint32_t, uint32_t) -> T" from 2 random words:
+  //
+  template<typename T, typename ElemFunc>
+  CSRMatrix<T> CSRRandom(long a_nRows, long a_nCols, double a_density,
+                         Philox4x32 const& a_gen, ElemFunc const& a_elem)
+  {
+    CSRMatrix<T> res { a_nRows, a_nCols, { 0 }, {}, {} };
+    res.m_rowPtr.reserve(size_t(a_nRows + 1));
+    size_t expect = size_t(a_density * double(a_nRows) * double(a_nCols));
+    res.m_colIdx.reserve(expect + expect / 16);
+    res.m_vals  .reserve(expect + expect / 16);
+    std::vector<long> cols;
+
+    for (long i = 0; i < a_nRows; ++i)
+    {
+      uint64_t ctr = uint64_t(i) << 32;
+
+      // The number of non-zeros (with random rounding):
+      Philox4x32::Block blk = a_gen(ctr++);
+      double frac = double(blk[0]) * 0x1p-32;
+      long   nr   = std::min(a_nCols, long(a_density * double(a_nCols) + frac));
+
+      // Draw random columns until there are "nr" distinct ones:
+      cols.clear();
+      while (long(cols.size()) < nr)
+      {
+        for (long k = long(cols.size()); k < nr; k += 4)
+        {
+          blk = a_gen(ctr++);
+          for (int w = 0; w < 4 && k + w < nr; ++w)
+            cols.push_back(long((uint64_t(blk[size_t(w)]) *
+                                 uint64_t(a_nCols)) >> 32));
+        }
+        std::sort(cols.begin(), cols.end());
+        cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+      }
+
+      // The values, 2 per Block:
+      for (long k = 0; k < nr; ++k)
+      {
+        if (k % 2 == 0)
+          blk = a_gen(ctr++);
+        int w = 2 * int(k % 2);
+        res.m_colIdx.push_back(cols[size_t(k)]);
+        res.m_vals  .push_back(a_elem(blk[size_t(w)], blk[size_t(w + 1)]));
+      }
+      res.m_rowPtr.push_back(long(res.m_colIdx.size()));
+    }
+    return res;
+  }
+
+  //==========================================================================//
+  // "BalancedSplit": Split Rows into Ranges of about Equal Cost:             //
+  //==========================================================================//
+  // "a_prefix[i]" is the cost of the rows [0, i) (size NRows + 1), eg the
+  // "m_rowPtr" of a CSR matrix for the cost proportional to NNZ. Returns the
+  // range boundaries (at most a_nParts + 1 of them, from 0 to NRows; empty
+  // ranges are dropped):
+  //
+  inline std::vector<long> BalancedSplit(std::vector<long> const& a_prefix,
+                                         long a_nParts)
+  {
+    long              nRows = long(a_prefix.size()) - 1;
+    double            total = double(a_prefix.back() - a_prefix.front());
+    std::vector<long> res { 0 };
+    for (long p = 1; p < a_nParts; ++p)
+    {
+      long target = a_prefix.front() +
+                    long(total * double(p) / double(a_nParts));
+      long i      = long(std::lower_bound(a_prefix.begin(), a_prefix.end(),
+                                          target) - a_prefix.begin());
+      if (i > res.back() && i < nRows)
+        res.push_back(i);
+    }
+    if (nRows > res.back())
+      res.push_back(nRows);
+    return res;
+  }
+
+  //==========================================================================//
+  // "SpGEMMCosts": Prefix Sums of the Per-Row Costs of A * B:                //
+  //==========================================================================//
+  // The cost of row "i" is its number of multiply-adds, ie the sum of the
+  // NNZs of the rows of B selected by the non-zeros of A[i, *]:
+  //
+  template<typename TA, typename TB>
+  std::vector<long> SpGEMMCosts(CSRMatrix<TA> const& a_A,
+                                CSRMatrix<TB> const& a_B)
+  {
+    std::vector<long> res(size_t(a_A.m_nRows + 1), 0);
+    for (long i = 0; i < a_A.m_nRows; ++i)
+    {
+      long cost = 0;
+      for (long p = a_A.m_rowPtr[size_t(i)]; p < a_A.m_rowPtr[size_t(i + 1)];
+           ++p)
+      {
+        long k = a_A.m_colIdx[size_t(p)];
+        cost  += a_B.m_rowPtr[size_t(k + 1)] - a_B.m_rowPtr[size_t(k)];
+      }
+      res[size_t(i + 1)] = res[size_t(i)] + cost;
+    }
+    return res;
+  }
+
+  //==========================================================================//
+  // "SpMMRows": Sparse x Dense, Rows [a_i0, a_i1) of C:                      //
+  //==========================================================================//
+  // C = A * B, where B is dense (A.m_nCols x a_m), and so is C (A.m_nRows x
+  // a_m); each non-zero of A adds a multiple of a row of B to a row of C:
+  //
+  template<typename TIn, typename TAcc>
+  void SpMMRows(CSRMatrix<TIn> const& a_A, TIn const* a_B, long a_ldb,
+                long a_m, TAcc* a_C, long a_ldc, long a_i0, long a_i1)
+  {
+    for (long i = a_i0; i < a_i1; ++i)
+    {
+      TAcc* rowC = a_C + i * a_ldc;
+      std::fill(rowC, rowC + a_m, TAcc(0));
+      for (long p = a_A.m_rowPtr[size_t(i)]; p < a_A.m_rowPtr[size_t(i + 1)];
+           ++p)
+      {
+        TAcc       a    = TAcc(a_A.m_vals[size_t(p)]);
+        TIn const* rowB = a_B + a_A.m_colIdx[size_t(p)] * a_ldb;
+        for (long j = 0; j < a_m; ++j)
+          rowC[j] += a * TAcc(rowB[j]);
+      }
+    }
+  }
+
+  //==========================================================================//
+  // "SpGEMMWorkspace": Dense Accumulator for "SpGEMMRows":                   //
+  //==========================================================================//
+  // Of the size of a row of C (O(N), not O(N^2)); only the entries touched
+  // by a row are reset, so it can be reused for any number of rows:
+  //
+  template<typename TAcc>
+  struct SpGEMMWorkspace
+  {
+    std::vector<TAcc> m_acc;
+    std::vector<long> m_mark;       // Row which touches the column, or -1
+    std::vector<long> m_cols;       // Columns touched by the curr row
+
+    void Reserve(long a_nCols)
+    {
+      if (long(m_acc.size()) < a_nCols)
+      {
+        m_acc .assign(size_t(a_nCols), TAcc(0));
+        m_mark.assign(size_t(a_nCols), -1);
+      }
+    }
+  };
+
+  //==========================================================================//
+  // "SpGEMMRows": Sparse x Sparse, Rows [a_i0, a_i1) of C (Gustavson):       //
+  //==========================================================================//
+  // The rows are returned as a CSR matrix of (a_i1 - a_i0) rows; the bands
+  // are then put together by "CSRConcat":
+  //
+  template<typename TIn, typename TAcc>
+  CSRMatrix<TAcc> SpGEMMRows(CSRMatrix<TIn> const& a_A,
+                             CSRMatrix<TIn> const& a_B,
+                             long a_i0, long a_i1,
+                             SpGEMMWorkspace<TAcc>& a_ws)
+  {
+    CSRMatrix<TAcc> res { a_i1 - a_i0, a_B.m_nCols, { 0 }, {}, {} };
+    res.m_rowPtr.reserve(size_t(a_i1 - a_i0 + 1));
+    a_ws.Reserve(a_B.m_nCols);
+
+    for (long i = a_i0; i < a_i1; ++i)
+    {
+      // Scatter: acc[*] = sum_k A[i, k] * B[k, *]:
+      a_ws.m_cols.clear();
+      for (long p = a_A.m_rowPtr[size_t(i)]; p < a_A.m_rowPtr[size_t(i + 1)];
+           ++p)
+      {
+        TAcc a = TAcc(a_A.m_vals[size_t(p)]);
+        long k = a_A.m_colIdx[size_t(p)];
+        for (long q = a_B.m_rowPtr[size_t(k)]; q < a_B.m_rowPtr[size_t(k + 1)];
+             ++q)
+        {
+          long j = a_B.m_colIdx[size_t(q)];
+          if (a_ws.m_mark[size_t(j)] != i)
+          {
+            a_ws.m_mark[size_t(j)] = i;
+            a_ws.m_acc [size_t(j)] = TAcc(0);
+            a_ws.m_cols.push_back(j);
+          }
+          a_ws.m_acc[size_t(j)] += a * TAcc(a_B.m_vals[size_t(q)]);
+        }
+      }
+      // Gather, in the order of columns (and reset the marks):
+      std::sort(a_ws.m_cols.begin(), a_ws.m_cols.end());
+      for (long j: a_ws.m_cols)
+      {
+        res.m_colIdx.push_back(j);
+        res.m_vals  .push_back(a_ws.m_acc[size_t(j)]);
+        a_ws.m_mark[size_t(j)] = -1;
+      }
+      res.m_rowPtr.push_back(long(res.m_colIdx.size()));
+    }
+    return res;
+  }
+
+  //==========================================================================//
+  // "CSRConcat": Put Bands of Rows Together:                                 //
+  //==========================================================================//
+  template<typename T>
+  CSRMatrix<T> CSRConcat(std::vector<CSRMatrix<T>> const& a_bands)
+  {
+    CSRMatrix<T> res { 0, a_bands.empty() ? 0 : a_bands[0].m_nCols, { 0 },
+                       {}, {} };
+    size_t nnz = 0;
+    for (CSRMatrix<T> const& band: a_bands)
+      nnz += size_t(band.NNZ());
+    res.m_colIdx.reserve(nnz);
+    res.m_vals  .reserve(nnz);
+
+    for (CSRMatrix<T> const& band: a_bands)
+    {
+      long base = long(res.m_colIdx.size());
+      for (long i = 0; i < band.m_nRows; ++i)
+        res.m_rowPtr.push_back(base + band.m_rowPtr[size_t(i + 1)]);
+      res.m_colIdx.insert(res.m_colIdx.end(), band.m_colIdx.begin(),
+                          band.m_colIdx.end());
+      res.m_vals  .insert(res.m_vals.end(),   band.m_vals.begin(),
+                          band.m_vals.end());
+      res.m_nRows += band.m_nRows;
+    }
+    return res;
+  }
+} // End namespace SiriusFMTM
@@ -0,0 +1,379 @@
+// vim:ts=2:et
+//============================================================================//
+//                                "Strassen.hpp":                             //
+//            Strassen-Winograd Matrix Multiplication (Square Matrices)       //
+//============================================================================//
+// C = A * B by recursion on quadrants, with 7 (rather than 8) sub-products
+// and 15 additions per level (Winograd's variant):
+//
+//   S1 = A21 + A22   T1 = B12 - B11   P1 = A11 * B11   P5 = S1  * T1
+//   S2 = S1  - A11   T2 = B22 - T1    P2 = A12 * B21   P6 = S2  * T2
+//   S3 = A11 - A21   T3 = B22 - B12   P3 = S4  * B22   P7 = S3  * T3
+//   S4 = A12 - S2    T4 = T2  - B21   P4 = A22 * T4
+//
+//   C11 = P1 + P2    U2 = P1 + P6     C21 = U3 - P4    (U3 = U2 + P7)
+//   C12 = U2 + P5 + P3                C22 = U3 + P5
+//
+// Below the cut-off size, the blocked GEMM is used. An odd row and column
+// are peeled off and done with GEMM as well. All temporaries come from a
+// pre-allocated "WorkspaceArena". The results differ from the classical
+// product by rounding errors which grow with the recursion depth:
+//
+#pragma once
+#include "GEMM.hpp"
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "WorkspaceArena": Pre-Allocated Stack of Temporary Arrays:               //
+  //==========================================================================//
+  template<typename T>
+  class WorkspaceArena
+  {
+  private:
+    // Each array is rounded up to a whole number of cache lines:
+    constexpr static size_t Gran = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+    AlignedArray<T> m_buff;
+    size_t          m_top;
+
+  public:
+    WorkspaceArena(): m_buff(), m_top(0) {}
+
+    static size_t Rounded(size_t a_n) { return (a_n + Gran - 1) / Gran * Gran; }
+
+    // Ensure the capacity of at least "a_n" elements (only when empty):
+    void Reserve(size_t a_n)
+    {
+      assert(m_top == 0);
+      (void) m_buff.Reserve(a_n);
+    }
+
+    T* Alloc(size_t a_n)
+    {
+      a_n = Rounded(a_n);
+      if (m_top + a_n > m_buff.Size())
+        throw std::runtime_error("WorkspaceArena: Out of space");
+      T* res = m_buff.Data() + m_top;
+      m_top += a_n;
+      return res;
+    }
+
+    // Arrays allocated after "Mark" are released by "Reset" to that mark:
+    size_t Mark () const     { return m_top;   }
+    void   Reset(size_t a_m) { m_top = a_m;    }
+  };
+
+  //==========================================================================//
+  // "StrassenParams", "StrassenProduct":                                     //
+  //==========================================================================//
+  template<typename T>
+  struct StrassenParams
+  {
+    GEMMMicroKernel<T> const* m_kern;     // For the blocks at the cut-off
+    GEMMBlocking       const* m_blk;      //
+    long                      m_cutoff;   // Use GEMM if N <= "m_cutoff"
+  };
+
+  // C[N x N] = A[N x N] * B[N x N], with the row strides:
+  template<typename T>
+  struct StrassenProduct
+  {
+    long      m_n;
+    T const*  m_A;
+    long      m_lda;
+    T const*  m_B;
+    long      m_ldb;
+    T*        m_C;
+    long      m_ldc;
+  };
+
+  namespace Detail
+  {
+    //------------------------------------------------------------------------//
+    // "AddSub": Z[N x N] = X + Y  or  X - Y  (Z may coincide with X or Y):   //
+    //------------------------------------------------------------------------//
+    template<bool Add, typename T>
+    void AddSub(long a_n, T const* a_X, long a_ldx, T const* a_Y, long a_ldy,
+                T* a_Z, long a_ldz)
+    {
+      for (long i = 0; i < a_n; ++i)
+      {
+        T const* x = a_X + i * a_ldx;
+        T const* y = a_Y + i * a_ldy;
+        T*       z = a_Z + i * a_ldz;
+        for (long j = 0; j < a_n; ++j)
+          z[j] = Add ? (x[j] + y[j]) : (x[j] - y[j]);
+      }
+    }
+
+    //------------------------------------------------------------------------//
+    // "StrassenPeel": Complete C for an odd N:                               //
+    //------------------------------------------------------------------------//
+    // The even-sized leading part C[0:M, 0:M] (M = N-1) must already contain
+    // A[0:M, 0:M] * B[0:M, 0:M]:
+    //
+    template<typename T>
+    void StrassenPeel(StrassenProduct<T> const& a_p,
+                      StrassenParams<T>  const& a_params)
+    {
+      long     N   = a_p.m_n;
+      long     M   = N - 1;
+      T const* A   = a_p.m_A;
+      T const* B   = a_p.m_B;
+      T*       C   = a_p.m_C;
+      long     lda = a_p.m_lda, ldb = a_p.m_ldb, ldc = a_p.m_ldc;
+      auto const& kern = *a_params.m_kern;
+      auto const& blk  = *a_params.m_blk;
+
+      // C[0:M, 0:M] += A[0:M, M] * B[M, 0:M]:
+      GEMM<T>(M, M, 1, A + M, lda, B + M * ldb, ldb, C, ldc, kern, blk,
+              true);
+      // C[0:M, M] = A[0:M, *] * B[*, M]:
+      GEMM<T>(M, 1, N, A, lda, B + M, ldb, C + M, ldc, kern, blk);
+      // C[M, *]   = A[M, *]   * B:
+      GEMM<T>(1, N, N, A + M * lda, lda, B, ldb, C + M * ldc, ldc,
+              kern, blk);
+    }
+
+    // Quadrant (0 or 1, 0 or 1) of a matrix with half-size "a_h":
+    template<typename T>
+    T* Quad(T* a_X, long a_ld, long a_h, int a_i, int a_j)
+      { return a_X + a_i * a_h * a_ld + a_j * a_h; }
+  } // End namespace Detail
+
+  //==========================================================================//
+  // "StrassenWorkspace": Arena Size (in elements) for "StrassenWinograd":    //
+  //==========================================================================//
+  template<typename T>
+  size_t StrassenWorkspace(long a_n, long a_cutoff)
+  {
+    size_t res = 0;
+    for (; a_n > a_cutoff; a_n /= 2)
+      res += 2 * WorkspaceArena<T>::Rounded(size_t(a_n / 2) * size_t(a_n / 2));
+    return res;
+  }
+
+  //==========================================================================//
+  // "StrassenWinograd": Sequential Recursion:                                //
+  //==========================================================================//
+  // Uses 2 temporaries per level (the rest is kept in the quadrants of C), so
+  // "a_arena" needs "StrassenWorkspace" elements of free space:
+  //
+  template<typename T>
+  void StrassenWinograd(StrassenProduct<T> const& a_p,
+                        StrassenParams<T>  const& a_params,
+                        WorkspaceArena<T>&        a_arena)
+  {
+    long N = a_p.m_n;
+    if (N <= a_params.m_cutoff)
+    {
+      GEMM<T>(N, N, N, a_p.m_A, a_p.m_lda, a_p.m_B, a_p.m_ldb,
+              a_p.m_C, a_p.m_ldc, *a_params.m_kern, *a_params.m_blk);
+      return;
+    }
+    long     h   = N / 2;
+    long     lda = a_p.m_lda, ldb = a_p.m_ldb, ldc = a_p.m_ldc;
+    T const* A11 = Detail::Quad(a_p.m_A, lda, h, 0, 0);
+    T const* A12 = Detail::Quad(a_p.m_A, lda, h, 0, 1);
+    T const* A21 = Detail::Quad(a_p.m_A, lda, h, 1, 0);
+    T const* A22 = Detail::Quad(a_p.m_A, lda, h, 1, 1);
+    T const* B11 = Detail::Quad(a_p.m_B, ldb, h, 0, 0);
+    T const* B12 = Detail::Quad(a_p.m_B, ldb, h, 0, 1);
+    T const* B21 = Detail::Quad(a_p.m_B, ldb, h, 1, 0);
+    T const* B22 = Detail::Quad(a_p.m_B, ldb, h, 1, 1);
+    T*       C11 = Detail::Quad(a_p.m_C, ldc, h, 0, 0);
+    T*       C12 = Detail::Quad(a_p.m_C, ldc, h, 0, 1);
+    T*       C21 = Detail::Quad(a_p.m_C, ldc, h, 1, 0);
+    T*       C22 = Detail::Quad(a_p.m_C, ldc, h, 1, 1);
+
+    size_t mark = a_arena.Mark();
+    T*     X    = a_arena.Alloc(size_t(h * h));
+    T*     Y    = a_arena.Alloc(size_t(h * h));
+
+    auto mult = [&](T const* a_A, long a_lda, T const* a_B, long a_ldb,
+                    T* a_C, long a_ldc)
+    {
+      StrassenWinograd<T>(StrassenProduct<T>{ h, a_A, a_lda, a_B, a_ldb,
+                                              a_C, a_ldc },
+                          a_params, a_arena);
+    };
+    using Detail::AddSub;
+
+    AddSub<false>(h, A11, lda, A21, lda, X,   h);     // X   = S3
+    AddSub<false>(h, B22, ldb, B12, ldb, Y,   h);     // Y   = T3
+    mult(X,   h,   Y,   h,   C21, ldc);               // C21 = P7
+    AddSub<true> (h, A21, lda, A22, lda, X,   h);     // X   = S1
+    AddSub<false>(h, B12, ldb, B11, ldb, Y,   h);     // Y   = T1
+    mult(X,   h,   Y,   h,   C22, ldc);               // C22 = P5
+    AddSub<false>(h, X,   h,   A11, lda, X,   h);     // X   = S2
+    AddSub<false>(h, B22, ldb, Y,   h,   Y,   h);     // Y   = T2
+    mult(X,   h,   Y,   h,   C12, ldc);               // C12 = P6
+    AddSub<false>(h, A12, lda, X,   h,   X,   h);     // X   = S4
+    mult(X,   h,   B22, ldb, C11, ldc);               // C11 = P3
+    mult(A11, lda, B11, ldb, X,   h);                 // X   = P1
+    AddSub<true> (h, X,   h,   C12, ldc, C12, ldc);   // C12 = U2
+    AddSub<true> (h, C12, ldc, C21, ldc, C21, ldc);   // C21 = U3
+    AddSub<true> (h, C12, ldc, C22, ldc, C12, ldc);   // C12 = U2 + P5
+    AddSub<true> (h, C21, ldc, C22, ldc, C22, ldc);   // C22 = U3 + P5
+    AddSub<true> (h, C12, ldc, C11, ldc, C12, ldc);   // C12 = U2 + P5 + P3
+    AddSub<false>(h, Y,   h,   B21, ldb, Y,   h);     // Y   = T4
+    mult(A22, lda, Y,   h,   C11, ldc);               // C11 = P4
+    AddSub<false>(h, C21, ldc, C11, ldc, C21, ldc);   // C21 = U3 - P4
+    mult(A12, lda, B21, ldb, C11, ldc);               // C11 = P2
+    AddSub<true> (h, X,   h,   C11, ldc, C11, ldc);   // C11 = P1 + P2
+
+    a_arena.Reset(mark);
+    if (N % 2 != 0)
+      Detail::StrassenPeel(a_p, a_params);
+  }
+
+  //==========================================================================//
+  // "StrassenPlan": The Top Levels of the Recursion, for Parallel Execution: //
+  //==========================================================================//
+  // The top "a_depth" levels are expanded in advance: the S and T operands
+  // are computed by the ctor, so that the 7^depth "Products" are independent
+  // (and can be given to different Threads, each one running the sequential
+  // "StrassenWinograd"), and "Finish" combines their results. Each expanded
+  // level keeps 3 of the 7 sub-products in temporaries (the other 4 go into
+  // the quadrants of C), ie the arena takes (11/4) N^2 elements for the 1st
+  // level, (77/16) N^2 for 2 levels, etc:
+  //
+  template<typename T>
+  class StrassenPlan
+  {
+  private:
+    struct Node
+    {
+      StrassenProduct<T> m_p;
+      T*                 m_P1;
+      T*                 m_P4;
+      T*                 m_P6;
+    };
+    StrassenParams<T>               m_params;
+    WorkspaceArena<T>               m_arena;
+    std::vector<Node>               m_nodes;     // Parents before children
+    std::vector<StrassenProduct<T>> m_products;
+
+    static size_t Workspace(long a_n, int a_depth, long a_cutoff)
+    {
+      if (a_depth == 0 || a_n <= a_cutoff)
+        return 0;
+      long h = a_n / 2;
+      return 11 * WorkspaceArena<T>::Rounded(size_t(h * h)) +
+             7  * Workspace(h, a_depth - 1, a_cutoff);
+    }
+
+    void Expand(StrassenProduct<T> const& a_p, int a_depth)
+    {
+      long N = a_p.m_n;
+      if (a_depth == 0 || N <= m_params.m_cutoff)
+      {
+        m_products.push_back(a_p);
+        return;
+      }
+      long     h   = N / 2;
+      size_t   h2  = size_t(h * h);
+      long     lda = a_p.m_lda, ldb = a_p.m_ldb, ldc = a_p.m_ldc;
+      T const* A11 = Detail::Quad(a_p.m_A, lda, h, 0, 0);
+      T const* A12 = Detail::Quad(a_p.m_A, lda, h, 0, 1);
+      T const* A21 = Detail::Quad(a_p.m_A, lda, h, 1, 0);
+      T const* A22 = Detail::Quad(a_p.m_A, lda, h, 1, 1);
+      T const* B11 = Detail::Quad(a_p.m_B, ldb, h, 0, 0);
+      T const* B12 = Detail::Quad(a_p.m_B, ldb, h, 0, 1);
+      T const* B21 = Detail::Quad(a_p.m_B, ldb, h, 1, 0);
+      T const* B22 = Detail::Quad(a_p.m_B, ldb, h, 1, 1);
+
+      T* S[4];
+      T* U[4];
+      for (int i = 0; i < 4; ++i)
+      {
+        S[i] = m_arena.Alloc(h2);
+        U[i] = m_arena.Alloc(h2);
+      }
+      Node node { a_p, m_arena.Alloc(h2), m_arena.Alloc(h2),
+                  m_arena.Alloc(h2) };
+      m_nodes.push_back(node);
+
+      using Detail::AddSub;
+      AddSub<true> (h, A21,  lda, A22,  lda, S[0], h);
+      AddSub<false>(h, S[0], h,   A11,  lda, S[1], h);
+      AddSub<false>(h, A11,  lda, A21,  lda, S[2], h);
+      AddSub<false>(h, A12,  lda, S[1], h,   S[3], h);
+      AddSub<false>(h, B12,  ldb, B11,  ldb, U[0], h);
+      AddSub<false>(h, B22,  ldb, U[0], h,   U[1], h);
+      AddSub<false>(h, B22,  ldb, B12,  ldb, U[2], h);
+      AddSub<false>(h, U[1], h,   B21,  ldb, U[3], h);
+
+      T* C11 = Detail::Quad(a_p.m_C, ldc, h, 0, 0);
+      T* C12 = Detail::Quad(a_p.m_C, ldc, h, 0, 1);
+      T* C21 = Detail::Quad(a_p.m_C, ldc, h, 1, 0);
+      T* C22 = Detail::Quad(a_p.m_C, ldc, h, 1, 1);
+
+      --a_depth;
+      Expand({ h, A11,  lda, B11,  ldb, node.m_P1, h   }, a_depth);   // P1
+      Expand({ h, A12,  lda, B21,  ldb, C11,       ldc }, a_depth);   // P2
+      Expand({ h, S[3], h,   B22,  ldb, C12,       ldc }, a_depth);   // P3
+      Expand({ h, A22,  lda, U[3], h,   node.m_P4, h   }, a_depth);   // P4
+      Expand({ h, S[0], h,   U[0], h,   C22,       ldc }, a_depth);   // P5
+      Expand({ h, S[1], h,   U[1], h,   node.m_P6, h   }, a_depth);   // P6
+      Expand({ h, S[2], h,   U[2], h,   C21,       ldc }, a_depth);   // P7
+    }
+
+  public:
+    //------------------------------------------------------------------------//
+    // Non-Default Ctor:                                                      //
+    //------------------------------------------------------------------------//
+    StrassenPlan(StrassenProduct<T> const& a_p,
+                 StrassenParams<T>  const& a_params,
+                 int                       a_depth)
+    : m_params  (a_params),
+      m_arena   (),
+      m_nodes   (),
+      m_products()
+    {
+      m_arena.Reserve(Workspace(a_p.m_n, a_depth, a_params.m_cutoff));
+      Expand(a_p, a_depth);
+    }
+
+    StrassenPlan(StrassenPlan const&)            = delete;
+    StrassenPlan& operator=(StrassenPlan const&) = delete;
+
+    // The independent sub-products, to be computed (eg by "StrassenWinograd")
+    // before "Finish":
+    std::vector<StrassenProduct<T>> const& Products() const
+      { return m_products; }
+
+    //------------------------------------------------------------------------//
+    // "Finish": Combine the sub-products, from the bottom level up:          //
+    //------------------------------------------------------------------------//
+    void Finish() const
+    {
+      using Detail::AddSub;
+      for (auto it = m_nodes.rbegin(); it != m_nodes.rend(); ++it)
+      {
+        StrassenProduct<T> const& p = it->m_p;
+        long h   = p.m_n / 2;
+        long ldc = p.m_ldc;
+        T*   C11 = Detail::Quad(p.m_C, ldc, h, 0, 0);
+        T*   C12 = Detail::Quad(p.m_C, ldc, h, 0, 1);
+        T*   C21 = Detail::Quad(p.m_C, ldc, h, 1, 0);
+        T*   C22 = Detail::Quad(p.m_C, ldc, h, 1, 1);
+
+        AddSub<true> (h, it->m_P1, h,   C11,      ldc, C11,      ldc);
+        AddSub<true> (h, it->m_P1, h,   it->m_P6, h,   it->m_P6, h);  // U2
+        AddSub<true> (h, C12,      ldc, it->m_P6, h,   C12,      ldc);
+        AddSub<true> (h, C12,      ldc, C22,      ldc, C12,      ldc);
+        AddSub<true> (h, C21,      ldc, it->m_P6, h,   C21,      ldc);  // U3
+        AddSub<true> (h, C22,      ldc, C21,      ldc, C22,      ldc);
+        AddSub<false>(h, C21,      ldc, it->m_P4, h,   C21,      ldc);
+
+        if (p.m_n % 2 != 0)
+          Detail::StrassenPeel(p, m_params);
+      }
+    }
+  };
+} // End namespace SiriusFMTM
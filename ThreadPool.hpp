@@ -9,22 +9,62 @@
 #else
 #include "CircularBuffer.hpp"
 #endif
+#include "ThreadPoolStats.hpp"
+#include "CPUTopology.hpp"
 #include <boost/core/noncopyable.hpp>
 #include <pthread.h>
+#include <time.h>
+#include <cxxabi.h>
+#include <cerrno>
+#include <cstdint>
 #include <stdexcept>
 #include <type_traits>
+#include <algorithm>
+#include <coroutine>
 #include <cassert>
 #include <iostream>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace SiriusFMTM
 {
+  //==========================================================================//
+  // "ThreadAffinityE": Placement of the Pool's Worker Threads on CPUs:       //
+  //==========================================================================//
+  // None:     No pinning, the OS is free to migrate the Threads;
+  // Compact:  Worker "i" is pinned to the i-th allowed CPU, filling up NUMA
+  //           Node 0 first, then Node 1, etc;
+  // Scatter:  Workers are pinned round-robin across the NUMA Nodes;
+  // Explicit: Worker "i" is pinned to "m_cpus[i % m_cpus.size()]":
+  //
+  enum class ThreadAffinityE: int
+  {
+    None     = 0,
+    Compact  = 1,
+    Scatter  = 2,
+    Explicit = 3
+  };
+
+  //==========================================================================//
+  // "ThreadConfig": Attrs of the Pool's Worker Threads:                      //
+  //==========================================================================//
+  struct ThreadConfig
+  {
+    ThreadAffinityE  m_affinity;
+    std::vector<int> m_cpus;        // Only used with "Explicit"
+    size_t           m_stackSize;   // In bytes, 0 for the system default
+  };
+
   //==========================================================================//
   // "ThreadPool" Class:                                                      //
   //==========================================================================//
   // Func: WorkItem -> Res:
+  // Stats: Instrumentation Policy ("NoStats" or "PoolStats"), see
+  //        "ThreadPoolStats.hpp":
   //
-  template<typename WorkItem, typename Res, typename Func>
+  template<typename WorkItem, typename Res, typename Func,
+           typename Stats = NoStats>
   class ThreadPool: public boost::noncopyable
   {
   public:
@@ -40,6 +80,54 @@ namespace SiriusFMTM
       Failed       = 4
     };
 
+    //------------------------------------------------------------------------//
+    // "SchedPolicyE": How Workers choose between the Priority Lanes:         //
+    //------------------------------------------------------------------------//
+    // Lane 0 has the highest priority:
+    // StrictPriority: Always serve the highest-priority non-empty lane, BUT a
+    //                 lane which has been passed over "StarvLimit" times in a
+    //                 row is served next (starvation guard);
+    // WeightedRR:     Serve up to "m_weight" jobs from each lane in turn:
+    //
+    enum class SchedPolicyE: int
+    {
+      StrictPriority = 0,
+      WeightedRR     = 1
+    };
+
+    //------------------------------------------------------------------------//
+    // "LaneConfig": Queue Depth Limit and WRR Weight of a Priority Lane:     //
+    //------------------------------------------------------------------------//
+    struct LaneConfig
+    {
+      size_t   m_depth;       // Max number of queued jobs in this lane
+      unsigned m_weight;      // Only used with WeightedRR, must be >= 1
+    };
+
+    //------------------------------------------------------------------------//
+    // "ElasticConfig": Params for growing/shrinking the Pool at run-time:    //
+    //------------------------------------------------------------------------//
+    // The PoolSize given to the Ctor is the minimum number of Threads:
+    //
+    struct ElasticConfig
+    {
+      size_t   m_maxThreads;      // Upper bound on the number of Threads
+      long     m_growWaitUSec;    // Grow if the oldest job waited that long
+      long     m_blockedUSec;     // Worker busy that long is "blocked"
+      long     m_idleTimeoutMSec; // Retire extra Threads idle for that long
+    };
+
+    //------------------------------------------------------------------------//
+    // "SizeCounters": Current Pool size and Grow/Shrink Event Counters:      //
+    //------------------------------------------------------------------------//
+    struct SizeCounters
+    {
+      size_t        m_nThreads;   // Currently running Worker Threads
+      size_t        m_nIdle;      // Of them, waiting for jobs
+      unsigned long m_nGrown;     // Threads added   by the Elastic Monitor
+      unsigned long m_nShrunk;    // Threads retired after the Idle Timeout
+    };
+
   private:
     //------------------------------------------------------------------------//
     // "JobDescr":                                                            //
@@ -47,23 +135,25 @@ namespace SiriusFMTM
     struct JobDescr
     {
       // Data Flds:
-      WorkItem    m_wi;
-      Res*        m_res;
-      JobStatusE* m_status;
-
-      // Default Ctor:
-      JobDescr()
-      : m_wi    (),
-        m_res   (nullptr),
-        m_status(nullptr)
-      {}
+      WorkItem                m_wi;
+      Res*                    m_res;
+      JobStatusE*             m_status;
+      uint64_t                m_enqNS;      // Enqueue time (CLOCK_MONOTONIC)
+      std::coroutine_handle<> m_cont;       // Resumed after the job, if set
+      bool                    m_resumeOnly; // No "Func" call, only "m_cont"
 
-      // Non-Default Ctor:
-      // "WorkItem" is supposed to be small enough to be passed by copy:
-      JobDescr(WorkItem a_wi, Res* a_res, JobStatusE* a_status)
-      : m_wi    (a_wi),
-        m_res   (a_res),
-        m_status(a_status)
+      // Non-Default Ctor (there is no Default one, as "WorkItem" need not be
+      // default-constructible). "WorkItem" is moved in, so it may be a move-
+      // only type:
+      JobDescr(WorkItem a_wi, Res* a_res, JobStatusE* a_status,
+               std::coroutine_handle<> a_cont        = nullptr,
+               bool                    a_resume_only = false)
+      : m_wi        (std::move(a_wi)),
+        m_res       (a_res),
+        m_status    (a_status),
+        m_enqNS     (0),          // Set by "SubmitJob"
+        m_cont      (a_cont),
+        m_resumeOnly(a_resume_only)
       {}
     };
 
@@ -76,33 +166,304 @@ namespace SiriusFMTM
 #   else
     using CB = CircularBuffer        <JobDescr>;
 #   endif
-    std::vector<pthread_t>  m_threads;
+
+    //------------------------------------------------------------------------//
+    // "LaneSet": Priority Lanes, each with its own bounded circular queues:  //
+    //------------------------------------------------------------------------//
+    // Each Lane has 1 queue for jobs w/o a NUMA hint (Queue 0), and 1 per NUMA
+    // Node (Queue 1+n). The SchedPolicy and the depth limit apply to a Lane
+    // as a whole, ie over all its Queues; the Queue only decides which of
+    // the selected Lane's jobs a given Worker gets.
+    // NB: Not thread-safe by itself, always accessed under "m_mutex":
+    //
+    class LaneSet
+    {
+    private:
+      struct Lane
+      {
+        // "CircularBuffer"s are not movable, hence unique_ptrs. Each can hold
+        // the whole Lane, as all its jobs may be hinted to the same Node:
+        std::vector<std::unique_ptr<CB>> m_buffs;
+        size_t    m_depth;
+        size_t    m_count;    // Over all Queues
+        unsigned  m_weight;
+        unsigned  m_skipped;  // StrictPriority: #times passed over in a row
+
+        Lane(LaneConfig const& a_cfg, size_t a_nqueues)
+        : m_buffs  (),
+          m_depth  (a_cfg.m_depth),
+          m_count  (0),
+          m_weight (a_cfg.m_weight),
+          m_skipped(0)
+        {
+          for (size_t q = 0; q < a_nqueues; ++q)
+            m_buffs.emplace_back(new CB(a_cfg.m_depth));
+        }
+      };
+      // "Lane"s are not movable either:
+      std::vector<std::unique_ptr<Lane>> m_lanes;
+      SchedPolicyE  const                m_policy;
+      unsigned      const                m_starvLimit;
+      size_t                             m_curr;    // WeightedRR: curr lane
+      unsigned                           m_credit;  // WeightedRR: jobs left
+      size_t                             m_count;   // Total jobs queued
+
+    public:
+      LaneSet
+      (
+        std::vector<LaneConfig> const& a_lanes,
+        SchedPolicyE                   a_policy,
+        unsigned                       a_starv_limit,
+        size_t                         a_nqueues
+      )
+      : m_lanes     (),
+        m_policy    (a_policy),
+        m_starvLimit(a_starv_limit),
+        m_curr      (0),
+        m_credit    (0),
+        m_count     (0)
+      {
+        if (a_lanes.empty())
+          throw std::invalid_argument("ThreadPool::LaneSet: No lanes");
+        for (LaneConfig const& cfg: a_lanes)
+        {
+          if (cfg.m_weight == 0)
+            throw std::invalid_argument("ThreadPool::LaneSet: Zero weight");
+          m_lanes.emplace_back(new Lane(cfg, a_nqueues));
+        }
+        m_credit = m_lanes[0]->m_weight;
+      }
+
+      size_t NLanes() const { return m_lanes.size(); }
+      bool   empty () const { return m_count == 0;   }
+      size_t size  () const { return m_count;        }
+
+      // Enqueue time of the oldest job in all lanes (UINT64_MAX if empty):
+      uint64_t OldestEnqNS() const
+      {
+        uint64_t res = UINT64_MAX;
+        for (std::unique_ptr<Lane> const& lane: m_lanes)
+          for (std::unique_ptr<CB> const& buff: lane->m_buffs)
+            if (!buff->empty() && buff->front().m_enqNS < res)
+              res = buff->front().m_enqNS;
+        return res;
+      }
+
+      bool Full(size_t a_lane) const
+      {
+        assert(a_lane < m_lanes.size());
+        return m_lanes[a_lane]->m_count >= m_lanes[a_lane]->m_depth;
+      }
+
+      // Pre-condition: "!Full(a_lane)":
+      void Push(size_t a_lane, size_t a_queue, JobDescr&& a_job)
+      {
+        assert(!Full(a_lane));
+        Lane* lane = m_lanes[a_lane].get();
+        assert(a_queue < lane->m_buffs.size());
+        lane->m_buffs[a_queue]->push_back(std::move(a_job));
+        ++lane->m_count;
+        ++m_count;
+      }
+
+      // Front job of the lane selected by the SchedPolicy, taken from Queue
+      // "a_queue" if it has any jobs of that lane, otherwise from Queue 0,
+      // otherwise from any other one. Pre-condition: "!empty()":
+      //
+      JobDescr Pop(size_t a_queue)
+      {
+        assert(!empty());
+        size_t sel = (m_policy == SchedPolicyE::StrictPriority)
+                     ? SelectStrict()
+                     : SelectWRR   ();
+        Lane* lane = m_lanes[sel].get();
+        --lane->m_count;
+        --m_count;
+
+        size_t const nq = lane->m_buffs.size();
+        size_t       q  = (a_queue < nq) ? a_queue : 0;
+        if (lane->m_buffs[q]->empty())
+          q = 0;
+        for (size_t i = 1; lane->m_buffs[q]->empty() && i < nq; ++i)
+          q = i;
+        CB& buff = *(lane->m_buffs[q]);
+        assert(!buff.empty());
+        // Same API for "boost::circular_buffer" and "CircularBuffer":
+        JobDescr job(std::move(buff.front()));
+        buff.pop_front();
+        return job;
+      }
+
+    private:
+      size_t SelectStrict()
+      {
+        size_t const n   = m_lanes.size();
+        size_t       sel = n;
+        // A starved lane (if any) wins; otherwise, the highest-priority one:
+        for (size_t l = 0; l < n && sel == n; ++l)
+          if (m_lanes[l]->m_count != 0 &&
+              m_lanes[l]->m_skipped >= m_starvLimit)
+            sel = l;
+        for (size_t l = 0; l < n && sel == n; ++l)
+          if (m_lanes[l]->m_count != 0)
+            sel = l;
+        assert(sel < n);
+
+        // All other non-empty lanes have been passed over once more:
+        for (size_t l = 0; l < n; ++l)
+          if (l == sel)
+            m_lanes[l]->m_skipped = 0;
+          else
+          if (m_lanes[l]->m_count != 0)
+            ++m_lanes[l]->m_skipped;
+        return sel;
+      }
+
+      size_t SelectWRR()
+      {
+        // Terminates because at least one lane is non-empty, all weights>=1:
+        while (m_credit == 0 || m_lanes[m_curr]->m_count == 0)
+        {
+          m_curr   = (m_curr + 1) % m_lanes.size();
+          m_credit = m_lanes[m_curr]->m_weight;
+        }
+        --m_credit;
+        return m_curr;
+      }
+    };
+
+    //------------------------------------------------------------------------//
+    // "Worker": Per-Thread Slot (slots of retired Threads are re-used):      //
+    //------------------------------------------------------------------------//
+    // All flds are protected by "m_mutex":
+    //
+    struct Worker
+    {
+      ThreadPool* m_pool;
+      pthread_t   m_th;
+      bool        m_active;       // Thread is running in this slot
+      uint64_t    m_busySinceNS;  // Start of the curr job, 0 if none
+      uint64_t    m_idleSinceNS;  // Start of the curr wait for jobs, or 0
+      int         m_cpu;          // Pinned to this CPU, or (-1)
+      int         m_node;         // On this NUMA Node,  or (-1)
+      // Only written by this Worker's own Thread (with the Mutex locked, so
+      // that it is consistent with the curr intervals above):
+      [[no_unique_address]] typename Stats::WorkerStats m_stats;
+    };
+
+    // Workers are referred to by ptrs from their Threads, hence unique_ptrs:
+    std::vector<std::unique_ptr<Worker>> m_workers;
     Func const*             m_func;
-    CB                      m_buff;
-    pthread_mutex_t         m_mutex;
-    pthread_cond_t          m_cv;
+    ThreadConfig            m_thrCfg;
+    CPUTopology             m_topo;
+    std::vector<int>        m_cpuOrder; // Slot "i" -> CPU, empty if unpinned
+    // Job Queues ([0] for jobs w/o a NUMA hint, [1+n] for NUMA Node "n")
+    // within each Priority Lane:
+    LaneSet                 m_lanes;
+    mutable pthread_mutex_t m_mutex;
+    // Signalled on new jobs: [0] for unpinned Workers, [1+n] for Node "n":
+    std::vector<pthread_cond_t> m_cvs;
+    std::vector<size_t>         m_nodeIdle; // Idle Workers waiting on each CV
+    std::vector<size_t>         m_nodeWoken;// Of them, signalled, not yet up
+    size_t                  m_nextCV;   // Round-robin for un-hinted jobs
+    pthread_cond_t          m_monCV;    // Wakes up the Elastic Monitor
+    size_t                  m_minThreads;
+    size_t                  m_maxThreads;
+    size_t                  m_nActive;  // Running Worker Threads
+    size_t                  m_nIdle;    // Of them, waiting for jobs
+    ElasticConfig           m_elastic;
+    bool                    m_hasMonitor;
+    pthread_t               m_monitor;
+    bool                    m_stopping;
+    unsigned long           m_nGrown;
+    unsigned long           m_nShrunk;
+    [[no_unique_address]]   Stats m_stats;
 
   public:
     //------------------------------------------------------------------------//
-    // Non-Default Ctor:                                                      //
+    // Non-Default Ctors:                                                     //
     //------------------------------------------------------------------------//
+    // Single FIFO lane of size "a_buff_sz":
+    //
     ThreadPool(size_t a_pool_sz, size_t a_buff_sz, Func const& a_func)
-    : m_threads(a_pool_sz),
-      m_func   (&a_func),
-      m_buff   (a_buff_sz),  // Initially empty
-      m_mutex  (PTHREAD_MUTEX_INITIALIZER),
-      m_cv     (PTHREAD_COND_INITIALIZER)
+    : ThreadPool(a_pool_sz, {LaneConfig{a_buff_sz, 1}}, a_func)
+    {}
+
+    // Multiple Priority Lanes (Lane 0 has the highest priority), and
+    // optional Thread Affinity and Stack Size:
+    //
+    ThreadPool
+    (
+      size_t                         a_pool_sz,
+      std::vector<LaneConfig> const& a_lanes,
+      Func const&                    a_func,
+      SchedPolicyE                   a_policy      =
+                                     SchedPolicyE::StrictPriority,
+      unsigned                       a_starv_limit = 64,
+      ThreadConfig const&            a_thr_cfg     =
+                                     ThreadConfig{ThreadAffinityE::None,{},0}
+    )
+    : m_workers   (),
+      m_func      (&a_func),
+      m_thrCfg    (a_thr_cfg),
+      m_topo      (CPUTopology::Detect()),
+      m_cpuOrder  (),
+      m_lanes     (a_lanes, a_policy, a_starv_limit,   // Initially empty
+                   m_topo.NNodes() + 1),
+      m_mutex     (PTHREAD_MUTEX_INITIALIZER),
+      m_cvs       (m_topo.NNodes() + 1),
+      m_nodeIdle  (m_topo.NNodes() + 1, 0),
+      m_nodeWoken (m_topo.NNodes() + 1, 0),
+      m_nextCV    (0),
+      m_minThreads(a_pool_sz),
+      m_maxThreads(a_pool_sz),                         // Until "SetElastic"
+      m_nActive   (0),
+      m_nIdle     (0),
+      m_elastic   {a_pool_sz, 0, 0, 0},
+      m_hasMonitor(false),
+      m_monitor   (),
+      m_stopping  (false),
+      m_nGrown    (0),
+      m_nShrunk   (0),
+      m_stats     ()
     {
-      // Create the Threads, handles will be stored in each "pt" via a Ref:
-      for (pthread_t& pt: m_threads)
+      // CPUs for the Worker slots, according to the Affinity Policy:
+      switch (m_thrCfg.m_affinity)
       {
-        // No specific attrs, "this" ptr is the arg for ThreadBody:
-        // ThreadPool* is auto-converted to void*:
-        int rc  = pthread_create(&pt, nullptr, ThreadBodyS, this);
-        if (rc != 0)
-          throw std::runtime_error("ThreadPool::Ctor: Thread creation failed");
+        case ThreadAffinityE::Compact:  m_cpuOrder = m_topo.CompactOrder();
+                                        break;
+        case ThreadAffinityE::Scatter:  m_cpuOrder = m_topo.ScatterOrder();
+                                        break;
+        case ThreadAffinityE::Explicit: m_cpuOrder = m_thrCfg.m_cpus;
+                                        break;
+        default: ;
+      }
+      if (m_thrCfg.m_affinity != ThreadAffinityE::None && m_cpuOrder.empty())
+        throw std::invalid_argument("ThreadPool::Ctor: No CPUs to pin to");
+
+      // All CondVars use the monotonic clock for timed waits:
+      pthread_condattr_t ca;
+      pthread_condattr_init    (&ca);
+      pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+      for (pthread_cond_t& cv: m_cvs)
+        pthread_cond_init      (&cv,      &ca);
+      pthread_cond_init        (&m_monCV, &ca);
+      pthread_condattr_destroy (&ca);
+
+      // Create the Threads. They start immediately upon creation, and access
+      // the Pool state under the Mutex, so lock it as well:
+      (void) pthread_mutex_lock(&m_mutex);
+      try
+      {
+        for (size_t i = 0; i < a_pool_sz; ++i)
+          SpawnWorker();
+      }
+      catch (...)
+      {
+        (void) pthread_mutex_unlock(&m_mutex);
+        throw;
       }
-      // Threads start immediately upon creation
+      (void) pthread_mutex_unlock(&m_mutex);
     }
 
     // Deault Ctor is deleted:
@@ -113,73 +474,341 @@ namespace SiriusFMTM
     //------------------------------------------------------------------------//
     ~ThreadPool()
     {
-      // Cancel all Threads:
-      for (pthread_t pt: m_threads)
+      // Prevent Threads from retiring concurrently, so that the handles of
+      // all active ones remain valid:
+      (void) pthread_mutex_lock(&m_mutex);
+      m_stopping = true;
+      std::vector<pthread_t> ths;
+      for (std::unique_ptr<Worker> const& w: m_workers)
+        if (w->m_active)
+          ths.push_back(w->m_th);
+      if (m_hasMonitor)
+        ths.push_back(m_monitor);
+      (void) pthread_mutex_unlock(&m_mutex);
+
+      // Cancel all Threads, and wait until they are gone, so that none of
+      // them can touch this object (eg re-lock "m_mutex" on leaving a CondVar
+      // wait) after it is destroyed:
+      for (pthread_t pt: ths)
         (void) pthread_cancel(pt);
+      for (pthread_t pt: ths)
+        (void) pthread_join(pt, nullptr);
+    }
+
+    //------------------------------------------------------------------------//
+    // "SetElastic": Allow the Pool to grow up to "m_maxThreads":             //
+    //------------------------------------------------------------------------//
+    // The Pool grows (by 1 Thread at a time) when there are no idle Threads
+    // and either the oldest queued job has waited for more than "GrowWait",
+    // or some Worker has been busy with its curr job for more than "Blocked"
+    // (typically blocked in a syscall). Threads above the minimum which stay
+    // idle for "IdleTimeout" are retired:
+    //
+    void SetElastic(ElasticConfig const& a_cfg)
+    {
+      if (a_cfg.m_maxThreads < m_minThreads || a_cfg.m_growWaitUSec  <= 0 ||
+          a_cfg.m_blockedUSec <= 0          || a_cfg.m_idleTimeoutMSec <= 0)
+        throw std::invalid_argument("ThreadPool::SetElastic: Invalid Config");
+
+      // CRITICAL SECTION BEGIN =============================================//
+      int rc  = pthread_mutex_lock(&m_mutex);
+      if (rc != 0)
+        throw std::runtime_error("ThreadPool::SetElastic: Mutex lock failed");
+
+      m_elastic    = a_cfg;
+      m_maxThreads = a_cfg.m_maxThreads;
+      if (!m_hasMonitor)
+      {
+        rc = pthread_create(&m_monitor, nullptr, MonitorBodyS, this);
+        m_hasMonitor = (rc == 0);
+      }
+      // Idle Threads may need to switch to timed waits now:
+      for (size_t c = 0; c < m_cvs.size(); ++c)
+      {
+        pthread_cond_broadcast(&m_cvs[c]);
+        m_nodeWoken[c] = m_nodeIdle[c];
+      }
+      pthread_cond_signal   (&m_monCV);
+
+      (void) pthread_mutex_unlock(&m_mutex);
+      // CRITICAL SECTION END ===============================================//
+
+      if (rc != 0)
+        throw std::runtime_error
+          ("ThreadPool::SetElastic: Monitor creation failed");
+    }
+
+    //------------------------------------------------------------------------//
+    // "GetStats": Instrumentation Snapshot (empty if "Stats" is "NoStats"):  //
+    //------------------------------------------------------------------------//
+    // The Worker times include the curr job or wait for jobs (otherwise, a
+    // long one would only show up once it is over):
+    //
+    typename Stats::Snapshot GetStats() const
+    {
+      if constexpr(Stats::Enabled)
+      {
+        typename Stats::Snapshot res = m_stats.Get();
+        (void) pthread_mutex_lock(&m_mutex);
+        uint64_t now = NowNS();
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+          Worker const* w = m_workers[i].get();
+          res.m_workers.push_back(Stats::Get
+            (i, w->m_stats,
+             (w->m_idleSinceNS == 0) ? 0 : (now - w->m_idleSinceNS),
+             (w->m_busySinceNS == 0) ? 0 : (now - w->m_busySinceNS)));
+        }
+        (void) pthread_mutex_unlock(&m_mutex);
+        return res;
+      }
+      else
+        return typename Stats::Snapshot();
+    }
+
+    //------------------------------------------------------------------------//
+    // "GetSizeCounters":                                                     //
+    //------------------------------------------------------------------------//
+    SizeCounters GetSizeCounters() const
+    {
+      (void) pthread_mutex_lock(&m_mutex);
+      SizeCounters res { m_nActive, m_nIdle, m_nGrown, m_nShrunk };
+      (void) pthread_mutex_unlock(&m_mutex);
+      return res;
     }
 
   private:
+    //------------------------------------------------------------------------//
+    // "NowNS": Monotonic Time in nsec:                                       //
+    //------------------------------------------------------------------------//
+    static uint64_t NowNS()
+    {
+      timespec ts;
+      (void) clock_gettime(CLOCK_MONOTONIC, &ts);
+      return uint64_t(ts.tv_sec) * 1'000'000'000UL + uint64_t(ts.tv_nsec);
+    }
+
+    //------------------------------------------------------------------------//
+    // "Timed": Are the Job and Worker Timestamps needed?                     //
+    //------------------------------------------------------------------------//
+    // Only by the Stats and the Elastic Monitor; otherwise, the clock is not
+    // read at all, and they are 0. Mutex must be locked:
+    //
+    bool Timed() const { return Stats::Enabled || m_hasMonitor; }
+
+    static timespec ToTimeSpec(uint64_t a_ns)
+    {
+      return timespec { time_t(a_ns / 1'000'000'000UL),
+                        long  (a_ns % 1'000'000'000UL) };
+    }
+
+    //------------------------------------------------------------------------//
+    // "SpawnWorker": Start a new Thread in a free (or new) Worker slot:      //
+    //------------------------------------------------------------------------//
+    // Must be called with the Mutex locked. Refuses to spawn once the Dtor
+    // has started (the new Thread would not be cancelled and joined by it):
+    //
+    void SpawnWorker()
+    {
+      if (m_stopping)
+        throw std::runtime_error("ThreadPool::SpawnWorker: Pool is stopping");
+
+      Worker* w   = nullptr;
+      size_t  idx = 0;
+      for (; idx < m_workers.size(); ++idx)
+        if (!m_workers[idx]->m_active)
+        {
+          w = m_workers[idx].get();
+          break;
+        }
+      if (w == nullptr)
+      {
+        // The CPU and NUMA Node of a slot are fixed:
+        int cpu  = m_cpuOrder.empty()
+                   ? (-1) : m_cpuOrder[idx % m_cpuOrder.size()];
+        int node = (cpu < 0) ? (-1) : m_topo.NodeOfCPU(cpu);
+        m_workers.emplace_back
+          (new Worker{this, pthread_t(), false, 0, 0, cpu, node, {}});
+        w = m_workers.back().get();
+      }
+      // Initialise the slot BEFORE the Thread starts using it:
+      w->m_active      = true;
+      w->m_busySinceNS = 0;
+      w->m_idleSinceNS = 0;
+
+      // Thread attrs: Stack Size and CPU Affinity (if specified):
+      pthread_attr_t attr;
+      (void) pthread_attr_init(&attr);
+      int rc = 0;
+      if (m_thrCfg.m_stackSize != 0)
+        rc = pthread_attr_setstacksize(&attr, m_thrCfg.m_stackSize);
+      if (rc == 0 && w->m_cpu >= 0)
+      {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET (w->m_cpu, &cpus);
+        rc = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+      }
+      // The Worker ptr is the arg for ThreadBody:
+      // Worker* is auto-converted to void*:
+      if (rc == 0)
+        rc = pthread_create(&(w->m_th), &attr, ThreadBodyS, w);
+      (void) pthread_attr_destroy(&attr);
+      if (rc != 0)
+      {
+        w->m_active = false;
+        throw std::runtime_error("ThreadPool: Thread creation failed");
+      }
+      ++m_nActive;
+    }
+
+    //------------------------------------------------------------------------//
+    // "UnlockS": Cancellation Cleanup Handler:                               //
+    //------------------------------------------------------------------------//
+    static void UnlockS(void* a_mutex)
+      { (void) pthread_mutex_unlock(static_cast<pthread_mutex_t*>(a_mutex)); }
+
     //------------------------------------------------------------------------//
     // "ThreadBodyS":                                                         //
     //------------------------------------------------------------------------//
     // Must be compatible with C type (void*)->(void*), hence "static":
     // This is only a bridge function:
     //
-    static void* ThreadBodyS(void* a_this)
+    static void* ThreadBodyS(void* a_worker)
     {
       // Will catch all exceptions:
       try
       {
-        // "a_this" is actually a ptr to an obj of the "ThreadPool" class:
-        // void* must be explicitly converted back to ThreadPool*:
-        ThreadPool* obj = reinterpret_cast<ThreadPool*>(a_this);
+        // "a_worker" is actually a ptr to a "Worker" slot of a "ThreadPool":
+        // void* must be explicitly converted back to Worker*:
+        Worker* w = reinterpret_cast<Worker*>(a_worker);
 
         // Invoke the actual ThreadBody as a member function:
-        assert(obj != nullptr);
-        obj->ThreadBody();   // Runs in an infinite loop
+        assert(w != nullptr && w->m_pool != nullptr);
+        w->m_pool->ThreadBody(w);   // Runs until the Thread is retired
       }
       catch (std::exception const& exn)
         { std::cerr << "EXCEPTION: " << exn.what() << std::endl;}
 
-      // We only get here if there was an exception:
+      // We only get here if there was an exception or the Thread retired:
       return nullptr;
     }
 
     //------------------------------------------------------------------------//
     // "ThreadBody": Actual ThreadBody as a member function of this class:    //
     //------------------------------------------------------------------------//
-    void ThreadBody()
+    void ThreadBody(Worker* a_w)
     {
-      // Run in an infinite loop:
+      uint64_t doneNS = 0;  // End of the prev job (only with Stats)
+      uint64_t freeNS = 0;  // End of its continuation, if any (ditto)
+
+      // Run in an infinite loop (unless retired by the Idle Timeout):
       while (true)
       {
         // Obtain the next WorkItem and ResPtr from the Buff:
-        // Lock the Mutex to access the Buff shared between Threads:
+        // Lock the Mutex to access the Buff shared between Threads. With
+        // Stats, the wait for it starts at the end of the prev job, or of
+        // its continuation (which saves a clock read per job):
+        uint64_t lockStartNS = 0;
+        if constexpr(Stats::Enabled)
+          lockStartNS = (freeNS != 0) ? freeNS : NowNS();
+
         int rc  = pthread_mutex_lock(&m_mutex);
         if (rc != 0)
           throw std::runtime_error("ThreadPool::ThreadBody: Mutex lock failed");
 
         // CRITICAL SECTION BEGIN ===========================================//
-        while (m_buff.empty())
+        // The prev job (if any) is done, we are idle now:
+        if constexpr(Stats::Enabled)
+          if (a_w->m_busySinceNS != 0)
+            a_w->m_stats.OnBusy(doneNS - a_w->m_busySinceNS);
+        a_w->m_busySinceNS = 0;
+        ++m_nIdle;
+        size_t          cvIdx = size_t(a_w->m_node + 1);
+        pthread_cond_t* cv    = &m_cvs[cvIdx];
+        ++m_nodeIdle[cvIdx];
+        uint64_t idleStartNS  = Timed() ? NowNS() : 0;
+        a_w->m_idleSinceNS    = idleStartNS;
+
+        // The waits below are Cancellation Points (see the Dtor); if this
+        // Thread is cancelled there, the Mutex (re-locked by the wait) must
+        // be released:
+        bool retire = false;
+        pthread_cleanup_push(UnlockS, &m_mutex);
+        while (m_lanes.empty())
         {
-          // Will have to wait for a new job to be "Submit"ted:
-          rc = pthread_cond_wait(&m_cv, &m_mutex);
-          assert(rc == 0);
+          // Will have to wait for a new job to be "Submit"ted. Threads above
+          // the minimum only wait until the Idle Timeout, then retire:
+          if (m_nActive > m_minThreads && !m_stopping)
+          {
+            // (If the Pool has become Elastic during this wait, the Idle
+            // Timeout starts now):
+            if (idleStartNS == 0)
+              idleStartNS = a_w->m_idleSinceNS = NowNS();
+            timespec dl = ToTimeSpec
+              (idleStartNS +
+               uint64_t(m_elastic.m_idleTimeoutMSec) * 1'000'000UL);
+            rc = pthread_cond_timedwait(cv, &m_mutex, &dl);
+            assert(rc == 0 || rc == ETIMEDOUT);
+
+            if (rc == ETIMEDOUT && m_lanes.empty() &&
+                m_nActive > m_minThreads && !m_stopping)
+            {
+              retire = true;
+              break;
+            }
+          }
+          else
+          {
+            rc = pthread_cond_wait(cv, &m_mutex);
+            assert(rc == 0);
+          }
 
           // If we got here, the "Submit"ter has called "pthread_cond_signal"
           // and THIS thread has been waken up. But this does NOT guarantee
           // that the Buff is non-empty now, so need to re-check in the inner
           // loop. IMPORTANT: The Mutex is automatically locked again, so the
-          // check is safe!
+          // check is safe! This Thread has consumed a signal (if any), so it
+          // can be selected by "SelectCV" again if it goes back to waiting:
+          if (m_nodeWoken[cvIdx] > 0)
+            --m_nodeWoken[cvIdx];
+        }
+        pthread_cleanup_pop(0);
+
+        if (retire)
+        {
+          a_w->m_active      = false;
+          a_w->m_idleSinceNS = 0;
+          --m_nActive;
+          --m_nIdle;
+          --m_nodeIdle[cvIdx];
+          // A signal counted for this Thread by "SelectCV" (but which came
+          // too late) is not pending any more; otherwise "SelectCV" would
+          // skip the remaining idle Workers of this Node:
+          if (m_nodeWoken[cvIdx] > m_nodeIdle[cvIdx])
+            m_nodeWoken[cvIdx] = m_nodeIdle[cvIdx];
+          ++m_nShrunk;
+          // Nobody is going to join this Thread:
+          (void) pthread_detach(pthread_self());
+          (void) pthread_mutex_unlock(&m_mutex);
+          return;
         }
         // If we got here, the Mutex is locked and the Buff is non-empty:
-        // Get the front job from the Buff: {WorkItem, ResPtr}:
-#       ifdef USE_BOOST
-        JobDescr job = m_buff.front();
-        m_buff.pop_front();
-#       else
-        JobDescr job = m_buff.PopFront();
-#       endif
+        // Get the front job of the lane selected by the SchedPolicy (over
+        // all Queues), from this Worker's NUMA Node Queue if possible:
+        JobDescr job = m_lanes.Pop(cvIdx);
+        --m_nIdle;
+        --m_nodeIdle[cvIdx];
+        uint64_t deqNS     = Timed() ? NowNS() : 0;
+        a_w->m_busySinceNS = deqNS;
+        a_w->m_idleSinceNS = 0;
+        if constexpr(Stats::Enabled)
+          a_w->m_stats.OnIdle(idleStartNS - lockStartNS, deqNS - idleStartNS);
+
+        // If we were the last idle Thread but more jobs are queued, the
+        // Elastic Monitor may need to grow the Pool:
+        if (!m_lanes.empty() && m_nIdle == 0 && m_hasMonitor)
+          pthread_cond_signal(&m_monCV);
 
         // And only now unlick the Mutex:
         rc = pthread_mutex_unlock(&m_mutex);
@@ -189,79 +818,393 @@ namespace SiriusFMTM
         // CRITICAL SECTION END =============================================//
 
         // We have now got the WorkItem, process it via the actual "Func":
-        // For syntactic correctness in all cases, need this "constexpr if":
-        // Catch exceptions locally to prevent exit from the main loop:
-        try
+        // For syntactic correctness in all cases, need this "constexpr if".
+        // Exceptions are caught to prevent exit from the main loop:
+        bool ok = RunGuarded([this, &job]()
         {
           if (job.m_status != nullptr)
             *job.m_status = JobStatusE::InProcessing;
 
+          if (job.m_resumeOnly)             // A "Schedule"d Coroutine
+            job.m_cont.resume();
+          else
           if constexpr(std::is_void_v<Res>) // Res is void
           {
             assert(job.m_res == nullptr);   // No value to return
-            (*m_func)(job.m_wi);
+            (*m_func)(std::move(job.m_wi));
           }
           else                              // Res is NOT void
           {
-            Res res = (*m_func)(job.m_wi);
+            Res res = (*m_func)(std::move(job.m_wi));
             // Save the res vis the Submitter-specified ptr (if not NULL):
             if (job.m_res != nullptr)
-              *job.m_res = res;
+              *job.m_res = std::move(res);
           }
-          if (job.m_status != nullptr)
-            *job.m_status = JobStatusE::Completed;
+        });
+        if (job.m_status != nullptr)
+          *job.m_status = ok ? JobStatusE::Completed : JobStatusE::Failed;
+
+        // The service time does not include the continuation below:
+        if constexpr(Stats::Enabled)
+        {
+          doneNS = NowNS();
+          freeNS = doneNS;
+          m_stats.OnJob(deqNS - job.m_enqNS, doneNS - deqNS);
         }
-        catch(...)
+        // The Coroutine which "co_await"ed this job (if any) continues on
+        // this Thread. It has to check the job status itself; as the status
+        // is in its frame (which may be gone once it has been resumed), an
+        // exception escaping from it is dropped, without changing it:
+        if (!job.m_resumeOnly && job.m_cont)
         {
-          // Mark the job as Failed:
-          if (job.m_status != nullptr)
-            *job.m_status = JobStatusE::Failed;
+          (void) RunGuarded([&job]() { job.m_cont.resume(); });
+          if constexpr(Stats::Enabled)
+            freeNS = NowNS();
         }
       }
       __builtin_unreachable();
     }
 
-  public:
     //------------------------------------------------------------------------//
-    // "Submit": Used by Clients to submit a Job={WorkItem,ResPtr}:           //
+    // "RunGuarded": Run a Job or a Coroutine on a Worker Thread:             //
     //------------------------------------------------------------------------//
-    // Returns "true" iff submission successful (i.e. the Buff was not full):
+    // Returns "false" if "a_f" has thrown. All exceptions are caught, except
+    // for the Cancellation (see the Dtor), which must not be swallowed:
     //
-    bool Submit
+    template<typename F>
+    static bool RunGuarded(F const& a_f)
+    {
+      try
+      {
+        a_f();
+        return true;
+      }
+      catch (abi::__forced_unwind const&)
+        { throw; }
+      catch (...)
+        { return false; }
+    }
+
+    //------------------------------------------------------------------------//
+    // "SelectCV": Which Workers to wake up for a job in Queue "a_q":         //
+    //------------------------------------------------------------------------//
+    // Prefers idle Workers on the job's NUMA Node (if any), otherwise any idle
+    // Workers (round-robin). Workers which have already been signalled, but
+    // have not woken up yet, do not count: otherwise, 2 quick Submits could
+    // signal the same single waiter, and the 2nd signal would be lost while
+    // Workers on other CVs stay asleep. Returns nullptr if nobody is idle.
+    // Mutex must be locked:
+    //
+    pthread_cond_t* SelectCV(size_t a_q)
+    {
+      size_t c = m_cvs.size();
+      if (a_q != 0 && m_nodeIdle[a_q] > m_nodeWoken[a_q])
+        c = a_q;
+      for (size_t i = 0; c == m_cvs.size() && i < m_cvs.size(); ++i)
+      {
+        size_t r = (m_nextCV + i) % m_cvs.size();
+        if (m_nodeIdle[r] > m_nodeWoken[r])
+        {
+          c        = r;
+          m_nextCV = r + 1;
+        }
+      }
+      if (c == m_cvs.size())
+        return nullptr;
+      ++m_nodeWoken[c];
+      return &m_cvs[c];
+    }
+
+    //------------------------------------------------------------------------//
+    // "MonitorBodyS", "MonitorBody": The Elastic Monitor Thread:             //
+    //------------------------------------------------------------------------//
+    static void* MonitorBodyS(void* a_this)
+    {
+      try
+      {
+        ThreadPool* obj = reinterpret_cast<ThreadPool*>(a_this);
+        assert(obj != nullptr);
+        obj->MonitorBody();   // Runs until the Dtor is called
+      }
+      catch (std::exception const& exn)
+        { std::cerr << "EXCEPTION: " << exn.what() << std::endl;}
+      return nullptr;
+    }
+
+    void MonitorBody()
+    {
+      int rc  = pthread_mutex_lock(&m_mutex);
+      if (rc != 0)
+        throw std::runtime_error("ThreadPool::MonitorBody: Mutex lock failed");
+
+      // Runs with the Mutex locked, except while waiting on "m_monCV"; it is
+      // released if cancelled there (see the Dtor). Once the Dtor has started,
+      // no more Threads may be spawned, so exit (and the Dtor joins us):
+      pthread_cleanup_push(UnlockS, &m_mutex);
+      while (!m_stopping)
+      {
+        // Nothing to do while there are idle Threads or no queued jobs; in
+        // that case, "Submit" will wake us up when it matters:
+        if (m_lanes.empty() || m_nIdle > 0 || m_nActive >= m_maxThreads)
+        {
+          rc = pthread_cond_wait(&m_monCV, &m_mutex);
+          assert(rc == 0);
+          continue;
+        }
+        uint64_t now       = NowNS();
+        uint64_t growWait  = uint64_t(m_elastic.m_growWaitUSec) * 1000UL;
+        uint64_t blocked   = uint64_t(m_elastic.m_blockedUSec)  * 1000UL;
+
+        bool grow = (now - m_lanes.OldestEnqNS() >= growWait);
+        for (size_t i = 0; !grow && i < m_workers.size(); ++i)
+        {
+          Worker const* w = m_workers[i].get();
+          grow = w->m_active && w->m_busySinceNS != 0 &&
+                 now - w->m_busySinceNS >= blocked;
+        }
+        if (grow)
+        {
+          try
+          {
+            SpawnWorker();
+            ++m_nGrown;
+          }
+          catch (std::exception const& exn)
+            { std::cerr << "EXCEPTION: " << exn.what() << std::endl; }
+        }
+        // Re-check after a short while (which also lets a new Thread start):
+        uint64_t tick = std::min(growWait, blocked) / 2 + 1;
+        timespec dl   = ToTimeSpec(now + tick);
+        rc = pthread_cond_timedwait(&m_monCV, &m_mutex, &dl);
+        assert(rc == 0 || rc == ETIMEDOUT);
+      }
+      // Unlock the Mutex:
+      pthread_cleanup_pop(1);
+    }
+
+    //------------------------------------------------------------------------//
+    // "SubmitJob": Common Impl of "Submit" and the Coroutine Awaiters:       //
+    //------------------------------------------------------------------------//
+    // "a_node" is the NUMA Node hint, (-1) if none. The JobDescr is only
+    // made (and "a_wi" moved from, if an rvalue) once the job is known to
+    // fit in its lane, so a move-only "WorkItem" survives a failed submit,
+    // and the caller can retry with it:
+    //
+    template<typename WI>
+    bool SubmitJob
     (
-      WorkItem    a_wi,
-      Res*        a_res    = nullptr,
-      JobStatusE* a_status = nullptr
+      size_t                  a_lane,
+      int                     a_node,
+      WI&&                    a_wi,
+      Res*                    a_res,
+      JobStatusE*             a_status,
+      std::coroutine_handle<> a_cont        = nullptr,
+      bool                    a_resume_only = false
     )
     {
+      if (a_lane >= m_lanes.NLanes())
+        throw std::invalid_argument("ThreadPool::Submit: Invalid lane");
+      // Invalid NUMA hints are ignored:
+      size_t q = (a_node >= 0 && size_t(a_node) < m_topo.NNodes())
+                 ? size_t(a_node + 1) : 0;
+      // With Stats, the clock is read outside the critical section:
+      uint64_t enqNS = 0;
+      if constexpr(Stats::Enabled)
+        enqNS = NowNS();
+
       // CRITICAL SECTION BEGIN =============================================//
       int rc  = pthread_mutex_lock(&m_mutex);
       if (rc != 0)
         throw std::runtime_error("ThreadPool::Sunmit: Mutex lock failed");
 
-      // Now check if there is space left in the Buff:
-      if (m_buff.full())
+      // Set the status BEFORE the job becomes visible to the Workers, so it
+      // cannot overwrite the "InProcessing" or "Completed" status:
+      if (a_status != nullptr)
+        *a_status = JobStatusE::Queued;
+
+      // Do submit (at the back of the lane's circular queue), unless there is
+      // no space left in that lane:
+      bool ok = !m_lanes.Full(a_lane);
+      if (ok)
       {
-        rc = pthread_mutex_unlock(&m_mutex);
-        assert(rc == 0);
-        // No space!
-        if (a_status != nullptr)
-          *a_status = JobStatusE::Failed;
-        return false;
+        JobDescr job(std::forward<WI>(a_wi), a_res, a_status, a_cont,
+                     a_resume_only);
+        job.m_enqNS = (enqNS == 0 && m_hasMonitor) ? NowNS() : enqNS;
+        m_lanes.Push(a_lane, q, std::move(job));
       }
-      // Do submit (at the back of the circular queue) and unlock the mutex:
-      m_buff.push_back(JobDescr(a_wi, a_res, a_status));
+      else
+      if (a_status != nullptr)
+        *a_status = JobStatusE::Failed;
+      m_stats.OnSubmit(ok, m_lanes.size());
+
+      pthread_cond_t* cv = ok ? SelectCV(q) : nullptr;
+
+      // If no Thread is idle, the Elastic Monitor may need to grow the Pool:
+      if (ok && m_nIdle == 0 && m_hasMonitor)
+        pthread_cond_signal(&m_monCV);
+
       rc = pthread_mutex_unlock(&m_mutex);
+      assert(rc == 0);
       // CRITICAL SECTION END ===============================================//
 
+      if (!ok)
+        return false;  // No space!
+
       // Only after unlocking, signal the new condition to the thread(s)
       // (otherwise, subsequent mutex lock in pthread_cond_wait() would fail):
-      if (a_status != nullptr)
-        *a_status = JobStatusE::Queued;
-      pthread_cond_signal(&m_cv);
+      if (cv != nullptr)
+        pthread_cond_signal(cv);
 
       // Success!
       return true;
     }
+
+  public:
+    //------------------------------------------------------------------------//
+    // "Submit": Used by Clients to submit a Job={WorkItem,ResPtr}:           //
+    //------------------------------------------------------------------------//
+    // Returns "true" iff submission successful (i.e. the Lane was not full).
+    // An rvalue "a_wi" is only moved from on success:
+    //
+    bool Submit
+    (
+      WorkItem const& a_wi,
+      Res*            a_res    = nullptr,
+      JobStatusE*     a_status = nullptr,
+      size_t          a_lane   = 0        // Priority Lane, 0 is the highest
+    )
+    {
+      return SubmitJob(a_lane, -1, a_wi, a_res, a_status);
+    }
+
+    bool Submit
+    (
+      WorkItem&&      a_wi,
+      Res*            a_res    = nullptr,
+      JobStatusE*     a_status = nullptr,
+      size_t          a_lane   = 0
+    )
+    {
+      return SubmitJob(a_lane, -1, std::move(a_wi), a_res, a_status);
+    }
+
+    //------------------------------------------------------------------------//
+    // "SubmitOnNode": Same as "Submit", with a NUMA Node hint:               //
+    //------------------------------------------------------------------------//
+    // The job is preferably run by a Worker pinned to a CPU on that Node
+    // (see "ThreadConfig"), eg because its data were first-touched there:
+    //
+    bool SubmitOnNode
+    (
+      int             a_node,
+      WorkItem const& a_wi,
+      Res*            a_res    = nullptr,
+      JobStatusE*     a_status = nullptr,
+      size_t          a_lane   = 0
+    )
+    {
+      return SubmitJob(a_lane, a_node, a_wi, a_res, a_status);
+    }
+
+    bool SubmitOnNode
+    (
+      int             a_node,
+      WorkItem&&      a_wi,
+      Res*            a_res    = nullptr,
+      JobStatusE*     a_status = nullptr,
+      size_t          a_lane   = 0
+    )
+    {
+      return SubmitJob(a_lane, a_node, std::move(a_wi), a_res, a_status);
+    }
+
+    //------------------------------------------------------------------------//
+    // "Topology": NUMA Nodes and CPUs as seen by the Pool:                   //
+    //------------------------------------------------------------------------//
+    CPUTopology const& Topology() const { return m_topo; }
+
+    //------------------------------------------------------------------------//
+    // Coroutine Support: "co_await pool.Schedule()":                         //
+    //------------------------------------------------------------------------//
+    // Suspends the calling Coroutine and resumes it on a Worker Thread. If the
+    // Lane is full, the Coroutine just continues on the curr Thread. Requires
+    // a default-constructible "WorkItem" (a dummy one is queued):
+    //
+    class ScheduleAwaiter
+    {
+    private:
+      ThreadPool* m_pool;
+      size_t      m_lane;
+
+    public:
+      ScheduleAwaiter(ThreadPool* a_pool, size_t a_lane)
+      : m_pool(a_pool),
+        m_lane(a_lane)
+      {}
+
+      bool await_ready() const noexcept { return false; }
+
+      bool await_suspend(std::coroutine_handle<> a_h)
+        { return m_pool->SubmitJob
+                 (m_lane, -1, WorkItem(), nullptr, nullptr, a_h, true); }
+
+      void await_resume() const noexcept {}
+    };
+
+    ScheduleAwaiter Schedule(size_t a_lane = 0)
+      { return ScheduleAwaiter(this, a_lane); }
+
+    //------------------------------------------------------------------------//
+    // Coroutine Support: "Res res = co_await pool.Async(wi)":                //
+    //------------------------------------------------------------------------//
+    // Runs "Func(wi)" on a Worker Thread, which then resumes the calling
+    // Coroutine directly (no Thread is blocked waiting for the res). Throws
+    // "std::runtime_error" from "co_await" if the Lane was full or "Func"
+    // has failed:
+    //
+    class JobAwaiter
+    {
+    private:
+      using ResStore = std::conditional_t<std::is_void_v<Res>, char, Res>;
+
+      ThreadPool* m_pool;
+      size_t      m_lane;
+      WorkItem    m_wi;
+      ResStore    m_res;
+      JobStatusE  m_status;
+
+    public:
+      JobAwaiter(ThreadPool* a_pool, WorkItem a_wi, size_t a_lane)
+      : m_pool  (a_pool),
+        m_lane  (a_lane),
+        m_wi    (std::move(a_wi)),
+        m_res   (),
+        m_status(JobStatusE::UNDEFINED)
+      {}
+
+      bool await_ready() const noexcept { return false; }
+
+      // Returns "false" (ie do not suspend) if the submission failed:
+      bool await_suspend(std::coroutine_handle<> a_h)
+      {
+        Res* res = nullptr;
+        if constexpr(!std::is_void_v<Res>)
+          res = &m_res;
+        return m_pool->SubmitJob
+               (m_lane, -1, std::move(m_wi), res, &m_status, a_h);
+      }
+
+      Res await_resume()
+      {
+        if (m_status != JobStatusE::Completed)
+          throw std::runtime_error
+            ("ThreadPool::Async: Job submission or processing failed");
+        if constexpr(!std::is_void_v<Res>)
+          return m_res;
+      }
+    };
+
+    JobAwaiter Async(WorkItem a_wi, size_t a_lane = 0)
+      { return JobAwaiter(this, std::move(a_wi), a_lane); }
   };
 }
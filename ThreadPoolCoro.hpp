@@ -0,0 +1,326 @@
+// vim:ts=2:et
+//============================================================================//
+//                            "ThreadPoolCoro.hpp":                           //
+//             C++20 Coroutine Tasks to be run on the Generic Thread Pool     //
+//============================================================================//
+// "Task<T>":   A lazily-started Coroutine returning T. Awaiting a Task starts
+//              it; when it finishes, the awaiter is resumed via symmetric
+//              transfer (no stack growth, no extra Thread hops);
+// "WhenAll":   Runs several Tasks concurrently, resumes the awaiter (on the
+//              Thread which completed the last one) with all their results;
+// "SyncWait":  Bridge from ordinary code: blocks the calling (non-Pool!)
+//              Thread until the Task completes.
+// Combined with "ThreadPool::Schedule" and "ThreadPool::Async", a Task can
+// hop onto the Pool and await jobs without blocking any Worker Thread:
+//
+#pragma once
+#include <pthread.h>
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  template<typename T> class Task;
+
+  namespace Detail
+  {
+    //========================================================================//
+    // "TaskPromiseBase": Continuation and Exception Handling:                //
+    //========================================================================//
+    class TaskPromiseBase
+    {
+    private:
+      //----------------------------------------------------------------------//
+      // "FinalAwaiter": Symmetric Transfer to the Continuation:              //
+      //----------------------------------------------------------------------//
+      struct FinalAwaiter
+      {
+        bool await_ready() const noexcept { return false; }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend
+          (std::coroutine_handle<Promise> a_h) noexcept
+        {
+          std::coroutine_handle<> cont = a_h.promise().m_cont;
+          return cont ? cont : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+      };
+
+    public:
+      std::coroutine_handle<> m_cont;     // Who awaits this Task
+      std::exception_ptr      m_exn;
+
+      std::suspend_always initial_suspend() const noexcept { return {}; }
+      FinalAwaiter        final_suspend  () const noexcept { return {}; }
+      void unhandled_exception() { m_exn = std::current_exception(); }
+    };
+
+    template<typename T>
+    class TaskPromise: public TaskPromiseBase
+    {
+    public:
+      std::optional<T> m_val;
+
+      Task<T> get_return_object();
+
+      template<typename U>
+      void return_value(U&& a_val) { m_val.emplace(std::forward<U>(a_val)); }
+
+      T Result()
+      {
+        if (m_exn)
+          std::rethrow_exception(m_exn);
+        assert(m_val.has_value());
+        return std::move(*m_val);
+      }
+    };
+
+    template<>
+    class TaskPromise<void>: public TaskPromiseBase
+    {
+    public:
+      Task<void> get_return_object();
+
+      void return_void() {}
+
+      void Result()
+      {
+        if (m_exn)
+          std::rethrow_exception(m_exn);
+      }
+    };
+
+    //========================================================================//
+    // "Detached": Eagerly-started, self-destroying Coroutine:                //
+    //========================================================================//
+    // Used internally to drive Tasks from "WhenAll" and "SyncWait":
+    //
+    struct Detached
+    {
+      struct promise_type
+      {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend  () const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+      };
+    };
+  } // End namespace Detail
+
+  //==========================================================================//
+  // "Task":                                                                  //
+  //==========================================================================//
+  template<typename T>
+  class Task
+  {
+  public:
+    using promise_type = Detail::TaskPromise<T>;
+    using Handle       = std::coroutine_handle<promise_type>;
+
+  private:
+    Handle m_h;
+
+  public:
+    explicit Task(Handle a_h): m_h(a_h) {}
+
+    Task(Task&& a_right) noexcept
+    : m_h(std::exchange(a_right.m_h, nullptr))
+    {}
+
+    Task(Task const&)            = delete;
+    Task& operator=(Task const&) = delete;
+    Task& operator=(Task&&)      = delete;
+
+    ~Task()
+    {
+      if (m_h)
+        m_h.destroy();
+    }
+
+    // Awaiting a Task starts it, with the awaiter as its continuation:
+    bool await_ready() const noexcept { return false; }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> a_cont)
+    {
+      m_h.promise().m_cont = a_cont;
+      return m_h;                     // Symmetric Transfer
+    }
+
+    T await_resume() { return m_h.promise().Result(); }
+  };
+
+  namespace Detail
+  {
+    template<typename T>
+    Task<T> TaskPromise<T>::get_return_object()
+      { return Task<T>(Task<T>::Handle::from_promise(*this)); }
+
+    inline Task<void> TaskPromise<void>::get_return_object()
+      { return Task<void>(Task<void>::Handle::from_promise(*this)); }
+
+    //========================================================================//
+    // "Latch": One-Shot Event for "SyncWait":                                //
+    //========================================================================//
+    class Latch
+    {
+    private:
+      pthread_mutex_t m_mutex;
+      pthread_cond_t  m_cv;
+      bool            m_done;
+
+    public:
+      Latch()
+      : m_mutex(PTHREAD_MUTEX_INITIALIZER),
+        m_cv   (PTHREAD_COND_INITIALIZER),
+        m_done (false)
+      {}
+
+      void Set()
+      {
+        (void) pthread_mutex_lock  (&m_mutex);
+        m_done = true;
+        (void) pthread_cond_signal (&m_cv);
+        (void) pthread_mutex_unlock(&m_mutex);
+      }
+
+      void Wait()
+      {
+        (void) pthread_mutex_lock  (&m_mutex);
+        while (!m_done)
+          (void) pthread_cond_wait (&m_cv, &m_mutex);
+        (void) pthread_mutex_unlock(&m_mutex);
+      }
+    };
+
+    // "Store" is "T", or "bool" if "T" is "void":
+    template<typename T, typename Store>
+    Detached RunAndSet(Task<T>& a_task, Latch& a_latch,
+                       std::optional<Store>& a_res, std::exception_ptr& a_exn)
+    {
+      try
+      {
+        if constexpr(std::is_void_v<T>)
+        {
+          co_await a_task;
+          a_res.emplace(true);
+        }
+        else
+          a_res.emplace(co_await a_task);
+      }
+      catch (...)
+        { a_exn = std::current_exception(); }
+      a_latch.Set();
+    }
+
+    //========================================================================//
+    // "WhenAllState": Shared by the Sub-Tasks of "WhenAll":                  //
+    //========================================================================//
+    template<typename T>
+    struct WhenAllState
+    {
+      std::atomic<size_t>           m_left;
+      std::vector<std::optional<T>> m_res;
+      std::exception_ptr            m_exn;    // The 1st one, if any
+      std::atomic<bool>             m_failed;
+      std::coroutine_handle<>       m_cont;
+
+      explicit WhenAllState(size_t a_n)
+      : m_left(a_n), m_res(a_n), m_exn(), m_failed(false), m_cont()
+      {}
+    };
+
+    template<typename T>
+    Detached RunOne(Task<T>& a_task, WhenAllState<T>& a_st, size_t a_i)
+    {
+      try
+        { a_st.m_res[a_i].emplace(co_await a_task); }
+      catch (...)
+      {
+        if (!a_st.m_failed.exchange(true))
+          a_st.m_exn = std::current_exception();
+      }
+      // The last one to complete resumes the awaiter:
+      if (a_st.m_left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        a_st.m_cont.resume();
+    }
+  } // End namespace Detail
+
+  //==========================================================================//
+  // "WhenAll": Run all Tasks concurrently, get the vector of their results:  //
+  //==========================================================================//
+  // The Tasks run concurrently only if they hop onto a Pool (eg via
+  // "co_await pool.Schedule()") at their beginning; otherwise they are started
+  // one after another on the curr Thread. If any of them fails, the exception
+  // of the 1st failed one is re-thrown after all have completed:
+  //
+  template<typename T>
+  Task<std::vector<T>> WhenAll(std::vector<Task<T>> a_tasks)
+  {
+    static_assert(!std::is_void_v<T>, "WhenAll: Use Task<bool> etc instead");
+    size_t const            n = a_tasks.size();
+    Detail::WhenAllState<T> st(n);
+
+    if (n != 0)
+    {
+      struct Awaiter
+      {
+        std::vector<Task<T>>&    m_tasks;
+        Detail::WhenAllState<T>& m_st;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> a_cont)
+        {
+          m_st.m_cont = a_cont;
+          // Once the last Task is started, this frame (incl "*this") may be
+          // resumed and destroyed by another Thread, so use locals only:
+          std::vector<Task<T>>&    tasks = m_tasks;
+          Detail::WhenAllState<T>& st    = m_st;
+          size_t const             nt    = tasks.size();
+          for (size_t i = 0; i < nt; ++i)
+            Detail::RunOne(tasks[i], st, i);
+        }
+        void await_resume() const noexcept {}
+      };
+      co_await Awaiter{a_tasks, st};
+    }
+    if (st.m_exn)
+      std::rethrow_exception(st.m_exn);
+
+    std::vector<T> res;
+    res.reserve(n);
+    for (std::optional<T>& r: st.m_res)
+      res.push_back(std::move(*r));
+    co_return res;
+  }
+
+  //==========================================================================//
+  // "SyncWait": Block the calling Thread until the Task completes:           //
+  //==========================================================================//
+  // Must NOT be called from a Pool Worker Thread (it would block the Worker):
+  //
+  template<typename T>
+  T SyncWait(Task<T> a_task)
+  {
+    Detail::Latch      latch;
+    std::exception_ptr exn;
+    using Store = std::conditional_t<std::is_void_v<T>, bool, T>;
+    std::optional<Store> res;
+
+    Detail::RunAndSet(a_task, latch, res, exn);
+    latch.Wait();
+
+    if (exn)
+      std::rethrow_exception(exn);
+    if constexpr(!std::is_void_v<T>)
+      return std::move(*res);
+  }
+} // End namespace SiriusFMTM
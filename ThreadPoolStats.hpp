@@ -0,0 +1,300 @@
+// vim:ts=2:et
+//============================================================================//
+//                           "ThreadPoolStats.hpp":                           //
+//              Instrumentation Policies for the Generic Thread Pool          //
+//============================================================================//
+// A "ThreadPool" is parameterised by a "Stats" policy:
+// "NoStats":   (default) all instrumentation is compiled out;
+// "PoolStats": per-Worker busy/idle/lock-wait times, queue-depth samples,
+//              submit rejections, queue-wait and service-time histograms.
+// Both policies provide the same types, so the Pool code is identical, and
+// the Stats calls are guarded by "if constexpr(Stats::Enabled)". With
+// "NoStats", the Pool only reads the clock if it is Elastic (its Monitor
+// needs the job and Worker timestamps):
+//
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace SiriusFMTM
+{
+  //==========================================================================//
+  // "NoStats": Zero-Cost Policy:                                             //
+  //==========================================================================//
+  struct NoStats
+  {
+    constexpr static bool Enabled = false;
+
+    struct WorkerStats {};
+
+    struct Snapshot
+    {
+      void ToJSON(std::ostream& a_os) const { a_os << "{}"; }
+    };
+
+    void OnSubmit(bool, size_t) {}
+  };
+
+  //==========================================================================//
+  // "LogHistogram": Lock-Free Histogram with Power-of-2 Buckets:             //
+  //==========================================================================//
+  // Bucket 0 holds the value 0, bucket "b" > 0 holds [2^(b-1), 2^b):
+  //
+  class LogHistogram
+  {
+  public:
+    constexpr static int NBuckets = 65;
+
+    //------------------------------------------------------------------------//
+    // "Snapshot": A (non-atomic) copy of the Histogram:                      //
+    //------------------------------------------------------------------------//
+    struct Snapshot
+    {
+      uint64_t m_count;
+      uint64_t m_sum;
+      uint64_t m_max;
+      uint64_t m_buckets[NBuckets];
+
+      double Mean() const
+        { return (m_count == 0) ? 0.0 : double(m_sum) / double(m_count); }
+
+      // Upper bound of the bucket containing the "a_p" quantile, 0 < a_p < 1:
+      uint64_t Quantile(double a_p) const
+      {
+        uint64_t target = uint64_t(a_p * double(m_count));
+        uint64_t acc    = 0;
+        for (int b = 0; b < NBuckets; ++b)
+        {
+          acc += m_buckets[b];
+          if (acc > target)
+            return (b == 0) ? 0 : std::min(m_max, (b == 64)
+                                  ? UINT64_MAX : (uint64_t(1) << b) - 1);
+        }
+        return m_max;
+      }
+
+      void ToJSON(std::ostream& a_os) const
+      {
+        a_os << "{\"count\":" << m_count << ",\"mean\":"  << Mean()
+             << ",\"p50\":"   << Quantile(0.50)
+             << ",\"p90\":"   << Quantile(0.90)
+             << ",\"p99\":"   << Quantile(0.99)
+             << ",\"max\":"   << m_max   << ",\"buckets\":[";
+        // Only non-empty buckets, as [UpperBound, Count] pairs:
+        bool first = true;
+        for (int b = 0; b < NBuckets; ++b)
+          if (m_buckets[b] != 0)
+          {
+            a_os << (first ? "" : ",") << '['
+                 << ((b == 0) ? 0 : (b == 64) ? UINT64_MAX
+                                  : (uint64_t(1) << b) - 1)
+                 << ',' << m_buckets[b] << ']';
+            first = false;
+          }
+        a_os << "]}";
+      }
+    };
+
+  private:
+    // The count is the sum of the buckets (1 atomic op less per "Add"):
+    std::atomic<uint64_t> m_buckets[NBuckets];
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+
+  public:
+    LogHistogram()
+    : m_buckets(),
+      m_sum    (0),
+      m_max    (0)
+    {
+      for (std::atomic<uint64_t>& b: m_buckets)
+        b.store(0, std::memory_order_relaxed);
+    }
+
+    void Add(uint64_t a_val)
+    {
+      int b = (a_val == 0) ? 0 : 64 - __builtin_clzll(a_val);
+      m_buckets[b].fetch_add(1,     std::memory_order_relaxed);
+      m_sum       .fetch_add(a_val, std::memory_order_relaxed);
+
+      uint64_t prev = m_max.load(std::memory_order_relaxed);
+      while (a_val > prev &&
+             !m_max.compare_exchange_weak(prev, a_val,
+                                          std::memory_order_relaxed)) ;
+    }
+
+    Snapshot Get() const
+    {
+      Snapshot res;
+      res.m_count = 0;
+      res.m_sum   = m_sum  .load(std::memory_order_relaxed);
+      res.m_max   = m_max  .load(std::memory_order_relaxed);
+      for (int b = 0; b < NBuckets; ++b)
+      {
+        res.m_buckets[b] = m_buckets[b].load(std::memory_order_relaxed);
+        res.m_count     += res.m_buckets[b];
+      }
+      return res;
+    }
+  };
+
+  //==========================================================================//
+  // "PoolStats": The Actual Instrumentation Policy:                          //
+  //==========================================================================//
+  // All times are in nsec:
+  //
+  class PoolStats
+  {
+  public:
+    constexpr static bool Enabled = true;
+
+    //------------------------------------------------------------------------//
+    // "WorkerStats": Updated by its own Worker Thread only:                  //
+    //------------------------------------------------------------------------//
+    // The intervals are added when they end: the wait for the Mutex and for
+    // a job when the Worker gets one, and the job when it re-locks the Mutex
+    // afterwards. The Pool adds the curr interval to a Snapshot. There is 1
+    // writer, so no atomic read-modify-write is needed:
+    //
+    struct WorkerStats
+    {
+      std::atomic<uint64_t> m_busyNS     {0};  // Running jobs
+      std::atomic<uint64_t> m_idleNS     {0};  // Waiting for jobs
+      std::atomic<uint64_t> m_lockWaitNS {0};  // Waiting for the Pool Mutex
+      std::atomic<uint64_t> m_nJobs      {0};
+
+      static void Add(std::atomic<uint64_t>& a_ctr, uint64_t a_val)
+      {
+        a_ctr.store(a_ctr.load(std::memory_order_relaxed) + a_val,
+                    std::memory_order_relaxed);
+      }
+
+      void OnIdle(uint64_t a_lock_wait, uint64_t a_idle)
+      {
+        Add(m_lockWaitNS, a_lock_wait);
+        Add(m_idleNS,     a_idle);
+      }
+
+      void OnBusy(uint64_t a_busy)
+      {
+        Add(m_busyNS,     a_busy);
+        Add(m_nJobs,      1);
+      }
+    };
+
+    //------------------------------------------------------------------------//
+    // "Snapshot":                                                            //
+    //------------------------------------------------------------------------//
+    struct WorkerSnapshot
+    {
+      size_t   m_slot;
+      uint64_t m_busyNS;
+      uint64_t m_idleNS;
+      uint64_t m_lockWaitNS;
+      uint64_t m_nJobs;
+
+      double Utilisation() const
+      {
+        uint64_t total = m_busyNS + m_idleNS + m_lockWaitNS;
+        return (total == 0) ? 0.0 : double(m_busyNS) / double(total);
+      }
+    };
+
+    struct Snapshot
+    {
+      uint64_t                    m_nSubmitted;
+      uint64_t                    m_nRejected;
+      LogHistogram::Snapshot      m_queueDepth;   // Sampled at each Submit
+      LogHistogram::Snapshot      m_queueWaitNS;
+      LogHistogram::Snapshot      m_serviceNS;
+      std::vector<WorkerSnapshot> m_workers;
+
+      void ToJSON(std::ostream& a_os) const
+      {
+        a_os << "{\"submitted\":" << m_nSubmitted
+             << ",\"rejected\":"  << m_nRejected
+             << ",\"queue_depth\":";
+        m_queueDepth .ToJSON(a_os);
+        a_os << ",\"queue_wait_ns\":";
+        m_queueWaitNS.ToJSON(a_os);
+        a_os << ",\"service_ns\":";
+        m_serviceNS  .ToJSON(a_os);
+        a_os << ",\"workers\":[";
+        for (size_t i = 0; i < m_workers.size(); ++i)
+        {
+          WorkerSnapshot const& w = m_workers[i];
+          a_os << ((i == 0) ? "" : ",")
+               << "{\"slot\":"          << w.m_slot
+               << ",\"jobs\":"          << w.m_nJobs
+               << ",\"busy_ns\":"       << w.m_busyNS
+               << ",\"idle_ns\":"       << w.m_idleNS
+               << ",\"lock_wait_ns\":"  << w.m_lockWaitNS
+               << ",\"utilisation\":"   << w.Utilisation() << '}';
+        }
+        a_os << "]}";
+      }
+    };
+
+  private:
+    std::atomic<uint64_t> m_nSubmitted;
+    std::atomic<uint64_t> m_nRejected;
+    LogHistogram          m_queueDepth;
+    LogHistogram          m_queueWaitNS;
+    LogHistogram          m_serviceNS;
+
+  public:
+    PoolStats()
+    : m_nSubmitted (0),
+      m_nRejected  (0),
+      m_queueDepth (),
+      m_queueWaitNS(),
+      m_serviceNS  ()
+    {}
+
+    // "a_depth" is the total number of queued jobs after this Submit:
+    void OnSubmit(bool a_ok, size_t a_depth)
+    {
+      m_nSubmitted.fetch_add(1, std::memory_order_relaxed);
+      if (!a_ok)
+        m_nRejected.fetch_add(1, std::memory_order_relaxed);
+      m_queueDepth.Add(a_depth);
+    }
+
+    void OnJob(uint64_t a_queue_wait, uint64_t a_service)
+    {
+      m_queueWaitNS.Add(a_queue_wait);
+      m_serviceNS  .Add(a_service);
+    }
+
+    // The Pool adds the per-Worker data:
+    Snapshot Get() const
+    {
+      return Snapshot
+      {
+        m_nSubmitted.load(std::memory_order_relaxed),
+        m_nRejected .load(std::memory_order_relaxed),
+        m_queueDepth .Get(),
+        m_queueWaitNS.Get(),
+        m_serviceNS  .Get(),
+        {}
+      };
+    }
+
+    // Plus the Worker's curr (not yet ended) idle or busy interval:
+    static WorkerSnapshot Get(size_t a_slot, WorkerStats const& a_ws,
+                              uint64_t a_idle_now, uint64_t a_busy_now)
+    {
+      return WorkerSnapshot
+      {
+        a_slot,
+        a_ws.m_busyNS    .load(std::memory_order_relaxed) + a_busy_now,
+        a_ws.m_idleNS    .load(std::memory_order_relaxed) + a_idle_now,
+        a_ws.m_lockWaitNS.load(std::memory_order_relaxed),
+        a_ws.m_nJobs     .load(std::memory_order_relaxed)
+      };
+    }
+  };
+} // End namespace SiriusFMTM